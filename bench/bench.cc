@@ -0,0 +1,727 @@
+// Matrix Construct
+//
+// Copyright (C) Matrix Construct Developers, Authors & Contributors
+// Copyright (C) 2016-2018 Jason Volk <jason@zemos.net>
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice is present in all copies. The
+// full license for this software is available in the LICENSE file.
+
+#include <ircd/ircd.h>
+#include <ircd/asio.h>
+
+using namespace ircd;
+
+/// Microbenchmarks of libircd hot paths.
+///
+/// Each benchmark is timed in rounds; a round's iteration count is calibrated
+/// to the target time and the median of the rounds is reported as ns per
+/// iteration. Results are printed one JSON object per line. When a baseline
+/// of the same format is given each result is compared with it and the run
+/// fails if any benchmark is slower by more than the tolerance.
+///
+/// The program does not run ircd::main(); only the subsystems required here
+/// are brought up. Benchmarks requiring a database use a scratch database
+/// named "bench" in the database directory which is removed afterward.
+///
+namespace bench
+{
+	struct result;
+	using func = std::function<void (const size_t &iterations)>;
+
+	extern const char *baseline;
+	extern const char *output;
+	extern const char *filter;
+	extern double tolerance;
+	extern milliseconds target;
+	extern size_t rounds;
+	extern std::vector<result> results;
+	extern std::map<std::string, double, std::less<>> base;
+	extern const string_view event_json;
+
+	template<class T> static void consume(const T &);
+	static nanoseconds time(const func &, const size_t &iterations);
+	static void run(const string_view &name, const func &);
+
+	static void json();
+	static void event();
+	static void ed25519();
+	static void codec();
+	static void ctx();
+	static void db(db::database &);
+	static void state(db::database &);
+
+	static void load_baseline(const string_view &path);
+	static void save(const string_view &path);
+	static void remove_database(const string_view &name);
+	static void main() noexcept;
+	static bool parseargs(int argc, char *const *argv);
+}
+
+struct bench::result
+{
+	std::string name;
+	size_t iterations {0};
+	double ns {0.0};
+	double delta {0.0};
+	bool regression {false};
+};
+
+const char *bench::baseline;
+const char *bench::output;
+const char *bench::filter;
+double bench::tolerance {10.0};
+ircd::milliseconds bench::target {250};
+size_t bench::rounds {5};
+decltype(bench::results) bench::results;
+decltype(bench::base) bench::base;
+
+decltype(bench::event_json)
+bench::event_json
+{R"({"auth_events":[["$15365454532yRKdq:example.org",{"sha256":"tBKmbQj0zxDqLmi/Zh1U8gR0fLEzvtdFRc8Fqk+pAXQ"}],["$15365454530mLneg:example.org",{"sha256":"6VpRJ8wXgpwYQZmPVWY/dNqXQrlnQNNchdcpt/6/4hQ"}]],"content":{"body":"The quick brown fox jumps over the lazy dog.","format":"org.matrix.custom.html","formatted_body":"The <b>quick</b> brown fox jumps over the lazy dog.","msgtype":"m.text"},"depth":1842,"event_id":"$15407542181yKxVm:example.org","hashes":{"sha256":"mmDuJVhrvvp/mkZjbzZlUv5y1anUvsxNbnOJWGv1Fno"},"origin":"example.org","origin_server_ts":1540754218193,"prev_events":[["$15407541760bBwxT:example.org",{"sha256":"Zzl2Bl8mvIOW0ErvBYB4C0Q5lXPZEKIDeyl60fFAv+0"}]],"room_id":"!LvoWzA0C1AkO0ixU:example.org","sender":"@alice:example.org","signatures":{"example.org":{"ed25519:a_Gwvb":"HOkC7cmAu9WZgFSB8rDrkAQdBr6/OzQz+9GojqwM9Gv0g1s8uN4Ek2fCg3N4Zrkyc5Cjh4+LUuD9XsGvMZ8xBw"}},"type":"m.room.message","unsigned":{"age":84}})"};
+
+int
+main(int argc, char *const *argv)
+try
+{
+	if(!bench::parseargs(argc, argv))
+		return EXIT_FAILURE;
+
+	if(bench::baseline)
+		bench::load_baseline(bench::baseline);
+
+	boost::asio::io_context ios;
+	ircd::ios::init(ios);
+	ircd::ios::main_thread_id = std::this_thread::get_id();
+
+	// The benchmarks run on a context; they're started on the next event
+	// slice and the context stops the ios when they're finished.
+	ircd::context context
+	{
+		"bench", 1_MiB, bench::main, ircd::context::POST
+	};
+
+	context.detach();
+	ios.run();
+
+	const auto regressions
+	{
+		std::count_if(begin(bench::results), end(bench::results), []
+		(const auto &result)
+		{
+			return result.regression;
+		})
+	};
+
+	if(bench::output)
+		bench::save(bench::output);
+
+	if(regressions)
+		std::cerr << regressions << " of " << bench::results.size()
+		          << " benchmarks are more than " << bench::tolerance
+		          << "% slower than the baseline" << std::endl;
+
+	return regressions? EXIT_FAILURE : EXIT_SUCCESS;
+}
+catch(const std::exception &e)
+{
+	std::cerr << "bench: " << e.what() << std::endl;
+	return EXIT_FAILURE;
+}
+
+bool
+bench::parseargs(int argc,
+                 char *const *argv)
+{
+	static const char *const usage
+	{
+		"usage: %s [-baseline file] [-output file] [-tolerance pct]"
+		" [-time ms] [-rounds n] [filter]\n"
+	};
+
+	for(int i(1); i < argc; ++i)
+	{
+		const string_view arg{argv[i]};
+		const bool has_value{i + 1 < argc};
+		if(arg == "-baseline" && has_value)
+			baseline = argv[++i];
+		else if(arg == "-output" && has_value)
+			output = argv[++i];
+		else if(arg == "-tolerance" && has_value)
+			tolerance = lex_cast<double>(string_view{argv[++i]});
+		else if(arg == "-time" && has_value)
+			target = milliseconds(lex_cast<long>(string_view{argv[++i]}));
+		else if(arg == "-rounds" && has_value)
+			rounds = std::max(lex_cast<size_t>(string_view{argv[++i]}), size_t(1));
+		else if(!startswith(arg, '-') && !filter)
+			filter = argv[i];
+		else
+		{
+			fprintf(stderr, usage, argv[0]);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void
+bench::main()
+noexcept try
+{
+	const unwind stop{[]
+	{
+		ircd::post([]
+		{
+			ircd::ios::get().stop();
+		});
+	}};
+
+	const log::console_quiet quiet{false};
+	fs::init _fs_;
+	ctx::ole::init _ole_;
+	nacl::init _nacl_;
+	db::init _db_;
+
+	json();
+	event();
+	ed25519();
+	codec();
+	ctx();
+
+	static const string_view dbname
+	{
+		"bench"
+	};
+
+	remove_database(dbname);
+	const unwind remove{[]
+	{
+		remove_database(dbname);
+	}};
+
+	static const db::description description
+	{
+		{ "default" },
+		m::dbs::desc::events__state_node,
+		{
+			"bench",
+			"Key-value pairs for the db::column benchmarks.",
+			{ typeid(string_view), typeid(string_view) },
+		},
+	};
+
+	const auto database
+	{
+		std::make_shared<db::database>(dbname, std::string{}, description)
+	};
+
+	db(*database);
+	state(*database);
+}
+catch(const std::exception &e)
+{
+	std::cerr << "bench: " << e.what() << std::endl;
+	results.emplace_back(result{"error", 0, 0.0, 0.0, true});
+}
+
+void
+bench::json()
+{
+	const json::object object
+	{
+		event_json
+	};
+
+	run("json.object.iterate", [&object](const size_t &n)
+	{
+		for(size_t i(0); i < n; ++i)
+			for(const auto &member : object)
+				consume(member);
+	});
+
+	run("json.object.get", [&object](const size_t &n)
+	{
+		for(size_t i(0); i < n; ++i)
+			consume(object.get("origin_server_ts"));
+	});
+
+	run("json.object.at", [&object](const size_t &n)
+	{
+		for(size_t i(0); i < n; ++i)
+			consume(object.at<json::object>("content").get("body"));
+	});
+
+	thread_local char buf[16_KiB];
+	run("json.stack.object", [](const size_t &n)
+	{
+		for(size_t i(0); i < n; ++i)
+		{
+			json::stack out{buf};
+			{
+				json::stack::object top{out};
+				json::stack::member{top, "origin", "example.org"};
+				json::stack::member{top, "origin_server_ts", json::value{1540754218193L}};
+				json::stack::member pdus_m{top, "pdus"};
+				json::stack::array pdus{pdus_m};
+				for(size_t j(0); j < 8; ++j)
+					pdus.append(json::object{event_json});
+			}
+
+			consume(out.completed());
+		}
+	});
+
+	run("json.stringify.members", [](const size_t &n)
+	{
+		for(size_t i(0); i < n; ++i)
+			consume(json::stringify(mutable_buffer{buf}, json::members
+			{
+				{ "type",       "m.room.message"  },
+				{ "depth",      json::value{1842L}  },
+				{ "sender",     "@alice:example.org" },
+				{ "content",    json::members
+				{
+					{ "msgtype",  "m.text"        },
+					{ "body",     "hello"         },
+				}},
+			}));
+	});
+}
+
+void
+bench::event()
+{
+	const json::object object
+	{
+		event_json
+	};
+
+	run("m.event.parse", [&object](const size_t &n)
+	{
+		for(size_t i(0); i < n; ++i)
+			consume(m::event{object});
+	});
+
+	const m::event event
+	{
+		object
+	};
+
+	run("m.event.hash", [&event](const size_t &n)
+	{
+		for(size_t i(0); i < n; ++i)
+			consume(hash(event));
+	});
+
+	thread_local char buf[m::event::MAX_SIZE];
+	run("m.event.essential", [&event](const size_t &n)
+	{
+		for(size_t i(0); i < n; ++i)
+			consume(essential(event, buf));
+	});
+}
+
+void
+bench::ed25519()
+{
+	const fixed_buffer<const_buffer, ircd::ed25519::SEED_SZ> seed
+	{
+		[](const mutable_buffer &buf)
+		{
+			std::fill(begin(buf), end(buf), 'x');
+		}
+	};
+
+	ircd::ed25519::pk pk;
+	const ircd::ed25519::sk sk
+	{
+		&pk, seed
+	};
+
+	const const_buffer msg
+	{
+		event_json
+	};
+
+	run("ed25519.sign", [&sk, &msg](const size_t &n)
+	{
+		for(size_t i(0); i < n; ++i)
+			consume(sk.sign(msg));
+	});
+
+	const auto sig
+	{
+		sk.sign(msg)
+	};
+
+	run("ed25519.verify", [&pk, &msg, &sig](const size_t &n)
+	{
+		for(size_t i(0); i < n; ++i)
+			if(unlikely(!pk.verify(msg, sig)))
+				throw ircd::ed25519::bad_sig
+				{
+					"Verification of the benchmark signature failed"
+				};
+	});
+}
+
+void
+bench::codec()
+{
+	const sha256::buf hash
+	{
+		sha256{event_json}
+	};
+
+	thread_local char buf[128_KiB];
+	run("b64.encode.32", [&hash](const size_t &n)
+	{
+		for(size_t i(0); i < n; ++i)
+			consume(b64encode_unpadded(buf, hash));
+	});
+
+	char hashb64buf[64];
+	const string_view hashb64
+	{
+		b64encode_unpadded(hashb64buf, hash)
+	};
+
+	run("b64.decode.32", [&hashb64](const size_t &n)
+	{
+		for(size_t i(0); i < n; ++i)
+			consume(b64decode(buf, hashb64));
+	});
+
+	run("b58.encode.32", [&hash](const size_t &n)
+	{
+		for(size_t i(0); i < n; ++i)
+			consume(b58encode(buf, hash));
+	});
+
+	char hashb58buf[64];
+	const string_view hashb58
+	{
+		b58encode(hashb58buf, hash)
+	};
+
+	run("b58.decode.32", [&hashb58](const size_t &n)
+	{
+		for(size_t i(0); i < n; ++i)
+			consume(b58decode(buf, hashb58));
+	});
+
+	std::string block(32_KiB, char{});
+	std::mt19937_64 rand{0};
+	std::generate(begin(block), end(block), rand);
+	run("b64.encode.32KiB", [&block](const size_t &n)
+	{
+		for(size_t i(0); i < n; ++i)
+			consume(b64encode(buf, const_buffer{block}));
+	});
+
+	const std::string blockb64
+	{
+		b64encode(const_buffer{block})
+	};
+
+	run("b64.decode.32KiB", [&blockb64](const size_t &n)
+	{
+		for(size_t i(0); i < n; ++i)
+			consume(b64decode(buf, blockb64));
+	});
+}
+
+void
+bench::ctx()
+{
+	run("ctx.spawn", [](const size_t &n)
+	{
+		for(size_t i(0); i < n; ++i)
+		{
+			context context
+			{
+				"bench", 64_KiB, []
+				{
+				}
+			};
+		}
+	});
+
+	// Each iteration is a round trip through the ios with another context
+	// yielding in turn.
+	run("ctx.yield", [](const size_t &n)
+	{
+		bool done{false};
+		context other
+		{
+			"bench", 64_KiB, [&done]
+			{
+				while(!done)
+					ircd::ctx::yield();
+			}
+		};
+
+		for(size_t i(0); i < n; ++i)
+			ircd::ctx::yield();
+
+		done = true;
+	});
+}
+
+void
+bench::db(db::database &database)
+{
+	db::column column
+	{
+		database, "bench"
+	};
+
+	static const size_t keys
+	{
+		64_KiB
+	};
+
+	char keybuf[32], valbuf[128];
+	std::fill(begin(valbuf), end(valbuf), 'v');
+	for(size_t i(0); i < keys; ++i)
+		db::write(column, fmt::sprintf{keybuf, "%016zx", i}, const_buffer{valbuf, sizeof(valbuf)});
+
+	db::flush(database, true);
+	db::sort(column, true);
+
+	std::vector<std::string> order(keys);
+	for(size_t i(0); i < keys; ++i)
+		order[i] = fmt::snstringf{32, "%016zx", i};
+
+	std::shuffle(begin(order), end(order), std::mt19937_64{0});
+	run("db.column.get", [&column, &order](const size_t &n)
+	{
+		for(size_t i(0); i < n; ++i)
+			column(order[i % order.size()], [](const string_view &val)
+			{
+				consume(val);
+			});
+	});
+
+	run("db.column.has", [&column, &order](const size_t &n)
+	{
+		for(size_t i(0); i < n; ++i)
+			consume(db::has(column, order[i % order.size()]));
+	});
+
+	// Reported per key
+	run("db.column.iterate", [&column](const size_t &n)
+	{
+		for(size_t i(0); i < n; )
+			for(auto it(column.begin()); it && i < n; ++it, ++i)
+				consume(it->second);
+	});
+}
+
+void
+bench::state(db::database &database)
+{
+	m::dbs::state_node = db::column
+	{
+		database, m::dbs::desc::events__state_node.name
+	};
+
+	const unwind reset{[]
+	{
+		m::dbs::state_node = {};
+	}};
+
+	static const size_t keys
+	{
+		4096
+	};
+
+	std::vector<std::string> event_ids(keys), state_keys(keys);
+	for(size_t i(0); i < keys; ++i)
+	{
+		event_ids[i] = fmt::snstringf{64, "$%zu:bench.localhost", i};
+		state_keys[i] = fmt::snstringf{64, "@%zu:bench.localhost", i};
+	}
+
+	m::state::id_buffer root[2];
+	string_view head;
+	size_t inserted{0};
+	const auto insert{[&](const size_t &i)
+	{
+		db::txn txn
+		{
+			database
+		};
+
+		auto &out(root[inserted++ % 2]);
+		if(!head)
+		{
+			m::event event;
+			json::get<"type"_>(event) = json::string{"m.room.member"};
+			json::get<"state_key"_>(event) = json::string{state_keys[i % keys]};
+			json::get<"event_id"_>(event) = json::string{event_ids[i % keys]};
+			head = m::state::insert(txn, out, {}, event);
+		}
+		else head = m::state::insert(txn, out, head, "m.room.member", state_keys[i % keys], m::id::event{event_ids[i % keys]});
+
+		txn();
+	}};
+
+	for(size_t i(0); i < keys; ++i)
+		insert(i);
+
+	std::vector<size_t> order(keys);
+	std::iota(begin(order), end(order), 0);
+	std::shuffle(begin(order), end(order), std::mt19937_64{0});
+	run("m.state.get", [&head, &state_keys, &order](const size_t &n)
+	{
+		for(size_t i(0); i < n; ++i)
+			m::state::get(head, "m.room.member", state_keys[order[i % keys]], []
+			(const string_view &val)
+			{
+				consume(val);
+			});
+	});
+
+	// Overwrites the same keys so the tree doesn't grow with the iterations.
+	run("m.state.insert", [&insert, &order](const size_t &n)
+	{
+		for(size_t i(0); i < n; ++i)
+			insert(order[i % keys]);
+	});
+}
+
+void
+bench::run(const string_view &name,
+           const func &func)
+{
+	if(filter && !startswith(name, filter))
+		return;
+
+	// Calibrate the iterations for a round to the target time.
+	size_t iterations(1);
+	for(nanoseconds elapsed(0); elapsed < target / 4; iterations *= 2)
+		if((elapsed = time(func, iterations)) >= target / 4)
+			break;
+
+	std::vector<double> samples(rounds);
+	for(auto &sample : samples)
+		sample = double(time(func, iterations).count()) / iterations;
+
+	std::sort(begin(samples), end(samples));
+	result result
+	{
+		std::string(name), iterations, samples.at(samples.size() / 2)
+	};
+
+	const auto it(base.find(name));
+	if(it != end(base) && it->second > 0.0)
+	{
+		result.delta = (result.ns - it->second) / it->second * 100.0;
+		result.regression = result.delta > tolerance;
+	}
+
+	std::cout << "{\"name\":\"" << result.name << "\""
+	          << ",\"iterations\":" << result.iterations
+	          << ",\"ns\":" << result.ns;
+
+	if(it != end(base))
+		std::cout << ",\"baseline\":" << it->second
+		          << ",\"delta\":" << result.delta
+		          << ",\"regression\":" << (result.regression? "true" : "false");
+
+	std::cout << "}" << std::endl;
+	results.emplace_back(std::move(result));
+}
+
+ircd::nanoseconds
+bench::time(const func &func,
+            const size_t &iterations)
+{
+	const auto start
+	{
+		std::chrono::steady_clock::now()
+	};
+
+	func(iterations);
+	return std::chrono::steady_clock::now() - start;
+}
+
+template<class T>
+void
+bench::consume(const T &t)
+{
+	asm volatile ("" :: "g" (&t) : "memory");
+}
+
+void
+bench::load_baseline(const string_view &path)
+{
+	std::ifstream file
+	{
+		std::string(path)
+	};
+
+	if(!file)
+	{
+		std::cerr << "No baseline at `" << path << "'; use `make bench-baseline'"
+		          << " to record one." << std::endl;
+		return;
+	}
+
+	std::string line;
+	while(std::getline(file, line))
+	{
+		if(line.empty())
+			continue;
+
+		const json::object object{line};
+		base.emplace(unquote(object.at("name")), object.at<double>("ns"));
+	}
+}
+
+void
+bench::save(const string_view &path)
+{
+	std::ofstream file
+	{
+		std::string(path), std::ios::trunc
+	};
+
+	for(const auto &result : results)
+		file << "{\"name\":\"" << result.name << "\""
+		     << ",\"iterations\":" << result.iterations
+		     << ",\"ns\":" << result.ns
+		     << "}" << std::endl;
+}
+
+void
+bench::remove_database(const string_view &name)
+{
+	const string_view parts[]
+	{
+		fs::get(fs::DB), name
+	};
+
+	const std::string path
+	{
+		fs::make_path(parts)
+	};
+
+	if(!fs::exists(path))
+		return;
+
+	auto files
+	{
+		fs::ls_recursive(path)
+	};
+
+	// Deepest first so directories are empty when they're removed.
+	std::sort(rbegin(files), rend(files));
+	for(const auto &file : files)
+		fs::remove(std::nothrow, file);
+
+	fs::remove(std::nothrow, path);
+}
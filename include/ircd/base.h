@@ -18,6 +18,7 @@ namespace ircd
 	size_t b58encode_size(const const_buffer &in);
 	string_view b58encode(const mutable_buffer &out, const const_buffer &in);
 	std::string b58encode(const const_buffer &in);
+	string_view b58encode_compat(const mutable_buffer &out, const const_buffer &in);
 
 	// Base58 -> Binary decode suite
 	constexpr size_t b58decode_size(const size_t &);
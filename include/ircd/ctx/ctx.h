@@ -76,6 +76,7 @@ namespace ircd::ctx
 #include "exception_handler.h"
 #include "uninterruptible.h"
 #include "prof.h"
+#include "sched.h"
 #include "list.h"
 #include "dock.h"
 #include "latch.h"
@@ -94,6 +95,7 @@ namespace ircd::ctx
 #include "async.h"
 #include "pool.h"
 #include "ole.h"
+#include "stack_pool.h"
 #include "fault.h"
 
 // Exports to ircd::
@@ -16,6 +16,7 @@ namespace ircd::ctx
 	struct pool;
 
 	const string_view &name(const pool &);
+	const sched::prio &prio(const pool &);
 }
 
 class ircd::ctx::pool
@@ -24,6 +25,7 @@ class ircd::ctx::pool
 
 	string_view name;
 	size_t stack_size;
+	sched::prio prio;
 	size_t running;
 	size_t working;
 	queue<closure> q;
@@ -60,7 +62,8 @@ class ircd::ctx::pool
 
 	pool(const string_view &name     = "<unnamed pool>"_sv,
 	     const size_t &stack_size    = DEFAULT_STACK_SIZE,
-	     const size_t &initial_ctxs  = 0);
+	     const size_t &initial_ctxs  = 0,
+	     const sched::prio &prio     = sched::prio::INTERACTIVE);
 
 	pool(pool &&) = delete;
 	pool(const pool &) = delete;
@@ -69,6 +72,7 @@ class ircd::ctx::pool
 	~pool() noexcept;
 
 	friend const string_view &name(const pool &);
+	friend const sched::prio &prio(const pool &);
 	friend void debug_stats(const pool &);
 };
 
@@ -59,6 +59,23 @@ enum class ircd::ctx::prof::event
 	CUR_TERMINATE,     // Current context detects termination
 };
 
+/// Sampling profiler. A wall-clock timer signals the main thread at hz and
+/// the handler records the name of the current context with a frame-pointer
+/// walk of its stack into a fixed ring. dump() aggregates the ring into folded
+/// stacks rooted at the context name, the input format of flamegraph.pl.
+/// This is meant to be left off and started on demand from the console.
+namespace ircd::ctx::prof::sample
+{
+	extern conf::item<size_t> hz;                // Clamped to [1, 10000]
+	extern conf::item<size_t> ring_size;
+
+	bool running();
+	size_t count();                              // Samples taken since start()
+	size_t dump(std::ostream &, const string_view &ctx_name = {});
+	void start();
+	void stop();
+}
+
 namespace ircd::ctx::prof::settings
 {
 	extern conf::item<double> stack_usage_warning;     // percentage
@@ -0,0 +1,71 @@
+// Matrix Construct
+//
+// Copyright (C) Matrix Construct Developers, Authors & Contributors
+// Copyright (C) 2016-2018 Jason Volk <jason@zemos.net>
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice is present in all copies. The
+// full license for this software is available in the LICENSE file.
+
+#pragma once
+#define HAVE_IRCD_CTX_SCHED_H
+
+/// Priority classes for contexts.
+///
+/// Every context belongs to a class; a new context inherits the class of the
+/// context which spawned it and a ctx::pool's contexts take the class of the
+/// pool. All contexts still share the one io_service queue, so the classes
+/// are enforced where a context resumes from wait(): a context resuming while
+/// contexts of a higher class have been woken and not yet run goes to the
+/// back of the queue. It does so at most defer_max times in a row and not
+/// once it has waited longer than wait_max, so no class is starved.
+///
+namespace ircd::ctx::sched
+{
+	enum class prio :uint8_t;
+	struct stats;
+	struct scope;
+
+	extern std::array<stats, 3> stat;            // Indexed by prio
+
+	extern conf::item<size_t> defer_max;
+	extern conf::item<milliseconds> wait_max;
+
+	string_view reflect(const prio &);
+	bool ready_above(const prio &);              // Any higher class is ready
+}
+
+namespace ircd::ctx
+{
+	const sched::prio &prio(const ctx &);        // Priority class of context
+	void prio(ctx &, const sched::prio &);       // Change priority class
+}
+
+enum class ircd::ctx::sched::prio
+:uint8_t
+{
+	INTERACTIVE,                                 ///< Work a user is waiting on
+	FEDERATION,                                  ///< Work for remote servers
+	BACKGROUND,                                  ///< Fetches, backfill, maintenance
+};
+
+struct ircd::ctx::sched::stats
+{
+	size_t ready {0};                            // Woken and not yet resumed
+	uint64_t resumes {0};                        // Resumes after a wake
+	uint64_t defers {0};                         // Resumes given up to a higher class
+	microseconds wait_total {0};                 // Wake-to-resume accumulated
+	microseconds wait_max {0};                   // Wake-to-resume worst
+};
+
+/// Runs the current context at another priority class for this scope.
+struct ircd::ctx::sched::scope
+{
+	prio theirs;
+
+	scope(const prio &);
+	scope(scope &&) = delete;
+	scope(const scope &) = delete;
+	~scope() noexcept;
+};
@@ -0,0 +1,45 @@
+// Matrix Construct
+//
+// Copyright (C) Matrix Construct Developers, Authors & Contributors
+// Copyright (C) 2016-2018 Jason Volk <jason@zemos.net>
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice is present in all copies. The
+// full license for this software is available in the LICENSE file.
+
+#pragma once
+#define HAVE_IRCD_CTX_STACK_POOL_H
+
+/// Recycled coroutine stacks.
+///
+/// The stack of a context is returned here when the context exits rather
+/// than being unmapped, and the next context of the same size takes it back
+/// off a free list. Stacks keep their guard page while cached. Past the
+/// resident limit a released stack is madvise()'d so the kernel may reclaim
+/// its pages while the mapping remains; past the max limit it is unmapped.
+///
+namespace ircd::ctx::stack_pool
+{
+	struct stats;
+
+	extern conf::item<size_t> max;               // Bytes of stacks cached
+	extern conf::item<size_t> resident;          // Bytes of cached stacks left resident
+	extern struct stats stats;
+
+	size_t count(const size_t &size);            // Stacks cached for the size class
+	size_t count();                              // Stacks cached for all classes
+	size_t bytes();                              // Bytes cached for all classes
+	size_t bytes_resident();                     // Bytes cached and not trimmed
+
+	bool for_each(const std::function<bool (const size_t &size, const size_t &count)> &);
+}
+
+struct ircd::ctx::stack_pool::stats
+{
+	uint64_t allocs {0};                         // Stacks given to contexts
+	uint64_t reuses {0};                         // ...of which came off a free list
+	uint64_t maps {0};                           // ...of which were newly mapped
+	uint64_t unmaps {0};                         // Stacks released past the max
+	uint64_t trims {0};                          // Stacks released past the resident
+};
@@ -41,6 +41,7 @@ struct ircd::db::database::column final
 	std::shared_ptr<struct database::stats> stats;
 	rocksdb::BlockBasedTableOptions table_opts;
 	custom_ptr<rocksdb::ColumnFamilyHandle> handle;
+	ircd::stats::histogram seek_stat;
 
   public:
 	operator const rocksdb::ColumnFamilyOptions &() const;
@@ -43,7 +43,6 @@ namespace ircd::fmt
 class ircd::fmt::snprintf
 {
 	window_buffer out;                           // Window on the output buffer.
-	const_buffer fmt;                            // Current running position in the fmtstr.
 	short idx;                                   // Keeps count of the args for better err msgs
 
   protected:
@@ -53,7 +52,6 @@ class ircd::fmt::snprintf
 	string_view completed() const                { return out.completed();                         }
 
 	void append(const string_view &);
-	void argument(const arg &);
 
 	IRCD_OVERLOAD(internal)
 	snprintf(internal_t, const mutable_buffer &, const string_view &, const va_rtti &);
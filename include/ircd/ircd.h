@@ -46,6 +46,7 @@
 #include "http.h"
 #include "magics.h"
 #include "conf.h"
+#include "stats.h"
 #include "fs/fs.h"
 #include "ios.h"
 #include "ctx/ctx.h"
@@ -82,9 +82,9 @@ template<class tuple,
          class function,
          size_t i>
 typename std::enable_if<i == size<tuple>(), void>::type
-at(tuple &t,
-   const string_view &name,
-   function&& f)
+_at(tuple &t,
+    const size_t &idx,
+    function&& f)
 {
 }
 
@@ -92,23 +92,33 @@ template<class tuple,
          class function,
          size_t i = 0>
 typename std::enable_if<i < size<tuple>(), void>::type
+_at(tuple &t,
+    const size_t &idx,
+    function&& f)
+{
+	if(idx == i)
+		f(val<i>(t));
+	else
+		_at<tuple, function, i + 1>(t, idx, std::forward<function>(f));
+}
+
+template<class tuple,
+         class function>
+enable_if_tuple<tuple, void>
 at(tuple &t,
    const string_view &name,
    function&& f)
 {
-	if(indexof<tuple>(name) == i)
-		f(val<i>(t));
-	else
-		at<tuple, function, i + 1>(t, name, std::forward<function>(f));
+	_at<tuple, function>(t, indexof<tuple>(name), std::forward<function>(f));
 }
 
 template<class tuple,
          class function,
          size_t i>
 typename std::enable_if<i == size<tuple>(), void>::type
-at(const tuple &t,
-   const string_view &name,
-   function&& f)
+_at(const tuple &t,
+    const size_t &idx,
+    function&& f)
 {
 }
 
@@ -116,14 +126,24 @@ template<class tuple,
          class function,
          size_t i = 0>
 typename std::enable_if<i < size<tuple>(), void>::type
+_at(const tuple &t,
+    const size_t &idx,
+    function&& f)
+{
+	if(idx == i)
+		f(val<i>(t));
+	else
+		_at<tuple, function, i + 1>(t, idx, std::forward<function>(f));
+}
+
+template<class tuple,
+         class function>
+enable_if_tuple<tuple, void>
 at(const tuple &t,
    const string_view &name,
    function&& f)
 {
-	if(indexof<tuple>(name) == i)
-		f(val<i>(t));
-	else
-		at<tuple, function, i + 1>(t, name, std::forward<function>(f));
+	_at<tuple, function>(t, indexof<tuple>(name), std::forward<function>(f));
 }
 
 } // namespace json
@@ -76,10 +76,129 @@ indexof(const char *const &name)
 	return equal? i : indexof<tuple, i + 1>(name);
 }
 
+/// Compile-time perfect hash over a tuple's property names. The names are
+/// hashed with _key_hash() and a window of the hash bits is searched for
+/// which maps every name to a distinct slot of the smallest table possible;
+/// the slot holds the property index. At runtime the input key is hashed once
+/// and confirmed with a single comparison, instead of a comparison against
+/// every name in turn. Tuples for which no window is found within the table
+/// size limit (or with too many properties) fall back to the linear search.
+template<class tuple>
+struct _key_index
+{
+	static constexpr size_t max_bits {10};
+
+	struct select
+	{
+		size_t bits {0};
+		size_t shift {0};
+	};
+
+	static constexpr uint64_t hash(const size_t &i);
+	static constexpr size_t slot(const uint64_t &hash, const select &);
+	static constexpr bool perfect(const select &);
+	static constexpr select search();
+
+	static constexpr select sel
+	{
+		search()
+	};
+
+	static constexpr bool valid
+	{
+		sel.bits > 0
+	};
+
+	using table_type = std::array<uint8_t, 1UL << sel.bits>;
+	static constexpr table_type build();
+
+	static constexpr table_type table
+	{
+		build()
+	};
+};
+
+constexpr uint64_t
+_key_hash(const char *const &s,
+          const size_t &len)
+{
+	uint64_t ret(0xcbf29ce484222325ULL);
+	for(size_t i(0); i < len; ++i)
+		ret = (ret ^ uint8_t(s[i])) * 0x100000001b3ULL;
+
+	return ret;
+}
+
+template<class tuple>
+constexpr uint64_t
+_key_index<tuple>::hash(const size_t &i)
+{
+	const char *const name(key<tuple>(i));
+	size_t len(0);
+	while(name[len])
+		++len;
+
+	return _key_hash(name, len);
+}
+
+template<class tuple>
+constexpr size_t
+_key_index<tuple>::slot(const uint64_t &hash,
+                        const select &sel)
+{
+	return (hash >> sel.shift) & ((1UL << sel.bits) - 1);
+}
+
+template<class tuple>
+constexpr bool
+_key_index<tuple>::perfect(const select &sel)
+{
+	for(size_t i(0); i < size<tuple>(); ++i)
+		for(size_t j(i + 1); j < size<tuple>(); ++j)
+			if(slot(hash(i), sel) == slot(hash(j), sel))
+				return false;
+
+	return true;
+}
+
+template<class tuple>
+constexpr typename _key_index<tuple>::select
+_key_index<tuple>::search()
+{
+	if(size<tuple>() == 0 || size<tuple>() >= 255)
+		return {};
+
+	size_t bits(0);
+	while((1UL << bits) < size<tuple>())
+		++bits;
+
+	for(; bits <= max_bits; ++bits)
+		for(size_t shift(0); shift + bits <= 64; ++shift)
+			if(perfect(select{bits, shift}))
+				return {bits, shift};
+
+	return {};
+}
+
+template<class tuple>
+constexpr typename _key_index<tuple>::table_type
+_key_index<tuple>::build()
+{
+	table_type ret {};
+	for(size_t i(0); i < ret.size(); ++i)
+		ret[i] = uint8_t(size<tuple>());
+
+	if(valid)
+		for(size_t i(0); i < size<tuple>(); ++i)
+			ret[slot(hash(i), sel)] = uint8_t(i);
+
+	return ret;
+}
+
 template<class tuple,
          size_t i>
 constexpr typename std::enable_if<i == size<tuple>(), size_t>::type
-indexof(const string_view &name)
+_indexof(const string_view &name)
 {
 	return size<tuple>();
 }
@@ -87,14 +206,31 @@ indexof(const string_view &name)
 template<class tuple,
          size_t i = 0>
 constexpr typename std::enable_if<i < size<tuple>(), size_t>::type
-indexof(const string_view &name)
+_indexof(const string_view &name)
 {
 	const auto equal
 	{
 		name == key<tuple, i>()
 	};
 
-	return equal? i : indexof<tuple, i + 1>(name);
+	return equal? i : _indexof<tuple, i + 1>(name);
+}
+
+template<class tuple>
+constexpr size_t
+indexof(const string_view &name)
+{
+	using index = _key_index<tuple>;
+
+	if(!index::valid)
+		return _indexof<tuple>(name);
+
+	const size_t i
+	{
+		index::table[index::slot(_key_hash(name.data(), name.size()), index::sel)]
+	};
+
+	return i < size<tuple>() && name == key<tuple>(i)? i : size<tuple>();
 }
 
 } // namespace json
@@ -30,6 +30,7 @@ namespace ircd::log
 	struct logf;
 	struct mark;
 	struct console_quiet;
+	struct ring_stats;
 
 	struct critical;
 	struct error;
@@ -60,6 +61,9 @@ namespace ircd::log
 	void console_disable();
 	void console_enable();
 
+	// Lines are handed to a writer thread unless ircd.log.async.enable is
+	// false; flush() waits until everything logged so far is written.
+	ring_stats stats();
 	void flush();
 	void close();
 	void open();
@@ -153,6 +157,18 @@ struct ircd::log::log
 	static log *find(const char &snote);
 };
 
+/// Counters for the asynchronous writer; all zero when it's not running.
+struct ircd::log::ring_stats
+{
+	size_t size {0};           ///< Record slots in the ring
+	size_t queued {0};         ///< Records pushed but not yet written
+	size_t pushed {0};         ///< Records copied into the ring
+	size_t written {0};        ///< Records written out by the writer thread
+	size_t dropped {0};        ///< Records discarded on overflow ("drop")
+	size_t blocked {0};        ///< Spins waiting on overflow ("block")
+	size_t batches {0};        ///< writev(2) calls by the writer thread
+};
+
 struct ircd::log::vlog
 {
 	vlog(const log &log, const facility &, const string_view &fmt, const va_rtti &ap);
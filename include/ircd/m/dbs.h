@@ -23,6 +23,7 @@ namespace ircd::m::dbs
 	extern conf::item<bool> events_cache_comp_enable;
 	extern conf::item<size_t> events_mem_write_buffer_size;
 	extern conf::item<size_t> events_sst_write_buffer_size;
+	extern conf::item<size_t> id_cache_max;
 
 	// Database instance
 	extern std::shared_ptr<db::database> events;
@@ -33,28 +34,44 @@ namespace ircd::m::dbs
 
 	// Event metadata columns
 	extern db::column event_idx;       // event_id => event_idx
-	extern db::index room_head;        // room_id | event_id => event_idx
-	extern db::index room_events;      // room_id | depth, event_idx => state_root
-	extern db::index room_joined;      // room_id | origin, member => event_idx
-	extern db::index room_state;       // room_id | type, state_key => event_idx
+	extern db::column id_idx;          // room_id|user_id|origin => id_idx
+	extern db::column idx_id;          // id_idx => room_id|user_id|origin
+	extern db::index room_head;        // room_idx | event_id => event_idx
+	extern db::index room_events;      // room_idx | depth, event_idx => state_root
+	extern db::index room_joined;      // room_idx | origin_idx, user_idx => event_idx
+	extern db::index room_state;       // room_idx | type, state_key => event_idx
 	extern db::column state_node;      // node_id => state::node
 
+	// Identifier dictionary
+	uint64_t id_index(const string_view &id);
+	uint64_t id_index(db::txn &, const string_view &id);
+	void id_release(const db::txn &);
+	string_view id_string(const mutable_buffer &out, const uint64_t &id_idx);
+
 	// Lowlevel util
-	constexpr size_t ROOM_HEAD_KEY_MAX_SIZE {id::MAX_SIZE + 1 + id::MAX_SIZE};
+	constexpr size_t ROOM_KEY_SIZE {8};
+	string_view room_key(const mutable_buffer &out, const uint64_t &room_idx);
+	string_view room_key(const mutable_buffer &out, const id::room &);
+
+	constexpr size_t ROOM_HEAD_KEY_MAX_SIZE {ROOM_KEY_SIZE + 1 + id::MAX_SIZE};
+	string_view room_head_key(const mutable_buffer &out, const uint64_t &room_idx, const id::event &);
 	string_view room_head_key(const mutable_buffer &out, const id::room &, const id::event &);
 	string_view room_head_key(const string_view &amalgam);
 
-	constexpr size_t ROOM_STATE_KEY_MAX_SIZE {id::MAX_SIZE + 256 + 256};
+	constexpr size_t ROOM_STATE_KEY_MAX_SIZE {ROOM_KEY_SIZE + 1 + 256 + 1 + 256};
+	string_view room_state_key(const mutable_buffer &out, const uint64_t &room_idx, const string_view &type, const string_view &state_key);
 	string_view room_state_key(const mutable_buffer &out, const id::room &, const string_view &type, const string_view &state_key);
 	string_view room_state_key(const mutable_buffer &out, const id::room &, const string_view &type);
 	std::pair<string_view, string_view> room_state_key(const string_view &amalgam);
 
-	constexpr size_t ROOM_JOINED_KEY_MAX_SIZE {id::MAX_SIZE + 256 + id::MAX_SIZE};
+	constexpr size_t ROOM_JOINED_KEY_MAX_SIZE {ROOM_KEY_SIZE + 1 + 8 + 8};
+	string_view room_joined_key(const mutable_buffer &out, const uint64_t &room_idx, const uint64_t &origin_idx, const uint64_t &user_idx);
 	string_view room_joined_key(const mutable_buffer &out, const id::room &, const string_view &origin, const id::user &member);
 	string_view room_joined_key(const mutable_buffer &out, const id::room &, const string_view &origin);
-	std::pair<string_view, string_view> room_joined_key(const string_view &amalgam);
+	std::pair<uint64_t, uint64_t> room_joined_key(const string_view &amalgam);
 
-	constexpr size_t ROOM_EVENTS_KEY_MAX_SIZE {id::MAX_SIZE + 1 + 8 + 8};
+	constexpr size_t ROOM_EVENTS_KEY_MAX_SIZE {ROOM_KEY_SIZE + 1 + 8 + 8};
+	string_view room_events_key(const mutable_buffer &out, const uint64_t &room_idx, const uint64_t &depth, const event::idx &);
 	string_view room_events_key(const mutable_buffer &out, const id::room &, const uint64_t &depth, const event::idx &);
 	string_view room_events_key(const mutable_buffer &out, const id::room &, const uint64_t &depth);
 	std::pair<uint64_t, event::idx> room_events_key(const string_view &amalgam);
@@ -76,6 +93,7 @@ namespace ircd::m::dbs
 struct ircd::m::dbs::write_opts
 {
 	uint64_t event_idx {0};
+	uint64_t room_idx {0};             // resolved from the event when zero
 	string_view root_in;
 	mutable_buffer root_out;
 	db::op op {db::op::SET};
@@ -194,11 +212,20 @@ namespace ircd::m::dbs::desc
 	extern conf::item<size_t> events__event_idx__bloom__bits;
 	extern const db::descriptor events__event_idx;
 
+	// identifier dictionary
+	extern conf::item<size_t> events__id_idx__block__size;
+	extern conf::item<size_t> events__id_idx__cache__size;
+	extern conf::item<size_t> events__id_idx__bloom__bits;
+	extern const db::descriptor events__id_idx;
+	extern conf::item<size_t> events__idx_id__block__size;
+	extern conf::item<size_t> events__idx_id__cache__size;
+	extern const db::descriptor events__idx_id;
+	extern const db::prefix_transform events__room__pfx;
+
 	// room head mapping sequence
 	extern conf::item<size_t> events__room_head__block__size;
 	extern conf::item<size_t> events__room_head__meta_block__size;
 	extern conf::item<size_t> events__room_head__cache__size;
-	extern const db::prefix_transform events__room_head__pfx;
 	extern const db::descriptor events__room_head;
 
 	// room events sequence
@@ -206,7 +233,6 @@ namespace ircd::m::dbs::desc
 	extern conf::item<size_t> events__room_events__meta_block__size;
 	extern conf::item<size_t> events__room_events__cache__size;
 	extern conf::item<size_t> events__room_events__cache_comp__size;
-	extern const db::prefix_transform events__room_events__pfx;
 	extern const db::comparator events__room_events__cmp;
 	extern const db::descriptor events__room_events;
 
@@ -216,7 +242,6 @@ namespace ircd::m::dbs::desc
 	extern conf::item<size_t> events__room_joined__cache__size;
 	extern conf::item<size_t> events__room_joined__cache_comp__size;
 	extern conf::item<size_t> events__room_joined__bloom__bits;
-	extern const db::prefix_transform events__room_joined__pfx;
 	extern const db::descriptor events__room_joined;
 
 	// room present state mapping sequence
@@ -225,7 +250,6 @@ namespace ircd::m::dbs::desc
 	extern conf::item<size_t> events__room_state__cache__size;
 	extern conf::item<size_t> events__room_state__cache_comp__size;
 	extern conf::item<size_t> events__room_state__bloom__bits;
-	extern const db::prefix_transform events__room_state__pfx;
 	extern const db::descriptor events__room_state;
 
 	// state btree node key-value store
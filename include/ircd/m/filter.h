@@ -55,12 +55,50 @@ struct ircd::m::room_event_filter
 	json::property<name::contains_url, bool>
 >
 {
+	struct compiled;
+
 	using super_type::tuple;
 	room_event_filter(const mutable_buffer &, const json::members &);
 	room_event_filter() = default;
 	using super_type::operator=;
 };
 
+/// A room_event_filter prepared for matching many events. The arrays are
+/// unquoted once into hash sets, with entries containing a '*' kept aside
+/// as globs. `keys` selects the event keys which match() reads (and the
+/// event_id) so an iteration can fetch only those for a first pass. Instances are shared
+/// through get(), which caches them by the filter's JSON.
+struct ircd::m::room_event_filter::compiled
+{
+	struct set
+	{
+		std::unordered_set<string_view> exact;
+		std::vector<string_view> globs;
+
+		bool empty() const;
+		bool has(const string_view &) const;
+
+		set(const json::array &);
+	};
+
+	static conf::item<size_t> cache_max;
+
+	std::string source;
+	room_event_filter filter;
+	set types, not_types;
+	set senders, not_senders;
+	set rooms, not_rooms;
+	event::keys::selection keys;
+
+	bool match(const event &) const;
+
+	static std::shared_ptr<const compiled> get(const json::object &filter);
+
+	compiled(const json::object &filter);
+	compiled(compiled &&) = delete;
+	compiled(const compiled &) = delete;
+};
+
 /// 5.1 "RoomFilter"
 struct ircd::m::room_filter
 :json::tuple
@@ -49,6 +49,15 @@ namespace ircd::m::state
 	using iter_closure = std::function<void (const json::array &, const string_view &)>;
 	using iter_bool_closure = std::function<bool (const json::array &, const string_view &)>;
 
+	// (internal) Called with the id of every node appended by set_node(). The
+	// garbage collector uses this to protect nodes written during a collection.
+	extern id_closure node_written;
+
+	// (internal) While set this is consulted for every node which a compaction
+	// of the state_node column passes over; true drops the node. The garbage
+	// collector sets this for its sweep.
+	extern std::function<bool (const id &)> node_dead;
+
 	int keycmp(const json::array &a, const json::array &b);
 	bool prefix_eq(const json::array &a, const json::array &b);
 	json::array make_key(const mutable_buffer &out, const string_view &type, const string_view &state_key);
@@ -180,6 +180,11 @@ struct ircd::m::vm::opts
 	/// reason to ever adjust this.
 	size_t reserve_index {1024};
 
+	/// Whether the write is recorded in the database journal (WAL). Bulk
+	/// imports which can simply be repeated after a crash may disable this
+	/// and flush the database when finished.
+	bool journal {true};
+
 	/// Mask of faults that are not thrown as exceptions out of eval(). If
 	/// masked, the fault is returned from eval(). By default, the EXISTS
 	/// fault is masked which means existing events won't kill eval loops
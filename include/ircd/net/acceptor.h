@@ -23,6 +23,13 @@ struct ircd::net::listener::acceptor
 
 	static log::log log;
 	static conf::item<milliseconds> timeout;
+	static conf::item<size_t> session_cache_size;
+	static conf::item<seconds> session_timeout;
+	static conf::item<bool> session_tickets;
+	static conf::item<bool> handshake_offload;
+	static conf::item<size_t> handshake_pool_size;
+	static conf::item<bool> handshake_ktls;
+	static ctx::pool handshake_pool;
 
 	std::string name;
 	std::string opts;
@@ -37,11 +44,14 @@ struct ircd::net::listener::acceptor
 	bool interrupting {false};
 	ctx::dock joining;
 
+	void configure_sessions(const json::object &opts);
 	void configure(const json::object &opts);
 
 	// Handshake stack
 	void check_handshake_error(const error_code &ec, socket &);
 	void handshake(const error_code &ec, std::shared_ptr<socket>, std::weak_ptr<acceptor>) noexcept;
+	error_code handshake_offload_step(socket &, const steady_point &deadline);
+	void handshake_offloaded(std::shared_ptr<socket>, std::weak_ptr<acceptor>, steady_point queued);
 
 	// Acceptance stack
 	bool check_accept_error(const error_code &ec, socket &);
@@ -24,6 +24,7 @@ namespace ircd::net::dns
 	using records = vector_view<const rfc1035::record *>;
 	using callback = std::function<void (std::exception_ptr, const hostport &, const records  &)>;
 	using callback_A_one = std::function<void (std::exception_ptr, const hostport &, const rfc1035::record::A &)>;
+	using callback_AAAA_one = std::function<void (std::exception_ptr, const hostport &, const rfc1035::record::AAAA &)>;
 	using callback_SRV_one = std::function<void (std::exception_ptr, const hostport &, const rfc1035::record::SRV &)>;
 	using callback_ipport_one = std::function<void (std::exception_ptr, const hostport &, const ipport &)>;
 
@@ -35,6 +36,7 @@ namespace ircd::net::dns
 	// Callback-based interface
 	void resolve(const hostport &, const opts &, callback);
 	void resolve(const hostport &, const opts &, callback_A_one);
+	void resolve(const hostport &, const opts &, callback_AAAA_one);
 	void resolve(const hostport &, const opts &, callback_SRV_one);
 	void resolve(const hostport &, const opts &, callback_ipport_one);
 
@@ -90,6 +92,10 @@ struct ircd::net::dns::opts
 };
 
 /// (internal) DNS cache
+///
+/// Results are kept in memory and persisted to a local database so the cache
+/// survives a restart. Entries which are still being used are refreshed in
+/// the background before they expire.
 namespace ircd::net::dns::cache
 {
 	using closure = std::function<bool (const string_view &, const rfc1035::record &)>;
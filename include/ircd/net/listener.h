@@ -22,11 +22,14 @@ namespace ircd::net
 struct ircd::net::listener
 {
 	struct acceptor;
+	struct handshake_stats;
 	using callback = std::function<void (const std::shared_ptr<socket> &)>;
 	using proffer = std::function<bool (const ipport &)>;
 
 	IRCD_EXCEPTION(net::error, error)
 
+	static struct handshake_stats handshake_stats;
+
   private:
 	std::shared_ptr<struct acceptor> acceptor;
 
@@ -50,6 +53,21 @@ struct ircd::net::listener
 	friend std::ostream &operator<<(std::ostream &s, const listener &);
 };
 
+/// Counters for server handshakes run on the offload threads. The queue
+/// time is from accept to the start of the handshake on a context.
+struct ircd::net::listener::handshake_stats
+{
+	size_t queued {0};
+	size_t active {0};
+	size_t active_max {0};
+	uint64_t total {0};
+	uint64_t steps {0};
+	uint64_t ktls {0};
+	microseconds queue_total {0};
+	microseconds queue_max {0};
+	microseconds cpu_total {0};
+};
+
 struct ircd::net::listener_udp
 {
 	struct acceptor;
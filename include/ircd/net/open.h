@@ -26,6 +26,21 @@ namespace ircd::net
 	ctx::future<std::shared_ptr<socket>> open(const open_opts &);
 }
 
+/// Client-side TLS session cache. Sessions issued by remote servers are kept
+/// here keyed by the target's common name and port so the next connection
+/// to the same server can resume rather than perform a full handshake.
+namespace ircd::net::session
+{
+	extern conf::item<size_t> max;
+	extern uint64_t offered, resumed, stored;    // monotonic counters
+
+	size_t count();
+	string_view key(const mutable_buffer &, const open_opts &);
+	bool offer(socket &, const open_opts &);
+	void erase(const string_view &key);
+	void clear();
+}
+
 /// Connection options structure. This is provided when making a client
 /// connection with a socket. The structure itself is copied when passed
 /// to open() but for any members that are string_views or pointers they
@@ -38,6 +53,7 @@ struct ircd::net::open_opts
 	static conf::item<bool> default_allow_self_signed;
 	static conf::item<bool> default_allow_self_chain;
 	static conf::item<bool> default_allow_expired;
+	static conf::item<bool> default_session_resume;
 
 	// Get the proper target CN from the options structure
 	friend string_view common_name(const open_opts &);
@@ -100,6 +116,12 @@ struct ircd::net::open_opts
 
 	/// Option to allow expired certificates.
 	bool allow_expired { default_allow_expired };
+
+	/// Option to offer a cached TLS session (ticket or ID) from a previous
+	/// connection to the same common_name and port, and to store the session
+	/// issued by the remote for the next connection. This saves a full
+	/// handshake when links to the same server are reopened.
+	bool session_resume { default_session_resume };
 };
 
 /// Constructor intended to provide implicit conversions (no-brackets required)
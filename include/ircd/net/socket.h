@@ -55,6 +55,8 @@ struct ircd::net::socket
 	bool timer_set {false};                      // boolean lockout
 	bool timedout {false};
 	bool fini {false};
+	bool ktls {false};                           // kernel encrypts egress
+	bool ktls_rx {false};                        // kernel decrypts ingress
 
 	void call_user(const eptr_handler &, const error_code &) noexcept;
 	void call_user(const ec_handler &, const error_code &) noexcept;
@@ -122,7 +124,10 @@ ircd::net::socket::operator()(args&&... a)
 	return this->wait(std::forward<args>(a)...);
 }
 
-/// Yields ircd::ctx until buffers are full.
+/// Yields ircd::ctx until buffers are full. When the kernel owns the record
+/// layer for ingress (ktls_rx) the cleartext is read from the socket
+/// directly; this is the case for all the read suite. A record other than
+/// application data then fails the read (EIO) and with it the connection.
 template<class iov>
 size_t
 ircd::net::socket::read_all(iov&& bufs)
@@ -141,10 +146,15 @@ try
 
 	const size_t ret
 	{
-		asio::async_read(ssl, std::forward<iov>(bufs), completion, yield_context
-		{
-			to_asio{interruption}
-		})
+		ktls_rx?
+			asio::async_read(sd, std::forward<iov>(bufs), completion, yield_context
+			{
+				to_asio{interruption}
+			}):
+			asio::async_read(ssl, std::forward<iov>(bufs), completion, yield_context
+			{
+				to_asio{interruption}
+			})
 	};
 
 	if(!ret)
@@ -176,10 +186,15 @@ try
 
 	const size_t ret
 	{
-		ssl.async_read_some(std::forward<iov>(bufs), yield_context
-		{
-			to_asio{interruption}
-		})
+		ktls_rx?
+			sd.async_read_some(std::forward<iov>(bufs), yield_context
+			{
+				to_asio{interruption}
+			}):
+			ssl.async_read_some(std::forward<iov>(bufs), yield_context
+			{
+				to_asio{interruption}
+			})
 	};
 
 	if(!ret)
@@ -211,7 +226,9 @@ try
 
 	const size_t ret
 	{
-		asio::read(ssl, std::forward<iov>(bufs), completion)
+		ktls_rx?
+			asio::read(sd, std::forward<iov>(bufs), completion):
+			asio::read(ssl, std::forward<iov>(bufs), completion)
 	};
 
 	in.bytes += ret;
@@ -232,7 +249,9 @@ try
 	assert(!blocking(*this));
 	const size_t ret
 	{
-		ssl.read_some(std::forward<iov>(bufs))
+		ktls_rx?
+			sd.read_some(std::forward<iov>(bufs)):
+			ssl.read_some(std::forward<iov>(bufs))
 	};
 
 	in.bytes += ret;
@@ -244,7 +263,9 @@ catch(const boost::system::system_error &e)
 	throw_system_error(e);
 }
 
-/// Yields ircd::ctx until all buffers are sent.
+/// Yields ircd::ctx until all buffers are sent. When the kernel owns the
+/// record layer for egress (ktls) the cleartext is written to the socket
+/// directly; this is the case for all the write suite.
 template<class iov>
 size_t
 ircd::net::socket::write_all(iov&& bufs)
@@ -263,10 +284,15 @@ try
 
 	const size_t ret
 	{
-		asio::async_write(ssl, std::forward<iov>(bufs), completion, yield_context
-		{
-			to_asio{interruption}
-		})
+		ktls?
+			asio::async_write(sd, std::forward<iov>(bufs), completion, yield_context
+			{
+				to_asio{interruption}
+			}):
+			asio::async_write(ssl, std::forward<iov>(bufs), completion, yield_context
+			{
+				to_asio{interruption}
+			})
 	};
 
 	out.bytes += ret;
@@ -292,10 +318,15 @@ try
 
 	const size_t ret
 	{
-		ssl.async_write_some(std::forward<iov>(bufs), yield_context
-		{
-			to_asio{interruption}
-		})
+		ktls?
+			sd.async_write_some(std::forward<iov>(bufs), yield_context
+			{
+				to_asio{interruption}
+			}):
+			ssl.async_write_some(std::forward<iov>(bufs), yield_context
+			{
+				to_asio{interruption}
+			})
 	};
 
 	out.bytes += ret;
@@ -321,7 +352,9 @@ try
 	assert(!blocking(*this));
 	const size_t ret
 	{
-		asio::write(ssl, std::forward<iov>(bufs), completion)
+		ktls?
+			asio::write(sd, std::forward<iov>(bufs), completion):
+			asio::write(ssl, std::forward<iov>(bufs), completion)
 	};
 
 	out.bytes += ret;
@@ -342,7 +375,9 @@ try
 	assert(!blocking(*this));
 	const size_t ret
 	{
-		ssl.write_some(std::forward<iov>(bufs))
+		ktls?
+			sd.write_some(std::forward<iov>(bufs)):
+			ssl.write_some(std::forward<iov>(bufs))
 	};
 
 	out.bytes += ret;
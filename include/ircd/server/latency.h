@@ -0,0 +1,37 @@
+// Matrix Construct
+//
+// Copyright (C) Matrix Construct Developers, Authors & Contributors
+// Copyright (C) 2016-2018 Jason Volk <jason@zemos.net>
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice is present in all copies. The
+// full license for this software is available in the LICENSE file.
+
+#pragma once
+#define HAVE_IRCD_SERVER_LATENCY_H
+
+/// Response time statistics kept for each link and each peer. The head time
+/// is measured from the first byte of a request written to the response head
+/// received; the done time is to the end of the response content. Averages
+/// are exponentially weighted; the histogram counts done times in buckets of
+/// powers of two milliseconds.
+///
+struct ircd::server::latency
+{
+	static constexpr const size_t BUCKETS {16};
+	static conf::item<double> alpha;
+
+	microseconds head_avg {0};
+	microseconds done_avg {0};
+	microseconds done_max {0};
+	microseconds done_total {0};
+	size_t heads {0};
+	size_t dones {0};
+	std::array<size_t, BUCKETS> histogram {{0}};
+
+	static size_t bucket(const microseconds &);
+
+	void head(const microseconds &);
+	void done(const microseconds &);
+};
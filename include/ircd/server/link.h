@@ -17,6 +17,7 @@ struct ircd::server::link
 {
 	static conf::item<size_t> tag_max_default;
 	static conf::item<size_t> tag_commit_max_default;
+	static conf::item<double> stall_factor;
 
 	server::peer *peer;                          ///< backreference to peer
 	std::shared_ptr<net::socket> socket;         ///< link's socket
@@ -26,6 +27,7 @@ struct ircd::server::link
 	bool op_write {false};                       ///< async operation state
 	bool op_read {false};                        ///< async operation state
 	bool exclude {false};                        ///< link is excluded
+	server::latency latency;                     ///< response time stats
 
 	template<class F> size_t accumulate_tags(F&&) const;
 
@@ -78,6 +80,10 @@ struct ircd::server::link
 	size_t tag_committed() const;
 	size_t tag_uncommitted() const;
 
+	// stats for response times
+	bool stalled() const;              // head-of-line tag is overdue
+	microseconds eta() const;          // estimate to complete the queue
+
 	// request panel
 	void cancel_uncommitted(std::exception_ptr);
 	void cancel_committed(std::exception_ptr);
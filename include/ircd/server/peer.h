@@ -26,6 +26,7 @@ struct ircd::server::peer
 	static conf::item<size_t> link_min_default;
 	static conf::item<size_t> link_max_default;
 	static conf::item<seconds> error_clear_default;
+	static conf::item<milliseconds> link_eta_max;
 
 	net::ipport remote;
 	std::string hostcanon;
@@ -36,6 +37,8 @@ struct ircd::server::peer
 	std::string server_name;
 	size_t write_bytes {0};
 	size_t read_bytes {0};
+	size_t errors {0};
+	server::latency latency;
 	bool op_resolve {false};
 	bool op_fini {false};
 
@@ -50,7 +53,7 @@ struct ircd::server::peer
 	void disperse(link &);
 	void del(link &);
 
-	void handle_head_recv(const link &, const tag &, const http::response::head &);
+	void handle_head_recv(link &, const tag &, const http::response::head &);
 	void handle_link_done(link &);
 	void handle_tag_done(link &, tag &) noexcept;
 	void handle_finished(link &);
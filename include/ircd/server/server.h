@@ -16,6 +16,7 @@
 namespace ircd::server
 {
 	struct init;
+	struct latency;
 	struct link;
 	struct peer;
 	struct request;
@@ -29,6 +30,7 @@ namespace ircd::server
 	extern log::log log;
 }
 
+#include "latency.h"
 #include "tag.h"
 #include "request.h"
 #include "link.h"
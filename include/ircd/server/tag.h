@@ -36,6 +36,8 @@ struct ircd::server::tag
 		size_t chunk_read {0};         // content read after last chunk head
 		size_t chunk_length {0};       // -1 for chunk header mode
 		http::code status {(http::code)0};
+		steady_point started;          // first byte written
+		steady_point head_recv;        // response head received
 	}
 	state;
 	ctx::promise<http::code> p;
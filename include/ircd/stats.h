@@ -0,0 +1,167 @@
+// Matrix Construct
+//
+// Copyright (C) Matrix Construct Developers, Authors & Contributors
+// Copyright (C) 2016-2018 Jason Volk <jason@zemos.net>
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice is present in all copies. The
+// full license for this software is available in the LICENSE file.
+
+#pragma once
+#define HAVE_IRCD_STATS_H
+
+/// Metrics registry. Items register themselves on construction the same way
+/// conf items do and are exposed together in the Prometheus text format by
+/// expose(). Names are dotted like conf item names and underscored on the way
+/// out; items sharing a name form one family distinguished by their labels.
+///
+/// Items are plain values updated in place without synchronization; they
+/// are only to be updated from the main thread. Stats which are already kept
+/// elsewhere (per context, per peer, per column) are not duplicated; instead
+/// a collector reads them when the registry is exposed, which adds nothing
+/// to the paths maintaining them.
+///
+namespace ircd::stats
+{
+	struct item;
+	struct counter;
+	struct gauge;
+	struct histogram;
+	struct collector;
+	struct writer;
+
+	IRCD_EXCEPTION(ircd::error, error)
+
+	void expose(std::ostream &);
+}
+
+/// Base of all metrics. The feature is the members given at construction:
+/// "name" and "help" are required; "labels" is an optional object.
+struct ircd::stats::item
+:instance_list<item>
+{
+	static constexpr const size_t NAME_MAX_LEN {127};
+
+	json::strung feature_;
+	json::object feature;
+	string_view name;
+	string_view help;
+	json::object labels;
+
+	virtual string_view type() const = 0;
+	virtual void write(const writer &) const = 0;
+
+	item(const json::members &);
+	item(item &&) = delete;
+	item(const item &) = delete;
+	virtual ~item() noexcept;
+};
+
+/// Monotonic count.
+struct ircd::stats::counter
+:item
+{
+	uint64_t value {0};
+
+	string_view type() const override;
+	void write(const writer &) const override;
+
+	counter &operator++()                        { ++value; return *this;         }
+	counter &operator+=(const uint64_t &v)       { value += v; return *this;      }
+
+	using item::item;
+};
+
+/// Value which can go up and down. When constructed with a closure the value
+/// is read from it on exposition instead.
+struct ircd::stats::gauge
+:item
+{
+	using closure = std::function<double ()>;
+
+	double value {0};
+	closure fetch;
+
+	string_view type() const override;
+	void write(const writer &) const override;
+
+	gauge &operator=(const double &v)            { value = v; return *this;       }
+
+	gauge(const json::members &, closure = {});
+};
+
+/// Distribution of observations into buckets of powers of two. Bucket i
+/// counts observations no greater than 2^i units; the last bucket counts
+/// everything beyond. Observations are integers in the histogram's unit; the
+/// "scale" feature converts that unit to the exposed base unit (e.g. 1e-6
+/// for an observation in microseconds exposed in seconds).
+struct ircd::stats::histogram
+:item
+{
+	static constexpr const size_t BUCKETS {32};
+
+	double scale;
+	std::array<size_t, BUCKETS> bucket {{0}};
+	uint64_t sum {0};
+
+	string_view type() const override;
+	void write(const writer &) const override;
+
+	static size_t bucket_for(const uint64_t &);
+	void operator()(const uint64_t &);
+	void operator()(const microseconds &);
+
+	histogram(const json::members &);
+};
+
+/// A family produced on exposition by a closure. The "type" feature gives
+/// the family's type for the closure's samples.
+struct ircd::stats::collector
+:item
+{
+	using closure = std::function<void (const writer &)>;
+
+	closure fetch;
+
+	string_view type() const override;
+	void write(const writer &) const override;
+
+	collector(const json::members &, closure);
+};
+
+/// Formats samples of one family into the exposition.
+struct ircd::stats::writer
+{
+	std::ostream &out;
+	string_view name;
+
+	void operator()(const json::object &labels, const double &value, const string_view &suffix = {}) const;
+	void operator()(const json::members &labels, const double &value, const string_view &suffix = {}) const;
+	void operator()(const json::object &labels, const vector_view<const size_t> &buckets, const double &bound, const double &sum) const;
+	void operator()(const json::members &labels, const vector_view<const size_t> &buckets, const double &bound, const double &sum) const;
+};
+
+inline void
+ircd::stats::histogram::operator()(const uint64_t &value)
+{
+	++bucket[bucket_for(value)];
+	sum += value;
+}
+
+inline void
+ircd::stats::histogram::operator()(const microseconds &value)
+{
+	operator()(uint64_t(value.count()));
+}
+
+inline size_t
+ircd::stats::histogram::bucket_for(const uint64_t &value)
+{
+	const size_t ret
+	{
+		value > 1? size_t(64 - __builtin_clzll(value - 1)) : 0UL
+	};
+
+	return std::min(ret, BUCKETS - 1);
+}
@@ -76,6 +76,7 @@ extern "C"
 #include <RB_INC_LIST
 #include <RB_INC_FORWARD_LIST
 #include <RB_INC_UNORDERED_MAP
+#include <RB_INC_UNORDERED_SET
 #include <RB_INC_DEQUE
 #include <RB_INC_QUEUE
 #include <RB_INC_SSTREAM
@@ -8,9 +8,7 @@
 // copyright notice and this permission notice is present in all copies. The
 // full license for this software is available in the LICENSE file.
 
-#include <boost/archive/iterators/base64_from_binary.hpp>
-#include <boost/archive/iterators/binary_from_base64.hpp>
-#include <boost/archive/iterators/transform_width.hpp>
+#include <RB_INC_X86INTRIN_H
 
 ircd::string_view
 ircd::b58tob64_unpadded(const mutable_buffer &out,
@@ -63,8 +61,56 @@ namespace ircd
 
 	using _b64_encoder = std::function<string_view (const mutable_buffer &, const const_buffer &)>;
 	static std::string _b64encode(const const_buffer &in, const _b64_encoder &);
+
+	// Block codecs return the length of the input consumed; the scalar
+	// codecs finish the remainder.
+	using _b64_encode_block = size_t (*)(char *, const uint8_t *, const size_t);
+	using _b64_decode_block = size_t (*)(uint8_t *, const size_t, const char *, const size_t);
+
+	static size_t _b64encode_none(char *, const uint8_t *, const size_t);
+	static size_t _b64decode_none(uint8_t *, const size_t, const char *, const size_t);
+	static char *_b64encode_scalar(char *out, const uint8_t *in, const uint8_t *const stop);
+	static uint8_t *_b64decode_scalar(uint8_t *out, const char *in, const char *const stop);
+	static _b64_encode_block _b64encode_select();
+	static _b64_decode_block _b64decode_select();
+
+	extern const char _b64_tab_[64];
+	extern const std::array<int8_t, 256> _b64_rtab_;
 }
 
+#if defined(HAVE_X86INTRIN_H) && defined(__SSE2__)
+namespace ircd
+{
+	__attribute__((target("ssse3"))) static __m128i _b64encode_ssse3_lookup(const __m128i);
+	__attribute__((target("ssse3"))) static size_t _b64encode_ssse3(char *, const uint8_t *, const size_t);
+	__attribute__((target("ssse3"))) static size_t _b64decode_ssse3(uint8_t *, const size_t, const char *, const size_t);
+	__attribute__((target("avx2"))) static __m256i _b64encode_avx2_lookup(const __m256i);
+	__attribute__((target("avx2"))) static size_t _b64encode_avx2(char *, const uint8_t *, const size_t);
+	__attribute__((target("avx2"))) static size_t _b64decode_avx2(uint8_t *, const size_t, const char *, const size_t);
+}
+#endif
+
+decltype(ircd::_b64_tab_)
+ircd::_b64_tab_
+{
+	'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H', 'I', 'J', 'K', 'L', 'M',
+	'N', 'O', 'P', 'Q', 'R', 'S', 'T', 'U', 'V', 'W', 'X', 'Y', 'Z',
+	'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j', 'k', 'l', 'm',
+	'n', 'o', 'p', 'q', 'r', 's', 't', 'u', 'v', 'w', 'x', 'y', 'z',
+	'0', '1', '2', '3', '4', '5', '6', '7', '8', '9', '+', '/',
+};
+
+decltype(ircd::_b64_rtab_)
+ircd::_b64_rtab_{[]
+{
+	std::array<int8_t, 256> ret;
+	ret.fill(-1);
+	for(size_t i(0); i < 64; ++i)
+		ret[uint8_t(_b64_tab_[i])] = i;
+
+	return ret;
+}()};
+
 /// Allocate and return a string without padding from the encoding of in
 std::string
 ircd::b64encode_unpadded(const const_buffer &in)
@@ -136,18 +182,30 @@ ircd::string_view
 ircd::b64encode_unpadded(const mutable_buffer &out,
                          const const_buffer &in)
 {
-	namespace iterators = boost::archive::iterators;
-	using transform = iterators::transform_width<unsigned char *, 6, 8>;
-	using b64fb = iterators::base64_from_binary<transform>;
+	static const _b64_encode_block encode_block
+	{
+		_b64encode_select()
+	};
 
 	const auto cpsz
 	{
 		std::min(size(in), size_t(size(out) * (3.0 / 4.0)))
 	};
 
+	const auto src
+	{
+		reinterpret_cast<const uint8_t *>(data(in))
+	};
+
+	const size_t block
+	{
+		encode_block(data(out), src, cpsz)
+	};
+
+	assert(block % 3 == 0);
 	const auto end
 	{
-		std::copy(b64fb(data(in)), b64fb(data(in) + cpsz), begin(out))
+		_b64encode_scalar(data(out) + block / 3 * 4, src + block, src + cpsz)
 	};
 
 	const auto len
@@ -190,37 +248,377 @@ ircd::const_buffer
 ircd::b64decode(const mutable_buffer &out,
                 const string_view &in)
 {
-	namespace iterators = boost::archive::iterators;
-	using b64bf = iterators::binary_from_base64<const char *>;
-	using transform = iterators::transform_width<b64bf, 8, 6>;
+	static const _b64_decode_block decode_block
+	{
+		_b64decode_select()
+	};
 
 	const auto pads
 	{
 		endswith_count(in, _b64_pad_)
 	};
 
+	// Truncated to what fits in out; each 4 characters are 3 bytes.
+	const size_t cpsz
+	{
+		std::min(size(in) - pads, size(out) / 3 * 4 + (size(out) % 3? size(out) % 3 + 1 : 0))
+	};
+
+	const auto dst
+	{
+		reinterpret_cast<uint8_t *>(data(out))
+	};
+
+	const size_t block
+	{
+		decode_block(dst, size(out), data(in), cpsz)
+	};
+
+	assert(block % 4 == 0);
 	const auto e
 	{
-		std::copy(transform(begin(in)), transform(begin(in) + size(in) - pads), begin(out))
+		_b64decode_scalar(dst + block / 4 * 3, data(in) + block, data(in) + cpsz)
 	};
 
 	const auto len
 	{
-		std::distance(begin(out), e)
+		std::distance(dst, e)
 	};
 
 	assert(size_t(len) <= size(out));
 	return { data(out), size_t(len) };
 }
 
+char *
+ircd::_b64encode_scalar(char *out,
+                        const uint8_t *in,
+                        const uint8_t *const stop)
+{
+	for(; in + 3 <= stop; in += 3, out += 4)
+	{
+		const uint32_t v(in[0] << 16 | in[1] << 8 | in[2]);
+		out[0] = _b64_tab_[(v >> 18) & 0x3f];
+		out[1] = _b64_tab_[(v >> 12) & 0x3f];
+		out[2] = _b64_tab_[(v >> 6) & 0x3f];
+		out[3] = _b64_tab_[v & 0x3f];
+	}
+
+	switch(stop - in)
+	{
+		case 2:
+			*out++ = _b64_tab_[in[0] >> 2];
+			*out++ = _b64_tab_[(in[0] & 0x03) << 4 | in[1] >> 4];
+			*out++ = _b64_tab_[(in[1] & 0x0f) << 2];
+			break;
+
+		case 1:
+			*out++ = _b64_tab_[in[0] >> 2];
+			*out++ = _b64_tab_[(in[0] & 0x03) << 4];
+			break;
+	}
+
+	return out;
+}
+
+/// A trailing partial group yields only its whole bytes (i.e. 2 characters
+/// are 1 byte, 3 are 2, and 1 is none).
+uint8_t *
+ircd::_b64decode_scalar(uint8_t *out,
+                        const char *in,
+                        const char *const stop)
+{
+	const auto val{[](const char &c) -> uint32_t
+	{
+		const auto ret(_b64_rtab_[uint8_t(c)]);
+		if(unlikely(ret < 0))
+			throw std::out_of_range("Invalid base64 character");
+
+		return ret;
+	}};
+
+	for(; in + 4 <= stop; in += 4, out += 3)
+	{
+		const uint32_t v
+		{
+			val(in[0]) << 18 | val(in[1]) << 12 | val(in[2]) << 6 | val(in[3])
+		};
+
+		out[0] = v >> 16;
+		out[1] = v >> 8;
+		out[2] = v;
+	}
+
+	uint32_t v(0);
+	switch(stop - in)
+	{
+		case 3:
+			v = val(in[0]) << 18 | val(in[1]) << 12 | val(in[2]) << 6;
+			*out++ = v >> 16;
+			*out++ = v >> 8;
+			break;
+
+		case 2:
+			v = val(in[0]) << 18 | val(in[1]) << 12;
+			*out++ = v >> 16;
+			break;
+
+		case 1:
+			val(in[0]);
+			break;
+	}
+
+	return out;
+}
+
+size_t
+ircd::_b64encode_none(char *,
+                      const uint8_t *,
+                      const size_t)
+{
+	return 0;
+}
+
+size_t
+ircd::_b64decode_none(uint8_t *,
+                      const size_t,
+                      const char *,
+                      const size_t)
+{
+	return 0;
+}
+
+#if defined(HAVE_X86INTRIN_H) && defined(__SSE2__)
+
+/// Selected once at first use, which may be during static initialization.
+ircd::_b64_encode_block
+ircd::_b64encode_select()
+{
+	__builtin_cpu_init();
+	return
+		__builtin_cpu_supports("avx2")? _b64encode_avx2:
+		__builtin_cpu_supports("ssse3")? _b64encode_ssse3:
+		_b64encode_none;
+}
+
+ircd::_b64_decode_block
+ircd::_b64decode_select()
+{
+	__builtin_cpu_init();
+	return
+		__builtin_cpu_supports("avx2")? _b64decode_avx2:
+		__builtin_cpu_supports("ssse3")? _b64decode_ssse3:
+		_b64decode_none;
+}
+
+/// The 12 bytes at the front of each lane are spread into 16 groups of 6
+/// bits; the lookup maps each group to its character by adding the offset
+/// of its range in the alphabet (W. Mula's method).
+__attribute__((target("avx2")))
+size_t
+ircd::_b64encode_avx2(char *const out,
+                      const uint8_t *const in,
+                      const size_t len)
+{
+	const __m256i shuf(_mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+	                                    1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+	size_t i(0), o(0);
+	for(; i + 12 + 16 <= len; i += 24, o += 32)
+	{
+		const __m128i lo(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i)));
+		const __m128i hi(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i + 12)));
+		__m256i v(_mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1));
+		v = _mm256_shuffle_epi8(v, shuf);
+		const __m256i t0(_mm256_and_si256(v, _mm256_set1_epi32(0x0fc0fc00)));
+		const __m256i t1(_mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040)));
+		const __m256i t2(_mm256_and_si256(v, _mm256_set1_epi32(0x003f03f0)));
+		const __m256i t3(_mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010)));
+		const __m256i idx(_mm256_or_si256(t1, t3));
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(out + o), _b64encode_avx2_lookup(idx));
+	}
+
+	return i;
+}
+
+__attribute__((target("avx2")))
+__m256i
+ircd::_b64encode_avx2_lookup(const __m256i idx)
+{
+	const __m256i offsets(_mm256_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+	                                       '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+	                                       '/' - 63, 'A', 0, 0,
+	                                       'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+	                                       '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+	                                       '/' - 63, 'A', 0, 0));
+
+	__m256i range(_mm256_subs_epu8(idx, _mm256_set1_epi8(51)));
+	const __m256i upper(_mm256_cmpgt_epi8(_mm256_set1_epi8(26), idx));
+	range = _mm256_or_si256(range, _mm256_and_si256(upper, _mm256_set1_epi8(13)));
+	return _mm256_add_epi8(idx, _mm256_shuffle_epi8(offsets, range));
+}
+
+/// Each character is classified by its nibbles to validate it and find the
+/// offset mapping it back to its 6 bits; the groups are then packed into 12
+/// bytes per lane (W. Mula & D. Lemire's method). A block with an invalid
+/// character is left for the scalar codec to report.
+__attribute__((target("avx2")))
+size_t
+ircd::_b64decode_avx2(uint8_t *const out,
+                      const size_t max,
+                      const char *const in,
+                      const size_t len)
+{
+	const __m256i lut_lo(_mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+	                                      0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a,
+	                                      0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+	                                      0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a));
+	const __m256i lut_hi(_mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+	                                      0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+	                                      0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+	                                      0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10));
+	const __m256i lut_roll(_mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+	                                        0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0));
+	const __m256i pack(_mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+	                                    2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+	const __m256i perm(_mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+	const __m256i nibble(_mm256_set1_epi8(0x0f));
+	size_t i(0), o(0);
+	for(; i + 32 <= len && o + 32 <= max; i += 32, o += 24)
+	{
+		const __m256i v(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i)));
+		const __m256i hi(_mm256_and_si256(_mm256_srli_epi32(v, 4), nibble));
+		const __m256i lo(_mm256_and_si256(v, nibble));
+		const __m256i check(_mm256_and_si256(_mm256_shuffle_epi8(lut_lo, lo), _mm256_shuffle_epi8(lut_hi, hi)));
+		if(!_mm256_testz_si256(check, check))
+			break;
+
+		const __m256i slash(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('/')));
+		const __m256i roll(_mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(slash, hi)));
+		const __m256i bits(_mm256_add_epi8(v, roll));
+		const __m256i ab_bc(_mm256_maddubs_epi16(bits, _mm256_set1_epi32(0x01400140)));
+		const __m256i abc(_mm256_madd_epi16(ab_bc, _mm256_set1_epi32(0x00011000)));
+		const __m256i packed(_mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(abc, pack), perm));
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(out + o), packed);
+	}
+
+	return i;
+}
+
+__attribute__((target("ssse3")))
+size_t
+ircd::_b64encode_ssse3(char *const out,
+                       const uint8_t *const in,
+                       const size_t len)
+{
+	const __m128i shuf(_mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+	size_t i(0), o(0);
+	for(; i + 16 <= len; i += 12, o += 16)
+	{
+		__m128i v(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i)));
+		v = _mm_shuffle_epi8(v, shuf);
+		const __m128i t0(_mm_and_si128(v, _mm_set1_epi32(0x0fc0fc00)));
+		const __m128i t1(_mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040)));
+		const __m128i t2(_mm_and_si128(v, _mm_set1_epi32(0x003f03f0)));
+		const __m128i t3(_mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010)));
+		const __m128i idx(_mm_or_si128(t1, t3));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(out + o), _b64encode_ssse3_lookup(idx));
+	}
+
+	return i;
+}
+
+__attribute__((target("ssse3")))
+__m128i
+ircd::_b64encode_ssse3_lookup(const __m128i idx)
+{
+	const __m128i offsets(_mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+	                                    '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+	                                    '/' - 63, 'A', 0, 0));
+
+	__m128i range(_mm_subs_epu8(idx, _mm_set1_epi8(51)));
+	const __m128i upper(_mm_cmpgt_epi8(_mm_set1_epi8(26), idx));
+	range = _mm_or_si128(range, _mm_and_si128(upper, _mm_set1_epi8(13)));
+	return _mm_add_epi8(idx, _mm_shuffle_epi8(offsets, range));
+}
+
+__attribute__((target("ssse3")))
+size_t
+ircd::_b64decode_ssse3(uint8_t *const out,
+                       const size_t max,
+                       const char *const in,
+                       const size_t len)
+{
+	const __m128i lut_lo(_mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+	                                   0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a));
+	const __m128i lut_hi(_mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+	                                   0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10));
+	const __m128i lut_roll(_mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0));
+	const __m128i pack(_mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+	const __m128i nibble(_mm_set1_epi8(0x0f));
+	size_t i(0), o(0);
+	for(; i + 16 <= len && o + 16 <= max; i += 16, o += 12)
+	{
+		const __m128i v(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i)));
+		const __m128i hi(_mm_and_si128(_mm_srli_epi32(v, 4), nibble));
+		const __m128i lo(_mm_and_si128(v, nibble));
+		const __m128i check(_mm_and_si128(_mm_shuffle_epi8(lut_lo, lo), _mm_shuffle_epi8(lut_hi, hi)));
+		if(_mm_movemask_epi8(_mm_cmpeq_epi8(check, _mm_setzero_si128())) != 0xffff)
+			break;
+
+		const __m128i slash(_mm_cmpeq_epi8(v, _mm_set1_epi8('/')));
+		const __m128i roll(_mm_shuffle_epi8(lut_roll, _mm_add_epi8(slash, hi)));
+		const __m128i bits(_mm_add_epi8(v, roll));
+		const __m128i ab_bc(_mm_maddubs_epi16(bits, _mm_set1_epi32(0x01400140)));
+		const __m128i abc(_mm_madd_epi16(ab_bc, _mm_set1_epi32(0x00011000)));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(out + o), _mm_shuffle_epi8(abc, pack));
+	}
+
+	return i;
+}
+
+#else // HAVE_X86INTRIN_H && __SSE2__
+
+ircd::_b64_encode_block
+ircd::_b64encode_select()
+{
+	return _b64encode_none;
+}
+
+ircd::_b64_decode_block
+ircd::_b64decode_select()
+{
+	return _b64decode_none;
+}
+
+#endif // HAVE_X86INTRIN_H && __SSE2__
+
 namespace ircd
 {
 	const auto &b58
 	{
 		"123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz"s
 	};
+
+	// The number is held in 32-bit limbs (least significant first) which are
+	// either base 58^5 or base 2^32; the input is consumed a limb at a time so
+	// the quadratic term is a fifth (or a quarter) of the byte-wise method in
+	// each dimension.
+	constexpr const uint32_t _b58_limb_base_ {656356768}; // 58^5
+	constexpr const size_t _b58_limbs_stack_ {64};
+
+	extern const std::array<int8_t, 256> _b58_rtab_;
 }
 
+decltype(ircd::_b58_rtab_)
+ircd::_b58_rtab_{[]
+{
+	std::array<int8_t, 256> ret;
+	ret.fill(-1);
+	for(size_t i(0); i < b58.size(); ++i)
+		ret[uint8_t(b58[i])] = i;
+
+	return ret;
+}()};
+
 std::string
 ircd::b58decode(const string_view &in)
 {
@@ -249,34 +647,61 @@ ircd::b58decode(const mutable_buffer &buf,
 	for(; p != end(in) && *p == '1'; ++p)
 		++zeroes;
 
-	const mutable_buffer out
+	const size_t max
 	{
-		data(buf) + zeroes, std::min(b58decode_size(in), size(buf) - zeroes)
+		b58decode_size(in) / 4 + 1
 	};
 
-	assert(size(out) + zeroes <= size(buf));
-	memset(data(out), 0, size(out));
+	uint32_t stack_limb[_b58_limbs_stack_];
+	const std::unique_ptr<uint32_t[]> heap_limb
+	{
+		max > _b58_limbs_stack_? new uint32_t[max] : nullptr
+	};
 
+	uint32_t *const limb
+	{
+		heap_limb? heap_limb.get() : stack_limb
+	};
+
+	// Groups of five characters; the first group takes the remainder.
 	size_t length(0);
-	for(size_t i(0); p != end(in); ++p, length = i, i = 0)
+	for(size_t g(size_t(std::distance(p, end(in))) % 5 ?: 5); p != end(in); p += g, g = 5)
 	{
-		auto carry(b58.find(*p));
-		if(carry == std::string::npos)
-			throw std::out_of_range("Invalid base58 character");
+		uint64_t mult(1), carry(0);
+		for(size_t i(0); i < g; ++i)
+		{
+			const auto val(_b58_rtab_[uint8_t(p[i])]);
+			if(unlikely(val < 0))
+				throw std::out_of_range("Invalid base58 character");
 
-		for(auto it(rbegin(out)); (carry || i < length) && it != rend(out); ++it, i++)
+			carry = carry * 58 + val;
+			mult *= 58;
+		}
+
+		for(size_t i(0); i < length; ++i)
 		{
-			carry += 58 * (*it);
-			*it = carry % 256;
-			carry /= 256;
+			carry += limb[i] * mult;
+			limb[i] = uint32_t(carry);
+			carry >>= 32;
+		}
+
+		for(; carry; carry >>= 32)
+		{
+			assert(length < max);
+			limb[length++] = uint32_t(carry);
 		}
 	}
 
+	size_t bytes(length * 4);
+	for(; bytes && !(limb[(bytes - 1) / 4] >> ((bytes - 1) % 4 * 8) & 0xff); --bytes);
+
 	auto it(begin(buf));
-	assert(it + zeroes + length <= end(buf));
+	assert(it + zeroes + bytes <= end(buf));
 	for(; it != end(buf) && zeroes; *it++ = 0, --zeroes);
-	memmove(it, data(out) + (size(out) - length), length);
-	return { begin(buf), it + length };
+	for(; it != end(buf) && bytes; --bytes)
+		*it++ = limb[(bytes - 1) / 4] >> ((bytes - 1) % 4 * 8);
+
+	return { begin(buf), it };
 }
 
 std::string
@@ -298,6 +723,82 @@ ircd::b58encode(const mutable_buffer &buf,
 	for(; p != end(in) && *p == 0; ++p)
 		++zeroes;
 
+	const size_t max
+	{
+		b58encode_size(in) / 5 + 1
+	};
+
+	uint32_t stack_limb[_b58_limbs_stack_];
+	const std::unique_ptr<uint32_t[]> heap_limb
+	{
+		max > _b58_limbs_stack_? new uint32_t[max] : nullptr
+	};
+
+	uint32_t *const limb
+	{
+		heap_limb? heap_limb.get() : stack_limb
+	};
+
+	// Big-endian words of four bytes; the first word takes the remainder.
+	size_t length(0);
+	for(size_t g(size_t(std::distance(p, end(in))) % 4 ?: 4); p != end(in); p += g, g = 4)
+	{
+		uint64_t carry(0);
+		for(size_t i(0); i < g; ++i)
+			carry = carry << 8 | uint8_t(p[i]);
+
+		const auto shift(g * 8);
+		for(size_t i(0); i < length; ++i)
+		{
+			carry += uint64_t(limb[i]) << shift;
+			limb[i] = carry % _b58_limb_base_;
+			carry /= _b58_limb_base_;
+		}
+
+		for(; carry; carry /= _b58_limb_base_)
+		{
+			assert(length < max);
+			limb[length++] = carry % _b58_limb_base_;
+		}
+	}
+
+	// Every limb is five digits except the most significant.
+	size_t digits(length * 5);
+	for(uint32_t top(length? limb[length - 1] : 1), div(_b58_limb_base_ / 58); digits && top < div; div /= 58)
+		--digits;
+
+	auto it(begin(buf));
+	assert(it + zeroes + digits <= end(buf));
+	for(; it != end(buf) && zeroes; *it++ = '1', --zeroes);
+
+	const size_t len
+	{
+		std::min(digits, size_t(std::distance(it, end(buf))))
+	};
+
+	for(size_t i(0), j(0); i < length && j < digits; ++i)
+		for(uint32_t val(limb[i]), k(0); k < 5 && j < digits; ++k, ++j, val /= 58)
+			if(digits - j - 1 < len)
+				it[digits - j - 1] = b58[val % 58];
+
+	return { begin(buf), it + len };
+}
+
+/// The encoding of the original implementation, which widened each input
+/// byte from a plain char: where char is signed, bytes from 0x80 were
+/// sign-extended and the result is not the base58 of the input (nor can it
+/// be decoded). Identifiers derived from a hash with it (the server key ID,
+/// the user, node and media room IDs) are persistent, so their derivations
+/// keep using it to remain byte-compatible. Anything new wants b58encode().
+ircd::string_view
+ircd::b58encode_compat(const mutable_buffer &buf,
+                       const const_buffer &in)
+{
+	auto p(begin(in));
+	size_t zeroes(0);
+	for(; p != end(in) && *p == 0; ++p)
+		++zeroes;
+
 	const mutable_buffer out
 	{
 		data(buf) + zeroes, std::min(b58encode_size(in), size(buf) - zeroes)
@@ -117,6 +117,62 @@ decltype(ircd::util::instance_multimap<ircd::net::ipport, ircd::client, ircd::ne
 ircd::util::instance_multimap<ircd::net::ipport, ircd::client, ircd::net::ipport::cmp_ip>::map
 {};
 
+//
+// stats
+//
+
+namespace ircd
+{
+	static stats::gauge client_connections
+	{
+		{
+			{ "name",     "ircd.client.connections"     },
+			{ "help",     "Connected clients"           },
+		},
+		[] { return double(client::map.size()); }
+	};
+
+	static stats::collector client_accepted
+	{
+		{
+			{ "name",     "ircd.client.accepted"                 },
+			{ "help",     "Clients accepted since startup"       },
+			{ "type",     "counter"                              },
+		},
+		[](const stats::writer &w)
+		{
+			w(json::object{}, double(client::ctr));
+		}
+	};
+
+	static stats::gauge client_pool_size
+	{
+		{
+			{ "name",     "ircd.client.pool.size"                },
+			{ "help",     "Contexts in the client request pool"  },
+		},
+		[] { return double(client::pool.size()); }
+	};
+
+	static stats::gauge client_pool_active
+	{
+		{
+			{ "name",     "ircd.client.pool.active"              },
+			{ "help",     "Client pool contexts handling a request" },
+		},
+		[] { return double(client::pool.active()); }
+	};
+
+	static stats::gauge client_pool_queued
+	{
+		{
+			{ "name",     "ircd.client.pool.queued"                      },
+			{ "help",     "Client requests waiting for a pool context" },
+		},
+		[] { return double(client::pool.queued()); }
+	};
+}
+
 //
 // init
 //
@@ -813,6 +869,20 @@ try
 		resource[head.method]
 	};
 
+	// Requests from remote servers run below requests from users.
+	const bool federation
+	{
+		startswith(head.path, "/_matrix/federation/") ||
+		startswith(head.path, "/_matrix/key/")
+	};
+
+	const ctx::sched::scope prio
+	{
+		federation?
+			ctx::sched::prio::FEDERATION:
+			ctx::prio(ctx::cur())
+	};
+
 	const string_view content_partial
 	{
 		data(head_buffer) + head_length, content_consumed
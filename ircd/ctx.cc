@@ -9,6 +9,10 @@
 // full license for this software is available in the LICENSE file.
 
 #include <RB_INC_X86INTRIN_H
+#include <RB_INC_SYS_MMAN_H
+#include <RB_INC_SIGNAL_H
+#include <RB_INC_DLFCN_H
+#include <RB_INC_SYS_SYSCALL_H
 #include <cxxabi.h>
 #include <ircd/asio.h>
 #include "ctx.h"
@@ -35,6 +39,9 @@ ircd::ctx::ctx::id_ctr
 };
 
 /// Spawn (internal)
+///
+/// This is boost::asio::spawn(c->strand, ...) except the coroutine is
+/// constructed with our stack allocator; asio offers no way to pass one.
 void
 ircd::ctx::spawn(ctx *const c,
                  context::function func)
@@ -50,13 +57,28 @@ ircd::ctx::spawn(ctx *const c,
 		std::bind(&ctx::operator(), c, ph::_1, std::move(func))
 	};
 
-	boost::asio::spawn(c->strand, std::move(bound), attrs);
+	auto handler
+	{
+		boost::asio::bind_executor(c->strand, &boost::asio::detail::default_spawn_handler)
+	};
+
+	using handler_type = decltype(handler);
+	using function_type = decltype(bound);
+	using spawn_data = boost::asio::detail::spawn_data<handler_type, function_type>;
+
+	stack_pool::spawn_helper<handler_type, function_type> helper;
+	helper.data_.reset(new spawn_data(std::move(handler), true, std::move(bound)));
+	helper.attributes_ = attrs;
+	boost::asio::dispatch(helper);
 }
 
-// linkage for dtor
 ircd::ctx::ctx::~ctx()
 noexcept
 {
+	// A context woken but torn down before resuming would otherwise be
+	// counted as ready forever, holding lower classes in deferral.
+	sched::forget(*this);
+	prof::retire(*this);
 }
 
 /// Base frame for a context.
@@ -187,6 +209,18 @@ ircd::ctx::ctx::wait()
 	assert(current == this);
 	assert(notes == 1);  // notes = 1; set by continuation dtor on wakeup
 
+	// Lower classes give way to higher classes ready to run; any interrupt
+	// received meanwhile is thrown here.
+	// Deferral yields through this function again, which resets the alarm;
+	// the caller's deadline is restored so a timeout isn't lost.
+	if(!sched.deferring && sched.prio != sched::prio::INTERACTIVE)
+	{
+		const auto expires(alarm.expires_at());
+		sched::defer(*this);
+		alarm.expires_at(expires);
+		interruption_point();
+	}
+
 	return true;
 }
 
@@ -211,6 +245,7 @@ bool
 ircd::ctx::ctx::wake()
 try
 {
+	sched::woken(*this);
 	alarm.cancel();
 	return true;
 }
@@ -510,6 +545,28 @@ ircd::ctx::name(const ctx &ctx)
 	return ctx.name;
 }
 
+/// Returns the priority class of `ctx`
+const ircd::ctx::sched::prio &
+ircd::ctx::prio(const ctx &ctx)
+{
+	return ctx.sched.prio;
+}
+
+/// Moves `ctx` to another priority class
+void
+ircd::ctx::prio(ctx &ctx,
+                const sched::prio &prio)
+{
+	// A pending wake is moved to the new class's accounting.
+	const bool woken(ctx.sched.woken != steady_point{});
+	if(woken)
+		--sched::stat.at(uint(ctx.sched.prio)).ready;
+
+	ctx.sched.prio = prio;
+	if(woken)
+		++sched::stat.at(uint(ctx.sched.prio)).ready;
+}
+
 /// Returns a reference to unique ID for `ctx` (which will go away with `ctx`)
 const uint64_t &
 ircd::ctx::id(const ctx &ctx)
@@ -904,6 +961,9 @@ noexcept(false)
 	// Unconditionally reset the notes counter to 1 because we're awake now.
 	self->notes = 1;
 
+	// Account for the time since this context was woken.
+	sched::resumed(*self);
+
 	// Check here if this context's interrupt flag is set. If so, this call
 	// will clear the flag and then throw an exception. Note that this is
 	// a destructor with exceptions permitted to come out of it.
@@ -955,6 +1015,10 @@ ircd::ctx::context::context(const string_view &name,
 	std::make_unique<ctx>(name, stack_sz, flags, ios::get())
 }
 {
+	// A new context inherits the priority class of its spawner.
+	if(current)
+		c->sched.prio = current->sched.prio;
+
 	auto spawn
 	{
 		std::bind(&ircd::ctx::spawn, c.get(), std::move(func))
@@ -1122,15 +1186,23 @@ ircd::ctx::name(const pool &pool)
 	return pool.name;
 }
 
+const ircd::ctx::sched::prio &
+ircd::ctx::prio(const pool &pool)
+{
+	return pool.prio;
+}
+
 //
 // pool::pool
 //
 
 ircd::ctx::pool::pool(const string_view &name,
                       const size_t &stack_size,
-                      const size_t &size)
+                      const size_t &size,
+                      const sched::prio &prio)
 :name{name}
 ,stack_size{stack_size}
+,prio{prio}
 ,running{0}
 ,working{0}
 {
@@ -1197,7 +1269,10 @@ void
 ircd::ctx::pool::add(const size_t &num)
 {
 	for(size_t i(0); i < num; ++i)
+	{
 		ctxs.emplace_back(this->name, stack_size, context::POST, std::bind(&pool::main, this));
+		ircd::ctx::prio(ctxs.back(), this->prio);
+	}
 }
 
 void
@@ -1274,9 +1349,10 @@ ircd::ctx::debug_stats(const pool &pool)
 {
 	log::debug
 	{
-		"pool '%s' (stack size: %zu) total: %zu avail: %zu queued: %zu active: %zu pending: %zu",
+		"pool '%s' (stack size: %zu prio: %s) total: %zu avail: %zu queued: %zu active: %zu pending: %zu",
 		pool.name,
 		pool.stack_size,
+		sched::reflect(pool.prio),
 		pool.size(),
 		pool.avail(),
 		pool.queued(),
@@ -1298,11 +1374,16 @@ namespace ircd::ctx::prof
 	void check_stack();
 	void check_slice();
 	void slice_start();
+	ulong slice_stop();
 
 	void handle_cur_continue();
 	void handle_cur_yield();
 	void handle_cur_leave();
 	void handle_cur_enter();
+
+	extern std::map<std::string, profile, std::less<>> retired;
+	extern stats::histogram slice_cycles;
+	extern stats::collector ctx_cycles, ctx_yields;
 }
 
 // stack_usage_warning at 1/3 engineering tolerance
@@ -1347,6 +1428,62 @@ ircd::ctx::prof::settings::slice_assertion
 	{ "persist",  false                           },
 };
 
+/// Totals of contexts which have exited, by name, so the exported counters
+/// don't go down when a context does.
+decltype(ircd::ctx::prof::retired)
+ircd::ctx::prof::retired;
+
+decltype(ircd::ctx::prof::slice_cycles)
+ircd::ctx::prof::slice_cycles
+{
+	{ "name",     "ircd.ctx.slice.cycles"                    },
+	{ "help",     "Distribution of context time slices (tsc)" },
+};
+
+decltype(ircd::ctx::prof::ctx_cycles)
+ircd::ctx::prof::ctx_cycles
+{
+	{
+		{ "name",     "ircd.ctx.cycles"                        },
+		{ "help",     "Accumulated tsc of contexts by name"    },
+		{ "type",     "counter"                                },
+	},
+	[](const stats::writer &w)
+	{
+		std::map<string_view, ulong> total;
+		for(const auto &p : retired)
+			total[p.first] += p.second.cycles;
+
+		for(const auto *const &c : ctxs)
+			total[name(*c)] += cycles(*c);
+
+		for(const auto &p : total)
+			w({{ "ctx", p.first }}, p.second);
+	}
+};
+
+decltype(ircd::ctx::prof::ctx_yields)
+ircd::ctx::prof::ctx_yields
+{
+	{
+		{ "name",     "ircd.ctx.yields"                           },
+		{ "help",     "Context switches of contexts by name"      },
+		{ "type",     "counter"                                   },
+	},
+	[](const stats::writer &w)
+	{
+		std::map<string_view, uint64_t> total;
+		for(const auto &p : retired)
+			total[p.first] += p.second.yields;
+
+		for(const auto *const &c : ctxs)
+			total[name(*c)] += yields(*c);
+
+		for(const auto &p : total)
+			w({{ "ctx", p.first }}, p.second);
+	}
+};
+
 #ifdef RB_DEBUG
 void
 ircd::ctx::prof::mark(const event &e)
@@ -1361,12 +1498,49 @@ ircd::ctx::prof::mark(const event &e)
 	}
 }
 #else
+/// Release builds keep only the slice accounting (cycles, yields and the
+/// slice histogram); the watchdogs and stack checks are for debug builds.
 void
 ircd::ctx::prof::mark(const event &e)
 {
+	switch(e)
+	{
+		case event::CUR_ENTER:
+		case event::CUR_CONTINUE:
+			slice_start();
+			break;
+
+		case event::CUR_YIELD:
+			cur().profile.yields++;
+			slice_stop();
+			break;
+
+		case event::CUR_LEAVE:
+			slice_stop();
+			break;
+
+		default:
+			break;
+	}
 }
 #endif
 
+void
+ircd::ctx::prof::retire(const ctx &c)
+noexcept
+{
+	auto it
+	{
+		retired.lower_bound(c.name)
+	};
+
+	if(it == end(retired) || it->first != c.name)
+		it = retired.emplace_hint(it, std::string{c.name}, profile{});
+
+	it->second.cycles += c.profile.cycles;
+	it->second.yields += c.profile.yields;
+}
+
 ulong
 ircd::ctx::prof::cur_slice_cycles()
 {
@@ -1419,6 +1593,23 @@ ircd::ctx::prof::slice_start()
 	_slice_start = rdtsc();
 }
 
+/// Accounts the slice which is ending to the current context; returns its
+/// length.
+ulong
+ircd::ctx::prof::slice_stop()
+{
+	auto &c(cur());
+	const auto last_cycles
+	{
+		cur_slice_cycles()
+	};
+
+	c.profile.cycles += last_cycles;
+	_slice_total += last_cycles;
+	slice_cycles(last_cycles);
+	return last_cycles;
+}
+
 void
 ircd::ctx::prof::check_slice()
 {
@@ -1428,14 +1619,11 @@ ircd::ctx::prof::check_slice()
 		c.flags & context::SLICE_EXEMPT
 	};
 
-	const auto &last_cycles
+	const auto last_cycles
 	{
-		cur_slice_cycles()
+		slice_stop()
 	};
 
-	c.profile.cycles += last_cycles;
-	_slice_total += last_cycles;
-
 	const ulong &slice_warning(settings::slice_warning);
 	if(unlikely(slice_warning > 0 && last_cycles >= slice_warning && !slice_exempt))
 		log::dwarning
@@ -1513,6 +1701,739 @@ ircd::ctx::prof::rdtsc()
 }
 #endif
 
+//
+// prof::sample
+//
+
+namespace ircd::ctx::prof::sample
+{
+	struct slot;
+
+	static constexpr const size_t DEPTH {48};
+	static constexpr const size_t NAME_LEN {31};
+	static constexpr const size_t ALTSTACK_SIZE {64_KiB};
+	static constexpr const size_t HZ_MAX {10000};
+
+	std::unique_ptr<slot[]> ring;
+	size_t ring_max;
+	std::atomic<size_t> head;
+	std::atomic<bool> active;
+	uintptr_t main_stack[2];
+	std::unique_ptr<char[]> altstack;
+	stack_t altstack_prev;
+	timer_t timerid;
+
+	static void handle(int, siginfo_t *, void *) noexcept;
+	static size_t walk(void **, const uintptr_t &pc, uintptr_t fp, const uintptr_t &lo, const uintptr_t &hi) noexcept;
+	static string_view symbolize(const mutable_buffer &, const void *const &);
+}
+
+/// A ring entry. The signal handler writes entries while the main thread
+/// may be reading them in dump() underneath it; seq is odd while an entry
+/// is being written, so the reader discards any entry that changed during
+/// its copy.
+struct ircd::ctx::prof::sample::slot
+{
+	std::atomic<uint32_t> seq {0};
+	uint32_t depth {0};
+	char name[NAME_LEN + 1] {0};
+	void *frame[DEPTH];
+};
+
+decltype(ircd::ctx::prof::sample::hz)
+ircd::ctx::prof::sample::hz
+{
+	{ "name",     "ircd.ctx.prof.sample.hz" },
+	{ "default",  99L                       },
+};
+
+decltype(ircd::ctx::prof::sample::ring_size)
+ircd::ctx::prof::sample::ring_size
+{
+	{ "name",     "ircd.ctx.prof.sample.ring_size" },
+	{ "default",  32768L                           },
+};
+
+#if defined(HAVE_SIGNAL_H) && defined(__linux__)
+
+// Older glibc only exposes the union member.
+#ifndef sigev_notify_thread_id
+	#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+/// Starts sampling the main thread with a wall-clock timer. Samples are taken
+/// whether or not a context is running, so time the reactor spends idle in
+/// the kernel is attributed to "main" rather than disappearing.
+void
+ircd::ctx::prof::sample::start()
+{
+	assert_main_thread();
+	if(running())
+		return;
+
+	ring_max = std::max(size_t(ring_size), 1UL);
+	ring.reset(new slot[ring_max]);
+	head.store(0, std::memory_order_relaxed);
+
+	pthread_attr_t attr;
+	void *stack_addr {nullptr};
+	size_t stack_size {0};
+	if(::pthread_getattr_np(::pthread_self(), &attr) == 0)
+	{
+		::pthread_attr_getstack(&attr, &stack_addr, &stack_size);
+		::pthread_attr_destroy(&attr);
+	}
+
+	main_stack[0] = uintptr_t(stack_addr);
+	main_stack[1] = uintptr_t(stack_addr) + stack_size;
+
+	// The signal can land while a context is near the bottom of its own
+	// small stack; the handler runs on a dedicated stack of the sampled
+	// thread instead so it can never overflow the context's.
+	altstack.reset(new char[ALTSTACK_SIZE]);
+	stack_t ss {0};
+	ss.ss_sp = altstack.get();
+	ss.ss_size = ALTSTACK_SIZE;
+	ss.ss_flags = 0;
+	syscall(::sigaltstack, &ss, &altstack_prev);
+
+	struct sigaction sa {0};
+	sa.sa_sigaction = handle;
+	sa.sa_flags = SA_SIGINFO | SA_RESTART | SA_ONSTACK;
+	sigemptyset(&sa.sa_mask);
+	syscall(::sigaction, SIGPROF, &sa, nullptr);
+
+	struct sigevent sev {0};
+	sev.sigev_notify = SIGEV_THREAD_ID;
+	sev.sigev_signo = SIGPROF;
+	sev.sigev_notify_thread_id = syscall<SYS_gettid>();
+	syscall(::timer_create, CLOCK_MONOTONIC, &sev, &timerid);
+
+	const long interval
+	{
+		1000000000L / long(std::clamp(size_t(hz), 1UL, HZ_MAX))
+	};
+
+	struct itimerspec its {0};
+	its.it_interval.tv_nsec = interval % 1000000000L;
+	its.it_interval.tv_sec = interval / 1000000000L;
+	its.it_value = its.it_interval;
+	syscall(::timer_settime, timerid, 0, &its, nullptr);
+	active.store(true, std::memory_order_release);
+}
+
+void
+ircd::ctx::prof::sample::stop()
+{
+	assert_main_thread();
+	if(!running())
+		return;
+
+	syscall(::timer_delete, timerid);
+	active.store(false, std::memory_order_release);
+
+	struct sigaction sa {0};
+	sa.sa_handler = SIG_IGN;
+	sigemptyset(&sa.sa_mask);
+	syscall(::sigaction, SIGPROF, &sa, nullptr);
+	syscall(::sigaltstack, &altstack_prev, nullptr);
+	altstack.reset();
+}
+
+/// Signal handler; must remain async-signal-safe. The stack is walked by
+/// frame pointer from the interrupted register state, bounded by the stack
+/// of the current context (or the main thread's stack) so a function built
+/// without a frame pointer truncates the walk rather than faulting it.
+void
+ircd::ctx::prof::sample::handle(int signum,
+                                siginfo_t *const si,
+                                void *const uc_)
+noexcept
+{
+	if(!active.load(std::memory_order_acquire))
+		return;
+
+	const auto &uc
+	{
+		*reinterpret_cast<const ucontext_t *>(uc_)
+	};
+
+	#if defined(__x86_64__)
+	const uintptr_t pc(uc.uc_mcontext.gregs[REG_RIP]);
+	const uintptr_t fp(uc.uc_mcontext.gregs[REG_RBP]);
+	#elif defined(__aarch64__)
+	const uintptr_t pc(uc.uc_mcontext.pc);
+	const uintptr_t fp(uc.uc_mcontext.regs[29]);
+	#else
+	const uintptr_t pc(0);
+	const uintptr_t fp(uintptr_t(__builtin_frame_address(0)));
+	#endif
+
+	const ctx *const c(ircd::ctx::current);
+	const uintptr_t lo(c? c->stack.base - c->stack.max : main_stack[0]);
+	const uintptr_t hi(c? c->stack.base : main_stack[1]);
+	const string_view name(c? c->name : "main"_sv);
+
+	auto &s(ring[head.fetch_add(1, std::memory_order_relaxed) % ring_max]);
+	s.seq.fetch_add(1, std::memory_order_relaxed);
+	std::atomic_signal_fence(std::memory_order_seq_cst);
+	const size_t len(std::min(size(name), NAME_LEN));
+	memcpy(s.name, data(name), len);
+	s.name[len] = '\0';
+	s.depth = walk(s.frame, pc, fp, lo, hi);
+	std::atomic_signal_fence(std::memory_order_seq_cst);
+	s.seq.fetch_add(1, std::memory_order_relaxed);
+}
+
+size_t
+ircd::ctx::prof::sample::walk(void **const frame,
+                              const uintptr_t &pc,
+                              uintptr_t fp,
+                              const uintptr_t &lo,
+                              const uintptr_t &hi)
+noexcept
+{
+	size_t i(0);
+	if(pc)
+		frame[i++] = reinterpret_cast<void *>(pc);
+
+	while(i < DEPTH && fp >= lo && fp + 2 * sizeof(uintptr_t) <= hi && fp % sizeof(uintptr_t) == 0)
+	{
+		const auto *const f(reinterpret_cast<const uintptr_t *>(fp));
+		if(!f[1])
+			break;
+
+		frame[i++] = reinterpret_cast<void *>(f[1]);
+		if(f[0] <= fp)
+			break;
+
+		fp = f[0];
+	}
+
+	return i;
+}
+#else
+void
+ircd::ctx::prof::sample::start()
+{
+	throw error
+	{
+		"The sampling profiler is not available on this platform."
+	};
+}
+
+void
+ircd::ctx::prof::sample::stop()
+{
+}
+#endif
+
+bool
+ircd::ctx::prof::sample::running()
+{
+	return active.load(std::memory_order_relaxed);
+}
+
+size_t
+ircd::ctx::prof::sample::count()
+{
+	return head.load(std::memory_order_relaxed);
+}
+
+/// Writes the samples in the ring as folded stacks, one line per distinct
+/// stack with the context name as the root frame, for flamegraph.pl and
+/// compatible tools. Only the latest ring_size samples are available. If a
+/// name is given only that context's samples are written.
+size_t
+ircd::ctx::prof::sample::dump(std::ostream &out,
+                              const string_view &ctx_name)
+{
+	assert_main_thread();
+	if(!ring)
+		return 0;
+
+	const size_t total(head.load(std::memory_order_acquire));
+	const size_t begin(total > ring_max? total - ring_max : 0);
+
+	slot s;
+	std::map<std::string, std::map<std::vector<void *>, size_t>> names;
+	for(size_t i(begin); i < total; ++i)
+	{
+		const auto &r(ring[i % ring_max]);
+		const auto seq(r.seq.load(std::memory_order_acquire));
+		if(seq & 1)
+			continue;
+
+		s.depth = std::min(size_t(r.depth), DEPTH);
+		memcpy(s.name, r.name, sizeof(s.name));
+		memcpy(s.frame, r.frame, s.depth * sizeof(void *));
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if(r.seq.load(std::memory_order_relaxed) != seq)
+			continue;
+
+		if(ctx_name && ctx_name != s.name)
+			continue;
+
+		++names[s.name][std::vector<void *>(s.frame, s.frame + s.depth)];
+	}
+
+	size_t ret(0);
+	std::map<const void *, std::string> symbols;
+	char buf[1024];
+	for(const auto &n : names)
+		for(const auto &st : n.second)
+		{
+			out << n.first;
+			for(auto it(st.first.rbegin()); it != st.first.rend(); ++it)
+			{
+				auto sym(symbols.find(*it));
+				if(sym == end(symbols))
+					sym = symbols.emplace(*it, std::string{symbolize(buf, *it)}).first;
+
+				out << ';' << sym->second;
+			}
+
+			out << ' ' << st.second << '\n';
+			ret += st.second;
+		}
+
+	return ret;
+}
+
+ircd::string_view
+ircd::ctx::prof::sample::symbolize(const mutable_buffer &buf,
+                                   const void *const &addr)
+{
+	#ifdef HAVE_DLFCN_H
+	Dl_info info {0};
+	if(!::dladdr(addr, &info))
+		return fmt::sprintf
+		{
+			buf, "%p", addr
+		};
+
+	if(!info.dli_sname)
+		return fmt::sprintf
+		{
+			buf, "%s+%p",
+			info.dli_fname? token_last(info.dli_fname, '/') : "??"_sv,
+			(const void *)(uintptr_t(addr) - uintptr_t(info.dli_fbase))
+		};
+
+	string_view ret;
+	try
+	{
+		ret = demangle(buf, info.dli_sname);
+	}
+	catch(const not_mangled &)
+	{
+		ret = strlcpy(data(buf), info.dli_sname, size(buf));
+	}
+
+	// Trim the parameter list, which is noise at flamegraph scale; it is
+	// found by matching the last closing paren back to its opening.
+	size_t pos(ret.rfind(')')), depth(0);
+	for(; pos != ret.npos && pos < ret.size(); --pos)
+		if(ret[pos] == ')')
+			++depth;
+		else if(ret[pos] == '(' && !--depth)
+			return ret.substr(0, pos);
+
+	return ret;
+	#else
+	return fmt::sprintf
+	{
+		buf, "%p", addr
+	};
+	#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// ctx/sched.h
+//
+
+decltype(ircd::ctx::sched::defer_max)
+ircd::ctx::sched::defer_max
+{
+	{ "name",     "ircd.ctx.sched.defer_max" },
+	{ "default",  4L                         },
+};
+
+decltype(ircd::ctx::sched::wait_max)
+ircd::ctx::sched::wait_max
+{
+	{ "name",     "ircd.ctx.sched.wait_max" },
+	{ "default",  50L                       },
+};
+
+decltype(ircd::ctx::sched::stat)
+ircd::ctx::sched::stat;
+
+namespace ircd::ctx::sched
+{
+	template<class F> static void expose(const ircd::stats::writer &, F&&);
+
+	extern ircd::stats::collector ready_stat, resumes_stat, defers_stat, wait_stat;
+}
+
+decltype(ircd::ctx::sched::ready_stat)
+ircd::ctx::sched::ready_stat
+{
+	{
+		{ "name",     "ircd.ctx.sched.ready"                           },
+		{ "help",     "Contexts woken and not yet resumed by priority" },
+		{ "type",     "gauge"                                          },
+	},
+	[](const ircd::stats::writer &w)
+	{
+		expose(w, [](const stats &s) { return s.ready; });
+	}
+};
+
+decltype(ircd::ctx::sched::resumes_stat)
+ircd::ctx::sched::resumes_stat
+{
+	{
+		{ "name",     "ircd.ctx.sched.resumes"                },
+		{ "help",     "Context resumes after a wake by priority" },
+		{ "type",     "counter"                               },
+	},
+	[](const ircd::stats::writer &w)
+	{
+		expose(w, [](const stats &s) { return s.resumes; });
+	}
+};
+
+decltype(ircd::ctx::sched::defers_stat)
+ircd::ctx::sched::defers_stat
+{
+	{
+		{ "name",     "ircd.ctx.sched.defers"                          },
+		{ "help",     "Resumes given up to a higher class by priority" },
+		{ "type",     "counter"                                        },
+	},
+	[](const ircd::stats::writer &w)
+	{
+		expose(w, [](const stats &s) { return s.defers; });
+	}
+};
+
+decltype(ircd::ctx::sched::wait_stat)
+ircd::ctx::sched::wait_stat
+{
+	{
+		{ "name",     "ircd.ctx.sched.wait.seconds"                      },
+		{ "help",     "Accumulated wake-to-resume latency by priority" },
+		{ "type",     "counter"                                        },
+	},
+	[](const ircd::stats::writer &w)
+	{
+		expose(w, [](const stats &s) { return s.wait_total.count() / 1e6; });
+	}
+};
+
+template<class F>
+void
+ircd::ctx::sched::expose(const ircd::stats::writer &w,
+                         F&& value)
+{
+	for(uint i(0); i < stat.size(); ++i)
+		w({{ "prio", reflect(prio(i)) }}, double(value(stat[i])));
+}
+
+ircd::string_view
+ircd::ctx::sched::reflect(const prio &prio)
+{
+	switch(prio)
+	{
+		case prio::INTERACTIVE:  return "INTERACTIVE";
+		case prio::FEDERATION:   return "FEDERATION";
+		case prio::BACKGROUND:   return "BACKGROUND";
+	}
+
+	return "??????";
+}
+
+bool
+ircd::ctx::sched::ready_above(const prio &prio)
+{
+	for(uint i(0); i < uint(prio); ++i)
+		if(stat[i].ready)
+			return true;
+
+	return false;
+}
+
+/// Called as the context resumes from wait() when its class is below the
+/// highest. The context is reposted behind the queue while a higher class
+/// has contexts woken and waiting to run, within defer_max and wait_max.
+void
+ircd::ctx::sched::defer(ctx &ctx)
+{
+	const auto started
+	{
+		now<steady_point>()
+	};
+
+	const auto max
+	{
+		milliseconds(wait_max)
+	};
+
+	// Interrupts are held until after the deferral so the repost made by
+	// yield() can't outlive this frame.
+	const this_ctx::uninterruptible::nothrow ui;
+	ctx.sched.deferring = true;
+	const unwind reset{[&ctx]
+	{
+		ctx.sched.deferring = false;
+	}};
+
+	for(size_t i(0); i < size_t(defer_max) && ready_above(ctx.sched.prio); ++i)
+	{
+		if(now<steady_point>() - started > max)
+			break;
+
+		++stat.at(uint(ctx.sched.prio)).defers;
+		this_ctx::yield();
+	}
+}
+
+void
+ircd::ctx::sched::woken(ctx &ctx)
+noexcept
+{
+	if(ctx.sched.woken != steady_point{})
+		return;
+
+	ctx.sched.woken = now<steady_point>();
+	++stat.at(uint(ctx.sched.prio)).ready;
+}
+
+void
+ircd::ctx::sched::resumed(ctx &ctx)
+noexcept
+{
+	if(ctx.sched.woken == steady_point{})
+		return;
+
+	const auto elapsed
+	{
+		duration_cast<microseconds>(now<steady_point>() - ctx.sched.woken)
+	};
+
+	auto &stat(sched::stat.at(uint(ctx.sched.prio)));
+	ctx.sched.woken = {};
+	assert(stat.ready > 0);
+	--stat.ready;
+	++stat.resumes;
+	stat.wait_total += elapsed;
+	stat.wait_max = std::max(stat.wait_max, elapsed);
+}
+
+void
+ircd::ctx::sched::forget(ctx &ctx)
+noexcept
+{
+	if(ctx.sched.woken == steady_point{})
+		return;
+
+	auto &stat(sched::stat.at(uint(ctx.sched.prio)));
+	ctx.sched.woken = {};
+	assert(stat.ready > 0);
+	--stat.ready;
+}
+
+//
+// scope
+//
+
+ircd::ctx::sched::scope::scope(const prio &prio)
+:theirs
+{
+	ircd::ctx::prio(cur())
+}
+{
+	ircd::ctx::prio(cur(), prio);
+}
+
+ircd::ctx::sched::scope::~scope()
+noexcept
+{
+	ircd::ctx::prio(cur(), theirs);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// ctx/stack_pool.h
+//
+
+namespace ircd::ctx::stack_pool
+{
+	struct entry
+	{
+		void *base;                    // lowest address; the guard page
+		bool resident;                 // false after madvise()
+	};
+
+	std::map<size_t, std::vector<entry>> freelist;
+	size_t cached;
+	size_t cached_resident;
+
+	size_t guard_size();
+}
+
+decltype(ircd::ctx::stack_pool::max)
+ircd::ctx::stack_pool::max
+{
+	{ "name",     "ircd.ctx.stack_pool.max" },
+	{ "default",  int64_t(256_MiB)          },
+};
+
+decltype(ircd::ctx::stack_pool::resident)
+ircd::ctx::stack_pool::resident
+{
+	{ "name",     "ircd.ctx.stack_pool.resident" },
+	{ "default",  int64_t(32_MiB)                },
+};
+
+decltype(ircd::ctx::stack_pool::stats)
+ircd::ctx::stack_pool::stats;
+
+bool
+ircd::ctx::stack_pool::for_each(const std::function<bool (const size_t &, const size_t &)> &closure)
+{
+	for(const auto &p : freelist)
+		if(!closure(p.first, p.second.size()))
+			return false;
+
+	return true;
+}
+
+size_t
+ircd::ctx::stack_pool::bytes_resident()
+{
+	return cached_resident;
+}
+
+size_t
+ircd::ctx::stack_pool::bytes()
+{
+	return cached;
+}
+
+size_t
+ircd::ctx::stack_pool::count()
+{
+	size_t ret(0);
+	for(const auto &p : freelist)
+		ret += p.second.size();
+
+	return ret;
+}
+
+size_t
+ircd::ctx::stack_pool::count(const size_t &size)
+{
+	const auto it(freelist.find(size));
+	return it != end(freelist)? it->second.size() : 0;
+}
+
+size_t
+ircd::ctx::stack_pool::guard_size()
+{
+	static const size_t ret
+	{
+		size_t(::sysconf(_SC_PAGESIZE))
+	};
+
+	return ret;
+}
+
+//
+// allocator
+//
+
+void
+ircd::ctx::stack_pool::allocator::allocate(boost::coroutines::stack_context &sc,
+                                           std::size_t size)
+{
+	const size_t guard
+	{
+		guard_size()
+	};
+
+	// Round up to whole pages; this is also the size class.
+	size = (size + guard - 1) / guard * guard;
+
+	void *base{nullptr};
+	auto &list(freelist[size]);
+	if(!list.empty())
+	{
+		const auto &entry(list.back());
+		base = entry.base;
+		cached -= size;
+		cached_resident -= entry.resident? size : 0;
+		list.pop_back();
+		++stats.reuses;
+	} else {
+		base = ::mmap(nullptr, size + guard, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+		if(unlikely(base == MAP_FAILED))
+			throw std::bad_alloc{};
+
+		syscall(::mprotect, base, guard, PROT_NONE);
+		++stats.maps;
+	}
+
+	sc.size = size;
+	sc.sp = static_cast<char *>(base) + guard + size;
+	++stats.allocs;
+}
+
+void
+ircd::ctx::stack_pool::allocator::deallocate(boost::coroutines::stack_context &sc)
+{
+	const size_t guard
+	{
+		guard_size()
+	};
+
+	const size_t size(sc.size);
+	char *const base
+	{
+		static_cast<char *>(sc.sp) - size - guard
+	};
+
+	if(cached + size > size_t(max))
+	{
+		::munmap(base, size + guard);
+		++stats.unmaps;
+		return;
+	}
+
+	// Stacks beyond the resident allowance give their pages back to the
+	// kernel but keep the mapping (and guard page) for the next context.
+	const bool trim
+	{
+		cached_resident + size > size_t(resident)
+	};
+
+	if(trim)
+	{
+		#ifdef MADV_FREE
+		::madvise(base + guard, size, MADV_FREE);
+		#else
+		::madvise(base + guard, size, MADV_DONTNEED);
+		#endif
+		++stats.trims;
+	}
+
+	freelist[size].emplace_back(entry{base, !trim});
+	cached += size;
+	cached_resident += trim? 0 : size;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 //
 // ctx_ole.h
@@ -1533,8 +2454,24 @@ namespace ircd::ctx::ole
 	closure pop();
 	void push(closure &&);
 	void worker() noexcept;
+
+	extern stats::gauge queue_stat;
 }
 
+decltype(ircd::ctx::ole::queue_stat)
+ircd::ctx::ole::queue_stat
+{
+	{
+		{ "name",     "ircd.ctx.ole.queue"                      },
+		{ "help",     "Closures waiting for an offload thread" },
+	},
+	[]
+	{
+		const std::lock_guard<decltype(mutex)> lock{mutex};
+		return double(queue.size());
+	}
+};
+
 decltype(ircd::ctx::ole::thread_max)
 ircd::ctx::ole::thread_max
 {
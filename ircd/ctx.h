@@ -12,10 +12,63 @@ namespace ircd::ctx
 {
 	struct stack;
 	struct profile;
+	struct schedule;
 
 	void spawn(ctx *const c, context::function func);
 }
 
+namespace ircd::ctx::sched
+{
+	void woken(ctx &) noexcept;
+	void resumed(ctx &) noexcept;
+	void forget(ctx &) noexcept;
+	void defer(ctx &);
+}
+
+namespace ircd::ctx::prof
+{
+	void retire(const ctx &) noexcept;
+}
+
+namespace ircd::ctx::stack_pool
+{
+	struct allocator;
+
+	template<class handler,
+	         class function>
+	struct spawn_helper;
+}
+
+/// Satisfies the boost::coroutines StackAllocator concept with stacks from
+/// the stack_pool.
+struct ircd::ctx::stack_pool::allocator
+{
+	void allocate(boost::coroutines::stack_context &, std::size_t size);
+	void deallocate(boost::coroutines::stack_context &);
+};
+
+/// Stands in for boost::asio::detail::spawn_helper to construct the
+/// coroutine with stack_pool::allocator.
+template<class handler,
+         class function>
+struct ircd::ctx::stack_pool::spawn_helper
+:boost::asio::detail::spawn_helper<handler, function>
+{
+	void operator()()
+	{
+		using callee_type = typename boost::asio::basic_yield_context<handler>::callee_type;
+		using entry_point = boost::asio::detail::coro_entry_point<handler, function>;
+
+		std::shared_ptr<callee_type> coro
+		{
+			new callee_type(entry_point{this->data_}, this->attributes_, allocator{})
+		};
+
+		this->data_->coro_ = coro;
+		(*coro)();
+	}
+};
+
 /// Internal structure aggregating any stack related state for the ctx
 struct ircd::ctx::stack
 {
@@ -28,6 +81,14 @@ struct ircd::ctx::stack
 	{}
 };
 
+/// Internal structure aggregating any scheduling related state for the ctx
+struct ircd::ctx::schedule
+{
+	sched::prio prio {sched::prio::INTERACTIVE}; // Priority class
+	steady_point woken;                          // Time of wake; zero when not
+	bool deferring {false};                      // Giving way to a higher class
+};
+
 /// Internal structure aggregating any profiling related state for the ctx
 struct ircd::ctx::profile
 {
@@ -52,6 +113,7 @@ struct ircd::ctx::ctx
 	continuation *cont {nullptr};                // valid when asleep; invalid when awake
 	ircd::ctx::stack stack;                      // stack related structure
 	ircd::ctx::profile profile;                  // prof related structure
+	ircd::ctx::schedule sched;                   // scheduling related structure
 	list::node node;                             // node for ctx::list
 	dock adjoindre;                              // contexts waiting for this to join()
 
@@ -28,6 +28,7 @@
 #include <rocksdb/sst_file_manager.h>
 #include <rocksdb/sst_dump_tool.h>
 #include <rocksdb/compaction_filter.h>
+#include <rocksdb/experimental.h>
 
 // ircd::db interfaces requiring complete RocksDB (frontside).
 #include <ircd/db/database/comparator.h>
@@ -1669,6 +1670,17 @@ ircd::db::database::column::column(database &d,
 			d.d->DestroyColumnFamilyHandle(handle);
 	}
 }
+,seek_stat
+{
+	{ "name",     "ircd.db.seek.seconds"                        },
+	{ "help",     "Distribution of column seek latency"        },
+	{ "scale",    1e-6                                          },
+	{ "labels",   json::members
+	{
+		{ "db",       string_view{d.name}                           },
+		{ "column",   string_view{this->name}                       },
+	}},
+}
 {
 	// If possible, deduce comparator based on type given in descriptor
 	if(!this->descriptor->cmp.less)
@@ -9571,6 +9583,44 @@ ircd::db::compact(column &column,
 	};
 }
 
+/// Marks the files overlapping the range for compaction; the background
+/// compaction picks them up in its own time with the column's own filter.
+/// This returns without waiting for any of it.
+void
+ircd::db::suggest(column &column,
+                  const std::pair<string_view, string_view> &range)
+{
+	database &d(column);
+	database::column &c(column);
+
+	const auto begin(slice(range.first));
+	const rocksdb::Slice *const b
+	{
+		empty(range.first)? nullptr : &begin
+	};
+
+	const auto end(slice(range.second));
+	const rocksdb::Slice *const e
+	{
+		empty(range.second)? nullptr : &end
+	};
+
+	log::debug
+	{
+		log, "'%s':'%s' @%lu SUGGEST COMPACT [%s, %s]",
+		name(d),
+		name(c),
+		sequence(d),
+		range.first,
+		range.second
+	};
+
+	throw_on_error
+	{
+		rocksdb::experimental::SuggestCompactRange(d.d.get(), c, b, e)
+	};
+}
+
 void
 ircd::db::setopt(column &column,
                  const string_view &key,
@@ -10426,10 +10476,11 @@ ircd::db::_seek(database::column &c,
 {
 	#ifdef RB_DEBUG_DB_SEEK
 	database &d(*c.d);
-	const ircd::timer timer;
 	#endif
 
+	const ircd::timer timer;
 	_seek_(it, p);
+	c.seek_stat(timer.at<microseconds>());
 
 	#ifdef RB_DEBUG_DB_SEEK
 	log::debug
@@ -10696,6 +10747,58 @@ const
 // cache.h
 //
 
+namespace ircd::db
+{
+	static void expose_cache(const ircd::stats::writer &, const uint32_t &ticker);
+
+	extern ircd::stats::collector cache_hit_stat, cache_miss_stat;
+}
+
+decltype(ircd::db::cache_hit_stat)
+ircd::db::cache_hit_stat
+{
+	{
+		{ "name",     "ircd.db.cache.hit"                  },
+		{ "help",     "Block cache hits by column"         },
+		{ "type",     "counter"                            },
+	},
+	[](const ircd::stats::writer &w)
+	{
+		expose_cache(w, rocksdb::Tickers::BLOCK_CACHE_HIT);
+	}
+};
+
+decltype(ircd::db::cache_miss_stat)
+ircd::db::cache_miss_stat
+{
+	{
+		{ "name",     "ircd.db.cache.miss"                 },
+		{ "help",     "Block cache misses by column"       },
+		{ "type",     "counter"                            },
+	},
+	[](const ircd::stats::writer &w)
+	{
+		expose_cache(w, rocksdb::Tickers::BLOCK_CACHE_MISS);
+	}
+};
+
+void
+ircd::db::expose_cache(const ircd::stats::writer &w,
+                       const uint32_t &ticker_id)
+{
+	for(const auto *const &d : database::list)
+		for(const auto &c : d->columns)
+		{
+			const db::column column{*c};
+			w(
+			{
+				{ "db",      string_view{d->name}     },
+				{ "column",  string_view{name(*c)}   },
+			},
+			double(ticker(cache(column), ticker_id)));
+		}
+}
+
 void
 ircd::db::clear(rocksdb::Cache *const &cache)
 {
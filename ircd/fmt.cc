@@ -16,6 +16,7 @@ namespace ircd::fmt
 
 	struct spec;
 	struct specifier;
+	struct compiled;
 	struct parser extern const parser;
 
 	constexpr char SPECIFIER
@@ -39,7 +40,7 @@ namespace ircd::fmt
 	struct string_specifier extern const string_specifier;
 
 	bool is_specifier(const string_view &name);
-	void handle_specifier(mutable_buffer &out, const uint &idx, const spec &, const arg &);
+	void handle_specifier(mutable_buffer &out, const uint &idx, const spec &, const specifier &, const arg &);
 	template<class generator> bool generate_string(char *&out, const generator &gen, const arg &val);
 	template<class T, class lambda> bool visit_type(const arg &val, lambda&& closure);
 }
@@ -83,6 +84,41 @@ class ircd::fmt::specifier
 	virtual ~specifier() noexcept;
 };
 
+/// A format string parsed once into the sequence of its specifiers, each
+/// resolved to its handler, and the literal text between them. Formatting
+/// is then a straight line of conversions without the grammar or the lookup
+/// of the handlers. An item without a handler is a specifier which failed to
+/// parse; as with the grammar the arguments from there on are not printed.
+///
+/// The parsed formats are cached per thread by the address of the format
+/// string, which is a literal at nearly every call site; the content is
+/// compared on each hit so a buffer reused for another format is reparsed.
+struct ircd::fmt::compiled
+{
+	struct item
+	{
+		fmt::spec spec;
+		const specifier *handler {nullptr};
+		string_view literal;             // text following the specifier
+	};
+
+	static constexpr const size_t cache_max
+	{
+		4096
+	};
+
+	std::string source;
+	string_view prefix;
+	std::vector<item> items;
+
+  public:
+	static const compiled *find(const string_view &fmt);
+
+	compiled(const string_view &fmt);
+	compiled(compiled &&) = delete;
+	compiled(const compiled &) = delete;
+};
+
 /// Linkage for the lookup mapping of registered format specifiers.
 decltype(ircd::fmt::specifiers)
 ircd::fmt::specifiers;
@@ -311,14 +347,6 @@ ircd::fmt::snprintf::snprintf(internal_t,
                               const va_rtti &v)
 try
 :out{out}
-,fmt{[&fmt]
-{
-	// start the member fmt variable at the first specifier (or end)
-	const auto pos(fmt.find(SPECIFIER));
-	return pos != fmt.npos?
-		fmt.substr(pos):
-		string_view{};
-}()}
 ,idx{0}
 {
 	// If out has no size we have nothing to do, not even null terminate it.
@@ -327,23 +355,36 @@ try
 
 	// If fmt has no specifiers then we can just copy the fmt as best as
 	// possible to the out buffer.
-	if(empty(this->fmt))
+	if(fmt.find(SPECIFIER) == fmt.npos)
 	{
 		append(fmt);
 		return;
 	}
 
+	// Formats are only parsed here when not cached (or the cache is full).
+	std::optional<compiled> local;
+	const compiled *c(compiled::find(fmt));
+	if(unlikely(!c))
+	{
+		local.emplace(fmt);
+		c = &*local;
+	}
+
 	// Copy everything from fmt up to the first specifier.
-	assert(data(this->fmt) >= data(fmt));
-	append(string_view(data(fmt), data(this->fmt)));
+	append(c->prefix);
 
 	// Iterate
 	auto it(begin(v));
-	for(size_t i(0); i < v.size() && !finished(); ++it, i++)
+	for(size_t i(0); i < v.size() && i < c->items.size() && !finished(); ++it, i++)
 	{
+		const auto &item(c->items[i]);
+		if(!item.handler)
+			break;
+
 		const void *const &ptr(get<0>(*it));
 		const std::type_index type(*get<1>(*it));
-		argument(std::make_tuple(ptr, type));
+		handle_specifier(this->out, idx++, item.spec, *item.handler, std::make_tuple(ptr, type));
+		append(item.literal);
 	}
 
 	// Ensure null termination if out buffer is non-empty.
@@ -359,28 +400,6 @@ catch(const std::out_of_range &e)
 	};
 }
 
-void
-ircd::fmt::snprintf::argument(const arg &val)
-{
-	// The format string's front pointer is sitting on the specifier '%'
-	// waiting to be parsed now.
-	fmt::spec spec;
-	auto &start(std::get<0>(this->fmt));
-	const auto &stop(std::get<1>(this->fmt));
-	if(qi::parse(start, stop, parser, spec))
-		handle_specifier(this->out, idx++, spec, val);
-
-	const string_view fmt(start, stop);
-	const auto nextpos(fmt.find(SPECIFIER));
-	append(fmt.substr(0, nextpos));
-	this->fmt = const_buffer
-	{
-		nextpos != fmt.npos?
-			fmt.substr(nextpos):
-			string_view{}
-	};
-}
-
 void
 ircd::fmt::snprintf::append(const string_view &src)
 {
@@ -403,7 +422,78 @@ bool
 ircd::fmt::snprintf::finished()
 const
 {
-	return empty(fmt) || !remaining();
+	return !remaining();
+}
+
+//
+// compiled
+//
+
+const ircd::fmt::compiled *
+ircd::fmt::compiled::find(const string_view &fmt)
+{
+	thread_local std::unordered_map<const char *, std::unique_ptr<compiled>> cache;
+
+	const auto it
+	{
+		cache.find(data(fmt))
+	};
+
+	if(likely(it != end(cache) && it->second->source == fmt))
+		return it->second.get();
+
+	// Replacing an entry is safe even when formatting recursively, as an
+	// outer call's format still occupies its address with its own content.
+	if(it != end(cache))
+	{
+		it->second = std::make_unique<compiled>(fmt);
+		return it->second.get();
+	}
+
+	// Entries are not evicted while the cache is full because an outer call
+	// may be using one; the caller parses into its own frame instead.
+	if(unlikely(cache.size() >= cache_max))
+		return nullptr;
+
+	const auto iit
+	{
+		cache.emplace(data(fmt), std::make_unique<compiled>(fmt))
+	};
+
+	return iit.first->second.get();
+}
+
+ircd::fmt::compiled::compiled(const string_view &fmt)
+:source{fmt}
+{
+	const char *start(source.data());
+	const char *const stop(source.data() + source.size());
+	const auto first
+	{
+		string_view(start, stop).find(SPECIFIER)
+	};
+
+	prefix = string_view(start, stop).substr(0, first);
+	if(first == string_view::npos)
+		return;
+
+	start += first;
+	while(start < stop)
+	{
+		item item;
+		if(!qi::parse(start, stop, parser, item.spec))
+		{
+			items.emplace_back(std::move(item));
+			break;
+		}
+
+		item.handler = specifiers.at(item.spec.name);
+		const string_view rest(start, stop);
+		const auto nextpos(rest.find(SPECIFIER));
+		item.literal = rest.substr(0, nextpos);
+		items.emplace_back(std::move(item));
+		start = nextpos != rest.npos? start + nextpos : stop;
+	}
 }
 
 ircd::fmt::specifier::specifier(const std::string &name)
@@ -442,11 +532,11 @@ void
 ircd::fmt::handle_specifier(mutable_buffer &out,
                             const uint &idx,
                             const spec &spec,
+                            const specifier &handler,
                             const arg &val)
 try
 {
 	const auto &type(get<1>(val));
-	const auto &handler(*specifiers.at(spec.name));
 
 	auto &outp(std::get<0>(out));
 	assert(size(out));
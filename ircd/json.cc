@@ -10,6 +10,7 @@
 
 #include <ircd/spirit.h>
 #include <boost/fusion/include/at.hpp>
+#include <RB_INC_X86INTRIN_H
 
 namespace ircd::json
 {
@@ -24,6 +25,27 @@ namespace ircd::json
 	struct ostreamer extern const ostreamer;
 }
 
+/// Structural scanning for the lazy iterators of json::object and
+/// json::array. Skipping over a member's value only requires finding where
+/// it ends; strings and containers are skipped by classifying the input a
+/// vector at a time for the few characters which matter (quote, escape and
+/// the brackets) rather than running the full grammar over every character.
+/// The contents of a skipped value are validated when it is itself iterated
+/// or by json::valid(); the brackets are matched and the recursion limit is
+/// still enforced here. Scalars are short and still parsed by the grammar.
+namespace ircd::json::scan
+{
+	using find_t = const char *(*)(const char *, const char *const);
+
+	static const char *find_scalar(const char *, const char *const, const bool &structural);
+	static const char *find_string(const char *, const char *const);
+	static const char *find_structural(const char *, const char *const);
+	static const char *string(const char *, const char *const);
+	static const char *container(const char *, const char *const);
+	static string_view value(const char *&, const char *const);
+	static string_view member(const char *&, const char *const, string_view &name);
+}
+
 BOOST_FUSION_ADAPT_STRUCT
 (
     ircd::json::member,
@@ -1355,6 +1377,289 @@ const
 	return { string_view::end(), string_view::end() };
 }
 
+///////////////////////////////////////////////////////////////////////////////
+//
+// scan
+//
+
+#if defined(HAVE_X86INTRIN_H) && defined(__SSE2__)
+namespace ircd::json::scan
+{
+	template<bool structural> static const char *find_sse2(const char *, const char *const);
+	template<bool structural> __attribute__((target("avx2"))) static const char *find_avx2(const char *, const char *const);
+	template<bool structural> static find_t find_select();
+}
+
+/// Selected once at first use, which may be during static initialization.
+template<bool structural>
+ircd::json::scan::find_t
+ircd::json::scan::find_select()
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2")?
+		find_avx2<structural>:
+		find_sse2<structural>;
+}
+
+/// The structural set is '"' '{' '}' '[' ']'; the brackets differ from their
+/// counterparts only by 0x20 so they're matched as '{' and '}' after or'ing
+/// that bit in. The string set is '"' and '\'.
+template<bool structural>
+__attribute__((target("avx2")))
+const char *
+ircd::json::scan::find_avx2(const char *p,
+                            const char *const stop)
+{
+	const __m256i quote(_mm256_set1_epi8('"'));
+	const __m256i escape(_mm256_set1_epi8('\\'));
+	const __m256i lower(_mm256_set1_epi8(0x20));
+	const __m256i open(_mm256_set1_epi8('{'));
+	const __m256i close(_mm256_set1_epi8('}'));
+	for(; p + 32 <= stop; p += 32)
+	{
+		const __m256i in(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)));
+		__m256i match(_mm256_cmpeq_epi8(in, quote));
+		if(structural)
+		{
+			const __m256i folded(_mm256_or_si256(in, lower));
+			match = _mm256_or_si256(match, _mm256_cmpeq_epi8(folded, open));
+			match = _mm256_or_si256(match, _mm256_cmpeq_epi8(folded, close));
+		}
+		else match = _mm256_or_si256(match, _mm256_cmpeq_epi8(in, escape));
+
+		const uint mask(_mm256_movemask_epi8(match));
+		if(mask)
+			return p + __builtin_ctz(mask);
+	}
+
+	return find_scalar(p, stop, structural);
+}
+
+template<bool structural>
+const char *
+ircd::json::scan::find_sse2(const char *p,
+                            const char *const stop)
+{
+	const __m128i quote(_mm_set1_epi8('"'));
+	const __m128i escape(_mm_set1_epi8('\\'));
+	const __m128i lower(_mm_set1_epi8(0x20));
+	const __m128i open(_mm_set1_epi8('{'));
+	const __m128i close(_mm_set1_epi8('}'));
+	for(; p + 16 <= stop; p += 16)
+	{
+		const __m128i in(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+		__m128i match(_mm_cmpeq_epi8(in, quote));
+		if(structural)
+		{
+			const __m128i folded(_mm_or_si128(in, lower));
+			match = _mm_or_si128(match, _mm_cmpeq_epi8(folded, open));
+			match = _mm_or_si128(match, _mm_cmpeq_epi8(folded, close));
+		}
+		else match = _mm_or_si128(match, _mm_cmpeq_epi8(in, escape));
+
+		const uint mask(_mm_movemask_epi8(match));
+		if(mask)
+			return p + __builtin_ctz(mask);
+	}
+
+	return find_scalar(p, stop, structural);
+}
+
+const char *
+ircd::json::scan::find_string(const char *const p,
+                              const char *const stop)
+{
+	static const find_t find
+	{
+		find_select<false>()
+	};
+
+	return find(p, stop);
+}
+
+const char *
+ircd::json::scan::find_structural(const char *const p,
+                                  const char *const stop)
+{
+	static const find_t find
+	{
+		find_select<true>()
+	};
+
+	return find(p, stop);
+}
+#else
+const char *
+ircd::json::scan::find_string(const char *const p,
+                              const char *const stop)
+{
+	return find_scalar(p, stop, false);
+}
+
+const char *
+ircd::json::scan::find_structural(const char *const p,
+                                  const char *const stop)
+{
+	return find_scalar(p, stop, true);
+}
+#endif
+
+/// Tail of the vector finds (and the fallback); returns stop when not found.
+const char *
+ircd::json::scan::find_scalar(const char *p,
+                              const char *const stop,
+                              const bool &structural)
+{
+	for(; p < stop; ++p)
+		switch(*p)
+		{
+			case '"':
+				return p;
+
+			case '\\':
+				if(!structural)
+					return p;
+				continue;
+
+			case '{':
+			case '}':
+			case '[':
+			case ']':
+				if(structural)
+					return p;
+				continue;
+		}
+
+	return stop;
+}
+
+/// Input is the opening quote; returns one past the closing quote.
+const char *
+ircd::json::scan::string(const char *p,
+                         const char *const stop)
+{
+	assert(p < stop && *p == '"');
+	for(p = find_string(p + 1, stop); p < stop; p = find_string(p, stop))
+	{
+		if(*p == '"')
+			return p + 1;
+
+		// escape; the escaped character is skipped whatever it is.
+		p += 2;
+	}
+
+	throw parse_error
+	{
+		"Unterminated string"
+	};
+}
+
+/// Input is the opening bracket; returns one past the closing bracket.
+/// The open containers are kept as a stack of bits (set for an object) so
+/// each closing bracket is matched against its opener.
+const char *
+ircd::json::scan::container(const char *p,
+                            const char *const stop)
+{
+	static const uint max_depth
+	{
+		std::min(object::max_recursion_depth, uint(sizeof(uint64_t) * 8))
+	};
+
+	assert(p < stop && (*p == '{' || *p == '['));
+	uint64_t objects(0);
+	uint depth(0);
+	for(p = find_structural(p, stop); p < stop; p = find_structural(p, stop))
+		switch(*p)
+		{
+			case '"':
+				p = string(p, stop);
+				continue;
+
+			case '{':
+			case '[':
+				if(unlikely(++depth > max_depth))
+					throw recursion_limit
+					{
+						"Maximum recursion depth exceeded"
+					};
+
+				objects = (objects << 1) | (*p == '{');
+				++p;
+				continue;
+
+			default:
+				if(unlikely((*p == '}') != bool(objects & 1)))
+					throw parse_error
+					{
+						"Mismatched '%c' closing %s", *p, objects & 1? "object" : "array"
+					};
+
+				objects >>= 1;
+				++p;
+				if(--depth == 0)
+					return p;
+
+				continue;
+		}
+
+	throw parse_error
+	{
+		"Unterminated %s", depth? "container" : "value"
+	};
+}
+
+/// Input is the first character of a value; the value is returned and the
+/// input is advanced past it.
+ircd::string_view
+ircd::json::scan::value(const char *&start,
+                        const char *const stop)
+{
+	static const parser::rule<> scalar
+	{
+		parser.lit_false | parser.lit_null | parser.lit_true | parser.number
+		,"value"
+	};
+
+	const char *const begin(start);
+	if(likely(start < stop)) switch(*start)
+	{
+		case '"':
+			start = string(start, stop);
+			return { begin, start };
+
+		case '{':
+		case '[':
+			start = container(start, stop);
+			return { begin, start };
+	}
+
+	qi::parse(start, stop, eps > scalar);
+	return { begin, start };
+}
+
+/// Input is the first character of a member's name (the quote); the value
+/// is returned and the input is advanced past the value.
+ircd::string_view
+ircd::json::scan::member(const char *&start,
+                         const char *const stop,
+                         string_view &name)
+{
+	static const auto &ws
+	{
+		parser.ws
+	};
+
+	static const parser::rule<string_view> member_name
+	{
+		parser.name >> -ws >> parser.name_sep >> -ws
+		,"object member"
+	};
+
+	qi::parse(start, stop, eps > member_name, name);
+	return value(start, stop);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 //
 // json/object.h
@@ -1531,21 +1836,20 @@ try
 		parser.ws
 	};
 
-	static const parser::rule<json::object::member> member
-	{
-		parser.name >> -ws >> parser.name_sep >> -ws >> raw[parser.value(0)]
-		,"next object member"
-	};
-
-	static const parser::rule<json::object::member> parse_next
+	static const parser::rule<bool> parse_next
 	{
-		(parser.object_end | (parser.value_sep >> -ws >> member)) >> -ws
+		((parser.object_end >> attr(false)) | (parser.value_sep >> -ws >> attr(true)))
 		,"next object member or end"
 	};
 
+	bool more(false);
 	state.first = string_view{};
 	state.second = string_view{};
-	qi::parse(start, stop, eps > parse_next, state);
+	qi::parse(start, stop, eps > parse_next, more);
+	if(more)
+		state.second = scan::member(start, stop, state.first);
+
+	qi::parse(start, stop, -ws);
 	return *this;
 }
 catch(const qi::expectation_failure<const char *> &e)
@@ -1568,15 +1872,9 @@ const try
 		parser.ws
 	};
 
-	static const parser::rule<json::object::member> object_member
-	{
-		parser.name >> -ws >> parser.name_sep >> -ws >> raw[parser.value(0)]
-		,"object member"
-	};
-
-	static const parser::rule<json::object::member> parse_begin
+	static const parser::rule<bool> parse_begin
 	{
-		-ws >> parser.object_begin >> -ws >> (parser.object_end | object_member) >> -ws
+		-ws >> parser.object_begin >> -ws >> ((parser.object_end >> attr(false)) | attr(true))
 		,"object begin and member or end"
 	};
 
@@ -1585,9 +1883,15 @@ const try
 		string_view::begin(), string_view::end()
 	};
 
-	if(!string_view{*this}.empty())
-		qi::parse(ret.start, ret.stop, eps > parse_begin, ret.state);
+	if(string_view{*this}.empty())
+		return ret;
+
+	bool more(false);
+	qi::parse(ret.start, ret.stop, eps > parse_begin, more);
+	if(more)
+		ret.state.second = scan::member(ret.start, ret.stop, ret.state.first);
 
+	qi::parse(ret.start, ret.stop, -ws);
 	return ret;
 }
 catch(const qi::expectation_failure<const char *> &e)
@@ -1724,20 +2028,19 @@ try
 		parser.ws
 	};
 
-	static const parser::rule<string_view> value
-	{
-		raw[parser.value(0)]
-		,"array element"
-	};
-
-	static const parser::rule<string_view> parse_next
+	static const parser::rule<bool> parse_next
 	{
-		(parser.array_end | (parser.value_sep >> -ws >> value)) >> -ws
+		((parser.array_end >> attr(false)) | (parser.value_sep >> -ws >> attr(true)))
 		,"next array element or end"
 	};
 
+	bool more(false);
 	state = string_view{};
-	qi::parse(start, stop, eps > parse_next, state);
+	qi::parse(start, stop, eps > parse_next, more);
+	if(more)
+		state = scan::value(start, stop);
+
+	qi::parse(start, stop, -ws);
 	return *this;
 }
 catch(const qi::expectation_failure<const char *> &e)
@@ -1760,15 +2063,9 @@ const try
 		parser.ws
 	};
 
-	static const parser::rule<string_view> value
+	static const parser::rule<bool> parse_begin
 	{
-		raw[parser.value(0)]
-		,"array element"
-	};
-
-	static const parser::rule<string_view> parse_begin
-	{
-		-ws >> parser.array_begin >> -ws >> (parser.array_end | value) >> -ws
+		-ws >> parser.array_begin >> -ws >> ((parser.array_end >> attr(false)) | attr(true))
 		,"array begin and element or end"
 	};
 
@@ -1777,9 +2074,15 @@ const try
 		string_view::begin(), string_view::end()
 	};
 
-	if(!string_view{*this}.empty())
-		qi::parse(ret.start, ret.stop, eps > parse_begin, ret.state);
+	if(string_view{*this}.empty())
+		return ret;
+
+	bool more(false);
+	qi::parse(ret.start, ret.stop, eps > parse_begin, more);
+	if(more)
+		ret.state = scan::value(ret.start, ret.stop);
 
+	qi::parse(ret.start, ret.stop, -ws);
 	return ret;
 }
 catch(const qi::expectation_failure<const char *> &e)
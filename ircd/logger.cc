@@ -12,10 +12,13 @@
 // <iostream> inclusion here runs std::ios_base::Init() statically as this unit
 // is initialized (GNU initialization order given in Makefile).
 
+#include <RB_INC_SYS_UIO_H
+
 namespace ircd::log
 {
+	struct ring;
+
 	// Option toggles
-	std::array<bool, num_of<facility>()> file_flush;
 	std::array<bool, num_of<facility>()> console_flush;
 	std::array<const char *, num_of<facility>()> console_ansi;
 
@@ -28,8 +31,12 @@ namespace ircd::log
 	std::array<bool, num_of<facility>()> quieted_out;
 	std::array<bool, num_of<facility>()> quieted_err;
 
-	// Logfile stream
-	std::array<std::ofstream, num_of<facility>()> file;
+	// Logfile descriptors
+	std::array<fs::fd, num_of<facility>()> file;
+
+	// Asynchronous output; null when lines are written synchronously.
+	std::unique_ptr<ring> writer;
+	bool writer_allowed;
 
 	std::ostream &out_console
 	{
@@ -46,6 +53,8 @@ namespace ircd::log
 
 	static void mkdir();
 	static void open(const facility &);
+	static void writer_reset();
+	static void write_iov(const int &fd, struct ::iovec *, size_t) noexcept;
 }
 
 void
@@ -75,15 +84,6 @@ ircd::log::init()
 	file_out[INFO]           = true;
 	file_out[DEBUG]          = ircd::debugmode;
 
-	file_flush[CRITICAL]     = true;
-	file_flush[ERROR]        = true;
-	file_flush[DERROR]       = true;
-	file_flush[WARNING]      = true;
-	file_flush[DWARNING]     = true;
-	file_flush[NOTICE]       = false;
-	file_flush[INFO]         = false;
-	file_flush[DEBUG]        = false;
-
 	console_flush[CRITICAL]  = true;
 	console_flush[ERROR]     = true;
 	console_flush[DERROR]    = true;
@@ -103,12 +103,17 @@ ircd::log::init()
 	console_ansi[DEBUG]     = "\033[1;30;47m";
 
 	mkdir();
+
+	writer_allowed = true;
+	writer_reset();
 }
 
 void
 ircd::log::fini()
 {
 	flush();
+	writer_allowed = false;
+	writer.reset();
 	close();
 }
 
@@ -134,11 +139,6 @@ ircd::log::open()
 		if(!file_out[fac])
 			return;
 
-		if(file[fac].is_open())
-			file[fac].close();
-
-		file[fac].clear();
-		file[fac].exceptions(std::ios::badbit | std::ios::failbit);
 		open(fac);
 	});
 }
@@ -146,32 +146,25 @@ ircd::log::open()
 void
 ircd::log::close()
 {
-	for_each<facility>([](const facility &fac)
-	{
-		if(file[fac].is_open())
-			file[fac].close();
-	});
-}
+	// Records still in the ring refer to these descriptors.
+	flush();
 
-void
-ircd::log::flush()
-{
 	for_each<facility>([](const facility &fac)
 	{
-		file[fac].flush();
+		file[fac] = fs::fd{};
 	});
-
-	std::flush(out_console);
-	std::flush(err_console);
 }
 
 void
 ircd::log::open(const facility &fac)
 try
 {
-	const auto &mode(std::ios::app);
+	// Records still in the ring may refer to the old descriptor.
+	flush();
+
+	const auto &mode(std::ios::out | std::ios::app);
 	const auto &path(file_path(fac));
-	file[fac].open(path.c_str(), mode);
+	file[fac] = fs::fd{path, mode};
 }
 catch(const std::exception &e)
 {
@@ -208,6 +201,384 @@ ircd::log::dir_path()
 	return fs::make_path(parts);
 }
 
+//
+// ring
+//
+
+namespace ircd::log
+{
+	enum class overflow
+	{
+		DROP,    // Discard the record and count it.
+		BLOCK,   // Main thread waits for the writer to make room.
+	};
+
+	extern conf::item<bool> async_enable;
+	extern conf::item<size_t> async_ring_size;
+	extern conf::item<std::string> async_overflow;
+
+	static overflow overflow_policy;
+	static overflow reflect_overflow(const string_view &);
+}
+
+/// Single-producer single-consumer ring of composed log lines. The main
+/// thread copies each line into a slot with slog(); the writer thread drains
+/// every published slot with batched writev(2) calls. Neither side takes a
+/// lock on the fast path; the mutex only covers the writer going to sleep and
+/// the flush barrier.
+struct ircd::log::ring
+{
+	struct record;
+
+	std::unique_ptr<record[]> slot;
+	size_t mask;
+	alignas(64) std::atomic<size_t> head {0};
+	alignas(64) std::atomic<size_t> tail {0};
+	std::atomic<bool> sleeping {false};
+	bool termination {false};
+	std::mutex mutex;
+	std::condition_variable cond;
+	std::condition_variable drained;
+	std::thread thread;
+
+	// Counters for log::stats(); pushed, dropped and blocked are only touched
+	// by the main thread, written and batches only by the writer thread.
+	size_t pushed {0};
+	size_t dropped {0};
+	size_t blocked {0};
+	std::atomic<size_t> written {0};
+	std::atomic<size_t> batches {0};
+
+	void write(const size_t &start, const size_t &stop) noexcept;
+	void worker() noexcept;
+	void notify() noexcept;
+
+  public:
+	size_t size() const;
+	size_t queued() const;
+
+	bool push(const string_view &msg, const int &file, const bool &out, const bool &err) noexcept;
+	void barrier() noexcept;
+
+	ring(const size_t &size);
+	~ring() noexcept;
+};
+
+struct ircd::log::ring::record
+{
+	static constexpr const size_t &MAX {1024};
+
+	int file;
+	uint16_t len;
+	bool out;
+	bool err;
+	char buf[MAX];
+};
+
+decltype(ircd::log::async_enable)
+ircd::log::async_enable
+{
+	{
+		{ "name",     "ircd.log.async.enable" },
+		{ "default",  true                    },
+	},
+	writer_reset
+};
+
+decltype(ircd::log::async_ring_size)
+ircd::log::async_ring_size
+{
+	{
+		{ "name",     "ircd.log.async.ring_size" },
+		{ "default",  2048L                      },
+	},
+	writer_reset
+};
+
+decltype(ircd::log::async_overflow)
+ircd::log::async_overflow
+{
+	{
+		{ "name",     "ircd.log.async.overflow" },
+		{ "default",  "drop"                    },
+	}, []
+	{
+		overflow_policy = reflect_overflow(async_overflow);
+	}
+};
+
+/// (Re)creates the writer thread according to the async conf items. The
+/// previous writer, if any, is drained before it is destroyed.
+void
+ircd::log::writer_reset()
+{
+	// Conf items may call back during static initialization or from an
+	// environmental variable before init().
+	if(!writer_allowed)
+		return;
+
+	flush();
+	writer.reset();
+	overflow_policy = reflect_overflow(async_overflow);
+	if(!bool(async_enable))
+		return;
+
+	// Anything buffered by the streams has to go out before the writer
+	// starts writing to the same descriptors.
+	std::flush(out_console);
+	std::flush(err_console);
+	writer = std::make_unique<ring>(size_t(async_ring_size));
+}
+
+ircd::log::overflow
+ircd::log::reflect_overflow(const string_view &str)
+{
+	if(str == "block")
+		return overflow::BLOCK;
+
+	return overflow::DROP;
+}
+
+/// Waits for everything logged so far to be written out. This is the barrier
+/// for fatal paths; it blocks the thread and does not yield the ctx.
+void
+ircd::log::flush()
+{
+	if(writer)
+		writer->barrier();
+
+	std::flush(out_console);
+	std::flush(err_console);
+}
+
+ircd::log::ring_stats
+ircd::log::stats()
+{
+	if(!writer)
+		return {};
+
+	ring_stats ret;
+	ret.size = writer->size();
+	ret.queued = writer->queued();
+	ret.pushed = writer->pushed;
+	ret.written = writer->written;
+	ret.dropped = writer->dropped;
+	ret.blocked = writer->blocked;
+	ret.batches = writer->batches;
+	return ret;
+}
+
+//
+// ring::ring
+//
+
+ircd::log::ring::ring(const size_t &size)
+:mask
+{
+	// Round the slot count up to a power of two so positions can be masked.
+	is_powerof2(size)?
+		size - 1:
+		(1UL << (64 - __builtin_clzl(std::max(size, 2UL)))) - 1
+}
+{
+	slot = std::make_unique<record[]>(mask + 1);
+	thread = std::thread{&ring::worker, this};
+}
+
+ircd::log::ring::~ring()
+noexcept
+{
+	{
+		const std::lock_guard<decltype(mutex)> lock(mutex);
+		termination = true;
+		cond.notify_all();
+	}
+
+	thread.join();
+}
+
+bool
+ircd::log::ring::push(const string_view &msg,
+                      const int &file,
+                      const bool &out,
+                      const bool &err)
+noexcept
+{
+	assert(is_main_thread());
+	const auto pos
+	{
+		head.load(std::memory_order_relaxed)
+	};
+
+	while(unlikely(pos - tail.load(std::memory_order_acquire) > mask))
+	{
+		if(overflow_policy == overflow::DROP)
+		{
+			++dropped;
+			return false;
+		}
+
+		++blocked;
+		notify();
+		std::this_thread::yield();
+	}
+
+	auto &rec(slot[pos & mask]);
+	rec.file = file;
+	rec.out = out;
+	rec.err = err;
+	rec.len = copy(mutable_buffer{rec.buf}, const_buffer{msg});
+	++pushed;
+
+	// Publishing head and then reading sleeping (both seq_cst) pairs with
+	// the worker setting sleeping and then reading head; one of the two
+	// sides is guaranteed to see the other.
+	head.store(pos + 1);
+	if(sleeping.load())
+		notify();
+
+	return true;
+}
+
+void
+ircd::log::ring::barrier()
+noexcept
+{
+	const auto pos
+	{
+		head.load()
+	};
+
+	std::unique_lock<decltype(mutex)> lock(mutex);
+	cond.notify_all();
+	drained.wait(lock, [this, &pos]
+	{
+		return tail.load() >= pos || termination;
+	});
+}
+
+void
+ircd::log::ring::notify()
+noexcept
+{
+	const std::lock_guard<decltype(mutex)> lock(mutex);
+	cond.notify_all();
+}
+
+void
+ircd::log::ring::worker()
+noexcept
+{
+	while(1)
+	{
+		const auto start(tail.load(std::memory_order_relaxed));
+		const auto stop(head.load(std::memory_order_acquire));
+		if(start != stop)
+		{
+			write(start, stop);
+			tail.store(stop, std::memory_order_release);
+
+			const std::lock_guard<decltype(mutex)> lock(mutex);
+			drained.notify_all();
+			continue;
+		}
+
+		std::unique_lock<decltype(mutex)> lock(mutex);
+		sleeping.store(true);
+		cond.wait(lock, [this, &stop]
+		{
+			return head.load() != stop || termination;
+		});
+
+		sleeping.store(false);
+		if(termination && head.load() == stop)
+			break;
+	}
+}
+
+/// Writes the records in [start, stop) grouped by descriptor so each target
+/// receives one writev(2) per UIO_MAXIOV lines while keeping its line order.
+void
+ircd::log::ring::write(const size_t &start,
+                       const size_t &stop)
+noexcept
+{
+	struct target
+	{
+		int fd;
+		size_t cnt;
+		std::array<struct ::iovec, UIO_MAXIOV> iov;
+	};
+
+	thread_local std::vector<std::unique_ptr<target>> targets;
+	const auto get{[](const int &fd) -> target &
+	{
+		for(const auto &t : targets)
+			if(t->fd == fd)
+				return *t;
+
+		targets.emplace_back(std::make_unique<target>());
+		targets.back()->fd = fd;
+		targets.back()->cnt = 0;
+		return *targets.back();
+	}};
+
+	const auto append{[this, &get](const int &fd, const record &rec)
+	{
+		auto &t(get(fd));
+		t.iov[t.cnt++] =
+		{
+			const_cast<char *>(rec.buf), rec.len
+		};
+
+		if(t.cnt < t.iov.size())
+			return;
+
+		write_iov(t.fd, t.iov.data(), t.cnt);
+		++batches;
+		t.cnt = 0;
+	}};
+
+	for(size_t pos(start); pos != stop; ++pos)
+	{
+		const auto &rec(slot[pos & mask]);
+		if(rec.err)
+			append(STDERR_FILENO, rec);
+
+		if(rec.out)
+			append(STDOUT_FILENO, rec);
+
+		if(rec.file >= 0)
+			append(rec.file, rec);
+	}
+
+	for(const auto &t : targets)
+	{
+		if(!t->cnt)
+			continue;
+
+		write_iov(t->fd, t->iov.data(), t->cnt);
+		++batches;
+		t->cnt = 0;
+	}
+
+	written += stop - start;
+}
+
+size_t
+ircd::log::ring::queued()
+const
+{
+	return head.load() - tail.load();
+}
+
+size_t
+ircd::log::ring::size()
+const
+{
+	return mask + 1;
+}
+
 void
 ircd::log::console_enable()
 {
@@ -481,11 +852,11 @@ noexcept
 {
 	// When all of these conditions are true there is no possible log output
 	// so we can bail real quick.
-	if(!file[fac].is_open() && !console_out[fac] && !console_err[fac])
+	if(!file[fac] && !console_out[fac] && !console_err[fac])
 		return;
 
 	// Same for this set of conditions...
-	if((!file[fac].is_open() || !log.fmasked) && !log.cmasked)
+	if((!file[fac] || !log.fmasked) && !log.cmasked)
 		return;
 
 	// Have to be on the main thread to call slog().
@@ -541,9 +912,25 @@ noexcept
 	buf[len++] = '\r';
 	buf[len++] = '\n';
 
-	// Closure to copy the message to various places
 	assert(len <= sizeof(buf));
 	const string_view msg{buf, len};
+	const bool to_err(log.cmasked && console_err[fac]);
+	const bool to_out(log.cmasked && console_out[fac]);
+	const int to_file(log.fmasked && file[fac]? int(file[fac]) : -1);
+
+	// When the writer thread is running the line is only copied into its
+	// ring here; the thread makes the blocking writes. CRITICAL is usually
+	// the last thing said before a crash so we wait for it to hit the disk.
+	if(writer)
+	{
+		writer->push(msg, to_file, to_out, to_err);
+		if(fac == CRITICAL)
+			writer->barrier();
+
+		return;
+	}
+
+	// Closure to copy the message to various places
 	const auto write{[&msg](std::ostream &s)
 	{
 		check(s);
@@ -551,14 +938,14 @@ noexcept
 	}};
 
 	// copy to std::cerr
-	if(log.cmasked && console_err[fac])
+	if(to_err)
 	{
 		err_console.clear();
 		write(err_console);
 	}
 
 	// copy to std::cout
-	if(log.cmasked && console_out[fac])
+	if(to_out)
 	{
 		out_console.clear();
 		write(out_console);
@@ -567,12 +954,50 @@ noexcept
 	}
 
 	// copy to file
-	if(log.fmasked && file[fac].is_open())
+	if(to_file >= 0)
+	{
+		struct ::iovec iov
+		{
+			const_cast<char *>(data(msg)), size(msg)
+		};
+
+		write_iov(to_file, &iov, 1);
+	}
+}
+
+/// Writes the whole iovec to the descriptor; partial writes and EINTR are
+/// retried. This can't throw or log on failure, so failure goes to stderr.
+void
+ircd::log::write_iov(const int &fd,
+                 struct ::iovec *iov,
+                 size_t cnt)
+noexcept
+{
+	while(cnt)
 	{
-		file[fac].clear();
-		write(file[fac]);
-		if(file_flush[fac])
-			std::flush(file[fac]);
+		const ssize_t ret
+		{
+			::writev(fd, iov, cnt)
+		};
+
+		if(unlikely(ret < 0 && errno == EINTR))
+			continue;
+
+		if(unlikely(ret < 0))
+		{
+			fprintf(stderr, "log fd(%d) write failed: %s\n", fd, strerror(errno));
+			return;
+		}
+
+		size_t rem(ret);
+		for(; cnt && rem >= iov->iov_len; ++iov, --cnt)
+			rem -= iov->iov_len;
+
+		if(cnt && rem)
+		{
+			iov->iov_base = reinterpret_cast<char *>(iov->iov_base) + rem;
+			iov->iov_len -= rem;
+		}
 	}
 }
 
@@ -26,6 +26,16 @@ decltype(ircd::m::dbs::event_idx)
 ircd::m::dbs::event_idx
 {};
 
+/// Linkage for a reference to the id_idx column.
+decltype(ircd::m::dbs::id_idx)
+ircd::m::dbs::id_idx
+{};
+
+/// Linkage for a reference to the idx_id column.
+decltype(ircd::m::dbs::idx_id)
+ircd::m::dbs::idx_id
+{};
+
 /// Linkage for a reference to the room_head column
 decltype(ircd::m::dbs::room_head)
 ircd::m::dbs::room_head
@@ -51,6 +61,68 @@ decltype(ircd::m::dbs::state_node)
 ircd::m::dbs::state_node
 {};
 
+namespace ircd::m::dbs
+{
+	struct id_alloc;
+
+	static void _id_cache(const string_view &id, const uint64_t &id_idx);
+	static void _id_append(db::txn &, const string_view &id, const uint64_t &id_idx);
+	static uint64_t _room_idx(db::txn &, const event &, const write_opts &);
+	static bool _legacy_key(const string_view &key);
+	static size_t _upgrade_keys(db::column &, const bool &joined);
+	static void _upgrade();
+
+	extern std::map<std::string, uint64_t, std::less<>> id_cache;
+	extern std::map<std::string, id_alloc, std::less<>> id_pending;
+	extern uint64_t id_released;
+	extern uint64_t id_sequence;
+	extern const uint64_t schema_version;
+}
+
+/// An index allocated in the dictionary by txns which are not yet committed
+/// or abandoned; see id_release().
+struct ircd::m::dbs::id_alloc
+{
+	uint64_t id_idx;
+	std::vector<const db::txn *> txns;
+};
+
+/// Identifiers recently resolved in the dictionary. Only committed entries
+/// are cached, so dropping the cache when it is full loses nothing.
+decltype(ircd::m::dbs::id_cache)
+ircd::m::dbs::id_cache;
+
+/// Allocations which are not yet committed, by identifier, so concurrent
+/// writers agree on the index for a new identifier. These are never evicted;
+/// an entry lives until every txn holding it is released.
+decltype(ircd::m::dbs::id_pending)
+ircd::m::dbs::id_pending;
+
+/// Count of allocations which have left id_pending. A reader which saw an
+/// identifier absent from the column rechecks it when this has changed.
+decltype(ircd::m::dbs::id_released)
+ircd::m::dbs::id_released;
+
+/// The greatest index allocated in the dictionary.
+decltype(ircd::m::dbs::id_sequence)
+ircd::m::dbs::id_sequence;
+
+/// Version of the index key format; it is recorded in the _idx_id column
+/// under the invalid index 0. Version 0 is the textual room_id prefix from
+/// before the dictionary; version 1 is the dictionary-encoded format.
+decltype(ircd::m::dbs::schema_version)
+ircd::m::dbs::schema_version
+{
+	1
+};
+
+decltype(ircd::m::dbs::id_cache_max)
+ircd::m::dbs::id_cache_max
+{
+	{ "name",     "ircd.m.dbs.id_cache.max" },
+	{ "default",  65536L                    },
+};
+
 /// Coarse variable for enabling the uncompressed cache on the events database;
 /// note this conf item is only effective by setting an environmental variable
 /// before daemon startup. It has no effect in any other regard.
@@ -126,11 +198,194 @@ ircd::m::dbs::init::init(std::string dbopts)
 
 	// Cache the columns for the metadata
 	event_idx = db::column{*events, desc::events__event_idx.name};
+	id_idx = db::column{*events, desc::events__id_idx.name};
+	idx_id = db::column{*events, desc::events__idx_id.name};
 	room_head = db::index{*events, desc::events__room_head.name};
 	room_events = db::index{*events, desc::events__room_events.name};
 	room_joined = db::index{*events, desc::events__room_joined.name};
 	room_state = db::index{*events, desc::events__room_state.name};
 	state_node = db::column{*events, desc::events__state_node.name};
+
+	// The dictionary continues from the greatest index allocated.
+	const auto it
+	{
+		idx_id.rbegin()
+	};
+
+	id_sequence = it? uint64_t(byte_view<uint64_t>(it->first)) : 0UL;
+
+	// Convert the index keys of a database written by an older schema.
+	uint64_t version{0};
+	idx_id(byte_view<string_view>(0UL), std::nothrow, [&version]
+	(const string_view &value)
+	{
+		version = byte_view<uint64_t>(value);
+	});
+
+	if(version < schema_version)
+		_upgrade();
+}
+
+/// Rewrites the room_head, room_events, room_joined and room_state keys of
+/// a database from before the dictionary in place, building the dictionary
+/// from the identifiers found in them, then records the schema version. An
+/// interrupted upgrade resumes on the next open.
+void
+ircd::m::dbs::_upgrade()
+{
+	log::notice
+	{
+		log, "Upgrading the index keys of the events database to schema version %lu...",
+		schema_version
+	};
+
+	size_t count(0);
+	count += _upgrade_keys(room_head, false);
+	count += _upgrade_keys(room_events, false);
+	count += _upgrade_keys(room_joined, true);
+	count += _upgrade_keys(room_state, false);
+
+	db::txn txn
+	{
+		*events
+	};
+
+	db::txn::append
+	{
+		txn, idx_id,
+		{
+			db::op::SET,
+			byte_view<string_view>(0UL),
+			byte_view<string_view>(schema_version)
+		}
+	};
+
+	txn();
+	log::info
+	{
+		log, "Upgraded %zu index keys; %lu identifiers in the dictionary.",
+		count,
+		id_sequence
+	};
+}
+
+/// Converts the legacy keys of one index. After the room_id the legacy and
+/// present formats are the same, except room_joined where the origin and
+/// member become their dictionary indexes. Each batch deletes the legacy
+/// keys in the txn writing their replacements.
+size_t
+ircd::m::dbs::_upgrade_keys(db::column &column,
+                            const bool &joined)
+{
+	static const size_t batch_max
+	{
+		65536
+	};
+
+	db::txn txn
+	{
+		*events
+	};
+
+	const auto commit{[&txn]
+	{
+		txn();
+		id_release(txn);
+		txn.clear();
+	}};
+
+	const unwind release{[&txn]
+	{
+		id_release(txn);
+	}};
+
+	size_t ret(0);
+	for(auto it(column.begin()); it; ++it)
+	{
+		const auto &[key, val]
+		{
+			*it
+		};
+
+		if(!_legacy_key(key))
+			continue;
+
+		const auto &[room_id, post]
+		{
+			split(key, "\0"_sv)
+		};
+
+		const uint64_t room_idx
+		{
+			id_index(txn, room_id)
+		};
+
+		char buf[std::max(ROOM_STATE_KEY_MAX_SIZE, ROOM_HEAD_KEY_MAX_SIZE)];
+		mutable_buffer out{buf};
+		if(joined)
+		{
+			// legacy: room_id | \0 origin @member
+			const auto &[origin, member]
+			{
+				split(post, '@')
+			};
+
+			assert(!empty(member));
+			const string_view &user_id
+			{
+				begin(member) - 1, end(member)
+			};
+
+			consume(out, size(room_joined_key(out, room_idx, id_index(txn, origin), id_index(txn, user_id))));
+		}
+		else
+		{
+			consume(out, size(room_key(out, room_idx)));
+			consume(out, copy(out, string_view{end(room_id), end(key)}));
+		}
+
+		db::txn::append
+		{
+			txn, column,
+			{
+				db::op::SET,
+				string_view{buf, data(out)},
+				val
+			}
+		};
+
+		db::txn::append
+		{
+			txn, column,
+			{
+				db::op::DELETE,
+				key
+			}
+		};
+
+		if(++ret % batch_max == 0)
+			commit();
+	}
+
+	commit();
+	if(ret)
+		log::info
+		{
+			log, "Upgraded %zu keys in '%s'",
+			ret,
+			db::name(column)
+		};
+
+	return ret;
+}
+
+/// Keys written before the dictionary begin with the textual room_id. The
+/// present keys begin with the big-endian room_idx whose first byte is zero
+/// (for any index below 2^56) so the two can't be confused.
+bool
+ircd::m::dbs::_legacy_key(const string_view &key)
+{
+	return !empty(key) && key.front() == '!';
 }
 
 /// Shuts down the m::dbs subsystem; closes the events database. The extern
@@ -177,14 +432,18 @@ ircd::m::dbs::blacklist(db::txn &txn,
 ircd::string_view
 ircd::m::dbs::write(db::txn &txn,
                     const event &event,
-                    const write_opts &opts)
+                    const write_opts &opts_)
 {
-	if(unlikely(opts.event_idx == 0))
+	if(unlikely(opts_.event_idx == 0))
 		throw ircd::error
 		{
 			"Cannot write to database: no index specified for event."
 		};
 
+	// The room's dictionary index is resolved once for all of the indexes.
+	write_opts opts{opts_};
+	opts.room_idx = _room_idx(txn, event, opts_);
+
 	// event_idx
 	if(opts.indexer)
 		_index__event(txn, event, opts);
@@ -328,6 +587,11 @@ ircd::m::dbs::_index__room_head(db::txn &txn,
                                 const event &event,
                                 const write_opts &opts)
 {
+	const uint64_t room_idx
+	{
+		_room_idx(txn, event, opts)
+	};
+
 	thread_local char buf[ROOM_HEAD_KEY_MAX_SIZE];
 	const ctx::critical_assertion ca;
 
@@ -335,7 +599,7 @@ ircd::m::dbs::_index__room_head(db::txn &txn,
 	{
 		const string_view &key
 		{
-			room_head_key(buf, at<"room_id"_>(event), at<"event_id"_>(event))
+			room_head_key(buf, room_idx, at<"event_id"_>(event))
 		};
 
 		db::txn::append
@@ -365,7 +629,7 @@ ircd::m::dbs::_index__room_head(db::txn &txn,
 
 			const string_view &key
 			{
-				room_head_key(buf, at<"room_id"_>(event), event_id)
+				room_head_key(buf, room_idx, event_id)
 			};
 
 			db::txn::append
@@ -388,11 +652,16 @@ ircd::m::dbs::_index__room_events(db::txn &txn,
                                   const write_opts &opts,
                                   const string_view &new_root)
 {
+	const uint64_t room_idx
+	{
+		_room_idx(txn, event, opts)
+	};
+
 	const ctx::critical_assertion ca;
 	thread_local char buf[ROOM_EVENTS_KEY_MAX_SIZE];
 	const string_view &key
 	{
-		room_events_key(buf, at<"room_id"_>(event), at<"depth"_>(event), opts.event_idx)
+		room_events_key(buf, room_idx, at<"depth"_>(event), opts.event_idx)
 	};
 
 	db::txn::append
@@ -419,11 +688,30 @@ ircd::m::dbs::_index__room_joined(db::txn &txn,
 	if(at<"type"_>(event) != "m.room.member")
 		return;
 
+	const uint64_t room_idx
+	{
+		_room_idx(txn, event, opts)
+	};
+
+	const uint64_t origin_idx
+	{
+		opts.op == db::op::SET?
+			id_index(txn, at<"origin"_>(event)):
+			id_index(at<"origin"_>(event))
+	};
+
+	const uint64_t user_idx
+	{
+		opts.op == db::op::SET?
+			id_index(txn, at<"state_key"_>(event)):
+			id_index(at<"state_key"_>(event))
+	};
+
 	const ctx::critical_assertion ca;
 	thread_local char buf[ROOM_JOINED_KEY_MAX_SIZE];
 	const string_view &key
 	{
-		room_joined_key(buf, at<"room_id"_>(event), at<"origin"_>(event), at<"state_key"_>(event))
+		room_joined_key(buf, room_idx, origin_idx, user_idx)
 	};
 
 	const string_view &membership
@@ -473,11 +761,16 @@ ircd::m::dbs::_index__room_state(db::txn &txn,
 	if(!opts.present)
 		return;
 
+	const uint64_t room_idx
+	{
+		_room_idx(txn, event, opts)
+	};
+
 	const ctx::critical_assertion ca;
 	thread_local char buf[ROOM_STATE_KEY_MAX_SIZE];
 	const string_view &key
 	{
-		room_state_key(buf, at<"room_id"_>(event), at<"type"_>(event), at<"state_key"_>(event))
+		room_state_key(buf, room_idx, at<"type"_>(event), at<"state_key"_>(event))
 	};
 
 	const string_view val
@@ -603,6 +896,235 @@ ircd::m::dbs::state_root(const mutable_buffer &out,
 	return ret;
 }
 
+/// The room's index in the dictionary for the index keys of an event. It's
+/// only allocated when the event is being written; queries and deletes for
+/// an unknown room use the invalid index zero which matches nothing.
+uint64_t
+ircd::m::dbs::_room_idx(db::txn &txn,
+                        const event &event,
+                        const write_opts &opts)
+{
+	if(opts.room_idx)
+		return opts.room_idx;
+
+	const auto &room_id
+	{
+		at<"room_id"_>(event)
+	};
+
+	return opts.op == db::op::SET?
+		id_index(txn, room_id):
+		id_index(room_id);
+}
+
+//
+// Identifier dictionary
+//
+
+/// Find the index of an identifier in the dictionary; returns 0 if the
+/// identifier is unknown.
+uint64_t
+ircd::m::dbs::id_index(const string_view &id)
+{
+	const auto it
+	{
+		id_cache.find(id)
+	};
+
+	if(it != end(id_cache))
+		return it->second;
+
+	const auto pit
+	{
+		id_pending.find(id)
+	};
+
+	if(pit != end(id_pending))
+		return pit->second.id_idx;
+
+	uint64_t ret{0};
+	id_idx(id, std::nothrow, [&ret]
+	(const string_view &value)
+	{
+		ret = byte_view<uint64_t>(value);
+	});
+
+	if(ret)
+		_id_cache(id, ret);
+
+	return ret;
+}
+
+/// Find the index of an identifier in the dictionary or allocate the next
+/// index for it in the txn. Until it is committed an allocation is held in
+/// id_pending; every txn using it appends the entry so it is committed with
+/// whichever txn is first. The txn must be given to id_release() once it is
+/// committed or abandoned.
+///
+/// The column read can yield; another txn may allocate, commit or release
+/// the same identifier meanwhile, so the lookups are repeated after it.
+uint64_t
+ircd::m::dbs::id_index(db::txn &txn,
+                       const string_view &id)
+{
+	assert(!empty(id));
+	while(1)
+	{
+		const auto it
+		{
+			id_cache.find(id)
+		};
+
+		if(it != end(id_cache))
+			return it->second;
+
+		const auto pit
+		{
+			id_pending.find(id)
+		};
+
+		if(pit != end(id_pending))
+		{
+			auto &alloc(pit->second);
+			if(std::find(begin(alloc.txns), end(alloc.txns), &txn) == end(alloc.txns))
+			{
+				alloc.txns.emplace_back(&txn);
+				_id_append(txn, id, alloc.id_idx);
+			}
+
+			return alloc.id_idx;
+		}
+
+		const auto released
+		{
+			id_released
+		};
+
+		uint64_t ret{0};
+		id_idx(id, std::nothrow, [&ret]
+		(const string_view &value)
+		{
+			ret = byte_view<uint64_t>(value);
+		});
+
+		if(ret)
+		{
+			_id_cache(id, ret);
+			return ret;
+		}
+
+		// An allocation made or committed during the read is joined or
+		// found by the next pass.
+		if(released != id_released || id_pending.count(id))
+			continue;
+
+		ret = ++id_sequence;
+		id_pending.emplace(std::string{id}, id_alloc{ret, {&txn}});
+		_id_append(txn, id, ret);
+		return ret;
+	}
+}
+
+/// Releases the allocations held by a txn once it has been committed or
+/// abandoned. A committed allocation is found in the column from then on;
+/// an abandoned one no other txn holds is forgotten, leaving a gap in the
+/// sequence.
+void
+ircd::m::dbs::id_release(const db::txn &txn)
+{
+	for(auto it(begin(id_pending)); it != end(id_pending);)
+	{
+		auto &txns(it->second.txns);
+		txns.erase(std::remove(begin(txns), end(txns), &txn), end(txns));
+		if(txns.empty())
+		{
+			it = id_pending.erase(it);
+			++id_released;
+		}
+		else ++it;
+	}
+}
+
+void
+ircd::m::dbs::_id_append(db::txn &txn,
+                         const string_view &id,
+                         const uint64_t &idx)
+{
+	db::txn::append
+	{
+		txn, id_idx,
+		{
+			db::op::SET,
+			id,
+			byte_view<string_view>(idx)
+		}
+	};
+
+	db::txn::append
+	{
+		txn, idx_id,
+		{
+			db::op::SET,
+			byte_view<string_view>(idx),
+			id
+		}
+	};
+}
+
+/// Find the identifier for an index in the dictionary; returns an empty
+/// string if the index is unknown.
+ircd::string_view
+ircd::m::dbs::id_string(const mutable_buffer &out,
+                        const uint64_t &id_idx)
+{
+	string_view ret;
+	if(unlikely(!id_idx))
+		return ret;
+
+	idx_id(byte_view<string_view>(id_idx), std::nothrow, [&out, &ret]
+	(const string_view &value)
+	{
+		ret = { data(out), copy(out, value) };
+	});
+
+	return ret;
+}
+
+void
+ircd::m::dbs::_id_cache(const string_view &id,
+                        const uint64_t &id_idx)
+{
+	if(id_cache.size() >= size_t(id_cache_max))
+		id_cache.clear();
+
+	id_cache.emplace(std::string{id}, id_idx);
+}
+
+ircd::string_view
+ircd::m::dbs::room_key(const mutable_buffer &out,
+                       const id::room &room_id)
+{
+	return room_key(out, id_index(room_id));
+}
+
+ircd::string_view
+ircd::m::dbs::room_key(const mutable_buffer &out,
+                       const uint64_t &room_idx)
+{
+	// Big-endian so the first byte is zero; see _legacy_key().
+	const uint64_t room_idx_be
+	{
+		hton(room_idx)
+	};
+
+	const const_buffer room_idx_cb
+	{
+		reinterpret_cast<const char *>(&room_idx_be), sizeof(room_idx_be)
+	};
+
+	return { data(out), copy(out, room_idx_cb) };
+}
+
 //
 // Database descriptors
 //
@@ -714,6 +1236,181 @@ ircd::m::dbs::desc::events__event_idx
 	size_t(events__event_idx__meta_block__size),
 };
 
+//
+// id_idx
+//
+
+decltype(ircd::m::dbs::desc::events__id_idx__block__size)
+ircd::m::dbs::desc::events__id_idx__block__size
+{
+	{ "name",     "ircd.m.dbs.events._id_idx.block.size" },
+	{ "default",  512L                                   },
+};
+
+decltype(ircd::m::dbs::desc::events__id_idx__cache__size)
+ircd::m::dbs::desc::events__id_idx__cache__size
+{
+	{
+		{ "name",     "ircd.m.dbs.events._id_idx.cache.size" },
+		{ "default",  long(16_MiB)                           },
+	}, []
+	{
+		const size_t &value{events__id_idx__cache__size};
+		db::capacity(db::cache(id_idx), value);
+	}
+};
+
+decltype(ircd::m::dbs::desc::events__id_idx__bloom__bits)
+ircd::m::dbs::desc::events__id_idx__bloom__bits
+{
+	{ "name",     "ircd.m.dbs.events._id_idx.bloom.bits" },
+	{ "default",  10L                                    },
+};
+
+const ircd::db::descriptor
+ircd::m::dbs::desc::events__id_idx
+{
+	// name
+	"_id_idx",
+
+	// explanation
+	R"(Maps room_id, user_id and origin strings into internal index numbers.
+
+	id => id_idx
+
+	The dictionary for the metadata index keys. Rather than embedding these
+	identifiers (each up to 255 bytes) in every key of an index, the keys use
+	the fixed 8 byte index number found here. Index numbers are allocated
+	sequentially from 1 as identifiers are first written; 0 is not valid.
+
+	)",
+
+	// typing (key, value)
+	{
+		typeid(string_view), typeid(uint64_t)
+	},
+
+	// options
+	{},
+
+	// comparator
+	{},
+
+	// prefix transform
+	{},
+
+	// drop column
+	false,
+
+	// cache size
+	bool(events_cache_enable)? -1 : 0,
+
+	// cache size for compressed assets
+	0,
+
+	// bloom filter bits
+	size_t(events__id_idx__bloom__bits),
+
+	// expect queries hit
+	true,
+
+	// block size
+	size_t(events__id_idx__block__size),
+};
+
+//
+// idx_id
+//
+
+decltype(ircd::m::dbs::desc::events__idx_id__block__size)
+ircd::m::dbs::desc::events__idx_id__block__size
+{
+	{ "name",     "ircd.m.dbs.events._idx_id.block.size" },
+	{ "default",  512L                                   },
+};
+
+decltype(ircd::m::dbs::desc::events__idx_id__cache__size)
+ircd::m::dbs::desc::events__idx_id__cache__size
+{
+	{
+		{ "name",     "ircd.m.dbs.events._idx_id.cache.size" },
+		{ "default",  long(8_MiB)                            },
+	}, []
+	{
+		const size_t &value{events__idx_id__cache__size};
+		db::capacity(db::cache(idx_id), value);
+	}
+};
+
+const ircd::db::descriptor
+ircd::m::dbs::desc::events__idx_id
+{
+	// name
+	"_idx_id",
+
+	// explanation
+	R"(Maps internal index numbers back into room_id, user_id and origin strings.
+
+	id_idx => id
+
+	The reverse of the _id_idx dictionary, used to present the identifiers in
+	index keys (i.e. the members of a room) to the user. Index 0 is not valid;
+	its entry instead records the version of the index key format.
+
+	)",
+
+	// typing (key, value)
+	{
+		typeid(uint64_t), typeid(string_view)
+	},
+
+	// options
+	{},
+
+	// comparator
+	{},
+
+	// prefix transform
+	{},
+
+	// drop column
+	false,
+
+	// cache size
+	bool(events_cache_enable)? -1 : 0,
+
+	// cache size for compressed assets
+	0,
+
+	// bloom filter bits
+	0, // keys are sequential integers
+
+	// expect queries hit
+	true,
+
+	// block size
+	size_t(events__idx_id__block__size),
+};
+
+/// Prefix transform for the room indexes. The prefix of every key in these
+/// columns is the fixed 8 byte (big-endian) index of the room_id in the
+/// dictionary.
+///
+const ircd::db::prefix_transform
+ircd::m::dbs::desc::events__room__pfx
+{
+	"_room",
+	[](const string_view &key)
+	{
+		return size(key) >= ROOM_KEY_SIZE;
+	},
+
+	[](const string_view &key)
+	{
+		return key.substr(0, ROOM_KEY_SIZE);
+	}
+};
+
 //
 // room_head
 //
@@ -745,30 +1442,21 @@ ircd::m::dbs::desc::events__room_head__cache__size
 	}
 };
 
-/// prefix transform for room_id,event_id in room_id
-///
-const ircd::db::prefix_transform
-ircd::m::dbs::desc::events__room_head__pfx
+ircd::string_view
+ircd::m::dbs::room_head_key(const mutable_buffer &out,
+                            const id::room &room_id,
+                            const id::event &event_id)
 {
-	"_room_head",
-	[](const string_view &key)
-	{
-		return has(key, "\0"_sv);
-	},
-
-	[](const string_view &key)
-	{
-		return split(key, "\0"_sv).first;
-	}
-};
+	return room_head_key(out, id_index(room_id), event_id);
+}
 
 ircd::string_view
 ircd::m::dbs::room_head_key(const mutable_buffer &out_,
-                            const id::room &room_id,
+                            const uint64_t &room_idx,
                             const id::event &event_id)
 {
 	mutable_buffer out{out_};
-	consume(out, copy(out, room_id));
+	consume(out, size(room_key(out, room_idx)));
 	consume(out, copy(out, "\0"_sv));
 	consume(out, copy(out, event_id));
 	return { data(out_), data(out) };
@@ -799,9 +1487,9 @@ ircd::m::dbs::desc::events__room_head
 	// explanation
 	R"(Unreferenced events in a room.
 
-	[room_id | event_id => event_idx]
+	[room_idx | event_id => event_idx]
 
-	The key is a room_id and event_id concatenation. The value is an event_idx
+	The key is a room_idx and event_id concatenation. The value is an event_idx
 	of the event_id in the key. The key amalgan was specifically selected to
 	allow for DELETES sent to the WAL "in the blind" for all prev_events when
 	any new event is saved to the database, without making any read IO's to
@@ -826,7 +1514,7 @@ ircd::m::dbs::desc::events__room_head
 	{},
 
 	// prefix transform
-	events__room_head__pfx,
+	events__room__pfx,
 
 	// drop column
 	false,
@@ -897,30 +1585,14 @@ ircd::m::dbs::desc::events__room_events__cache_comp__size
 	}
 };
 
-/// Prefix transform for the events__room_events. The prefix here is a room_id
-/// and the suffix is the depth+event_id concatenation.
-/// for efficient sequences
-///
-const ircd::db::prefix_transform
-ircd::m::dbs::desc::events__room_events__pfx
-{
-	"_room_events",
-
-	[](const string_view &key)
-	{
-		return has(key, "\0"_sv);
-	},
-
-	[](const string_view &key)
-	{
-		return split(key, "\0"_sv).first;
-	}
-};
-
 /// Comparator for the events__room_events. The goal here is to sort the
 /// events within a room by their depth from highest to lowest, so the
 /// highest depth is hit first when a room is sought from this column.
 ///
+/// Keys from before the dictionary (prefixed by the textual room_id) sort
+/// ahead of all others and in their original order, so a database can be
+/// opened and upgraded in place; see _upgrade().
+///
 const ircd::db::comparator
 ircd::m::dbs::desc::events__room_events__cmp
 {
@@ -931,14 +1603,23 @@ ircd::m::dbs::desc::events__room_events__cmp
 	{
 		static const auto &pt
 		{
-			events__room_events__pfx
+			events__room__pfx
+		};
+
+		const bool legacy[2]
+		{
+			_legacy_key(a),
+			_legacy_key(b),
 		};
 
+		if(legacy[0] != legacy[1])
+			return legacy[0];
+
 		// Extract the prefix from the keys
 		const string_view pre[2]
 		{
-			pt.get(a),
-			pt.get(b),
+			legacy[0]? split(a, "\0"_sv).first : pt.get(a),
+			legacy[1]? split(b, "\0"_sv).first : pt.get(b),
 		};
 
 		if(size(pre[0]) != size(pre[1]))
@@ -996,17 +1677,26 @@ ircd::m::dbs::room_events_key(const mutable_buffer &out_,
 	};
 
 	mutable_buffer out{out_};
-	consume(out, copy(out, room_id));
+	consume(out, size(room_key(out, room_id)));
 	consume(out, copy(out, "\0"_sv));
 	consume(out, copy(out, depth_cb));
 	return { data(out_), data(out) };
 }
 
 ircd::string_view
-ircd::m::dbs::room_events_key(const mutable_buffer &out_,
+ircd::m::dbs::room_events_key(const mutable_buffer &out,
                               const id::room &room_id,
                               const uint64_t &depth,
                               const event::idx &event_idx)
+{
+	return room_events_key(out, id_index(room_id), depth, event_idx);
+}
+
+ircd::string_view
+ircd::m::dbs::room_events_key(const mutable_buffer &out_,
+                              const uint64_t &room_idx,
+                              const uint64_t &depth,
+                              const event::idx &event_idx)
 {
 	const const_buffer depth_cb
 	{
@@ -1019,7 +1709,7 @@ ircd::m::dbs::room_events_key(const mutable_buffer &out_,
 	};
 
 	mutable_buffer out{out_};
-	consume(out, copy(out, room_id));
+	consume(out, size(room_key(out, room_idx)));
 	consume(out, copy(out, "\0"_sv));
 	consume(out, copy(out, depth_cb));
 	consume(out, copy(out, event_idx_cb));
@@ -1051,13 +1741,14 @@ ircd::m::dbs::room_events_key(const string_view &amalgam)
 
 /// This column stores events in sequence in a room. Consider the following:
 ///
-/// [room_id | depth + event_idx => state_root]
+/// [room_idx | depth + event_idx => state_root]
 ///
 /// The key is composed from three parts:
 ///
-/// - `room_id` is the official prefix, bounding the sequence. That means we
-/// make a blind query with just a room_id and get to the beginning of the
-/// sequence, then iterate until we stop before the next room_id (upper bound).
+/// - `room_idx` is the official prefix, bounding the sequence. That means we
+/// make a blind query with just a room_idx and get to the beginning of the
+/// sequence, then iterate until we stop before the next room_idx (upper bound).
+/// NOTE: room_idx is the fixed 8 byte index of the room_id in the dictionary.
 ///
 /// - `depth` is the ordering. Within the sequence, all elements are ordered by
 /// depth from HIGHEST TO LOWEST. The sequence will start at the highest depth.
@@ -1088,7 +1779,7 @@ ircd::m::dbs::desc::events__room_events
 	// explanation
 	R"(Indexes events in timeline sequence for a room; maps to m::state root.
 
-	[room_id | depth + event_idx => state_root]
+	[room_idx | depth + event_idx => state_root]
 
 	)",
 
@@ -1104,7 +1795,7 @@ ircd::m::dbs::desc::events__room_events
 	events__room_events__cmp,
 
 	// prefix transform
-	events__room_events__pfx,
+	events__room__pfx,
 
 	// drop column
 	false,
@@ -1179,70 +1870,82 @@ ircd::m::dbs::desc::events__room_joined__bloom__bits
 	{ "default",  6L                                          },
 };
 
-/// Prefix transform for the events__room_joined
-///
-const ircd::db::prefix_transform
-ircd::m::dbs::desc::events__room_joined__pfx
-{
-	"_room_joined",
-
-	[](const string_view &key)
-	{
-		return has(key, "\0"_sv);
-	},
-
-	[](const string_view &key)
-	{
-		return split(key, "\0"_sv).first;
-	}
-};
-
 ircd::string_view
 ircd::m::dbs::room_joined_key(const mutable_buffer &out_,
                               const id::room &room_id,
                               const string_view &origin)
 {
+	const uint64_t origin_idx
+	{
+		id_index(origin)
+	};
+
+	const const_buffer origin_idx_cb
+	{
+		reinterpret_cast<const char *>(&origin_idx), sizeof(origin_idx)
+	};
+
 	mutable_buffer out{out_};
-	consume(out, copy(out, room_id));
+	consume(out, size(room_key(out, room_id)));
 	consume(out, copy(out, "\0"_sv));
-	consume(out, copy(out, origin));
+	consume(out, copy(out, origin_idx_cb));
 	return { data(out_), data(out) };
 }
 
 ircd::string_view
-ircd::m::dbs::room_joined_key(const mutable_buffer &out_,
+ircd::m::dbs::room_joined_key(const mutable_buffer &out,
                               const id::room &room_id,
                               const string_view &origin,
                               const id::user &member)
 {
+	return room_joined_key(out, id_index(room_id), id_index(origin), id_index(member));
+}
+
+ircd::string_view
+ircd::m::dbs::room_joined_key(const mutable_buffer &out_,
+                              const uint64_t &room_idx,
+                              const uint64_t &origin_idx,
+                              const uint64_t &user_idx)
+{
+	const const_buffer origin_idx_cb
+	{
+		reinterpret_cast<const char *>(&origin_idx), sizeof(origin_idx)
+	};
+
+	const const_buffer user_idx_cb
+	{
+		reinterpret_cast<const char *>(&user_idx), sizeof(user_idx)
+	};
+
 	mutable_buffer out{out_};
-	consume(out, copy(out, room_id));
+	consume(out, size(room_key(out, room_idx)));
 	consume(out, copy(out, "\0"_sv));
-	consume(out, copy(out, origin));
-	consume(out, copy(out, member));
+	consume(out, copy(out, origin_idx_cb));
+	consume(out, copy(out, user_idx_cb));
 	return { data(out_), data(out) };
 }
 
-std::pair<ircd::string_view, ircd::string_view>
+/// Returns the dictionary indexes of the origin and the member; these are
+/// translated with id_string(). The member is 0 for an origin query key.
+std::pair<uint64_t, uint64_t>
 ircd::m::dbs::room_joined_key(const string_view &amalgam)
 {
-	const auto &key
-	{
-		lstrip(amalgam, "\0"_sv)
-	};
+	assert(size(amalgam) >= 1 + 8);
+	assert(amalgam.front() == '\0');
 
-	const auto &s
+	const uint64_t &origin_idx
 	{
-		split(key, "@"_sv)
+		*reinterpret_cast<const uint64_t *>(data(amalgam) + 1)
 	};
 
-	return
+	const uint64_t &user_idx
 	{
-		{ s.first },
-		!empty(s.second)?
-			string_view{begin(s.second) - 1, end(s.second)}:
-			string_view{}
+		size(amalgam) >= 1 + 8 + 8?
+			*reinterpret_cast<const uint64_t *>(data(amalgam) + 1 + 8):
+			0UL
 	};
+
+	return { origin_idx, user_idx };
 }
 
 const ircd::db::descriptor
@@ -1254,7 +1957,7 @@ ircd::m::dbs::desc::events__room_joined
 	// explanation
 	R"(Specifically indexes joined members of a room for fast iteration.
 
-	[room_id | origin + mxid] => event_idx
+	[room_idx | origin_idx + user_idx] => event_idx
 
 	)",
 
@@ -1270,7 +1973,7 @@ ircd::m::dbs::desc::events__room_joined
 	{},
 
 	// prefix transform
-	events__room_joined__pfx,
+	events__room__pfx,
 
 	// drop column
 	false,
@@ -1345,27 +2048,6 @@ ircd::m::dbs::desc::events__room_state__bloom__bits
 	{ "default",  10L                                        },
 };
 
-/// prefix transform for type,state_key in room_id
-///
-/// This transform is special for concatenating room_id with type and state_key
-/// in that order with prefix being the room_id (this may change to room_id+
-/// type
-///
-const ircd::db::prefix_transform
-ircd::m::dbs::desc::events__room_state__pfx
-{
-	"_room_state",
-	[](const string_view &key)
-	{
-		return has(key, "\0"_sv);
-	},
-
-	[](const string_view &key)
-	{
-		return split(key, "\0"_sv).first;
-	}
-};
-
 ircd::string_view
 ircd::m::dbs::room_state_key(const mutable_buffer &out_,
                              const id::room &room_id,
@@ -1375,13 +2057,22 @@ ircd::m::dbs::room_state_key(const mutable_buffer &out_,
 }
 
 ircd::string_view
-ircd::m::dbs::room_state_key(const mutable_buffer &out_,
+ircd::m::dbs::room_state_key(const mutable_buffer &out,
                              const id::room &room_id,
                              const string_view &type,
                              const string_view &state_key)
+{
+	return room_state_key(out, id_index(room_id), type, state_key);
+}
+
+ircd::string_view
+ircd::m::dbs::room_state_key(const mutable_buffer &out_,
+                             const uint64_t &room_idx,
+                             const string_view &type,
+                             const string_view &state_key)
 {
 	mutable_buffer out{out_};
-	consume(out, copy(out, room_id));
+	consume(out, size(room_key(out, room_idx)));
 
 	if(likely(defined(type)))
 	{
@@ -1426,12 +2117,12 @@ ircd::m::dbs::desc::events__room_state
 	// explanation
 	R"(The present state of the room.
 
-	[room_id | type + state_key] => event_idx
+	[room_idx | type + state_key] => event_idx
 
 	This column is also known as the "present state table." It contains the
 	very important present state of the room for this server. The key contains
-	plaintext room_id, type and state_key elements for direct point-lookup as
-	well as iteration. The value is the index of the apropos state event.
+	the room_idx and plaintext type and state_key elements for direct
+	point-lookup as well as iteration. The value is the index of the apropos state event.
 
 	)",
 
@@ -1447,7 +2138,7 @@ ircd::m::dbs::desc::events__room_state
 	{},
 
 	// prefix transform
-	events__room_state__pfx,
+	events__room__pfx,
 
 	// drop column
 	false,
@@ -1574,6 +2265,20 @@ ircd::m::dbs::desc::events__state_node
 
 	// meta_block size
 	size_t(events__state_node__meta_block__size),
+
+	// compression
+	"kLZ4Compression;kSnappyCompression",
+
+	// compactor
+	{
+		[](const db::compactor::args &args) -> db::op
+		{
+			const auto &node_dead(m::state::node_dead);
+			return node_dead && node_dead(args.key)?
+				db::op::DELETE:
+				db::op::GET;
+		}
+	},
 };
 
 //
@@ -3206,15 +3911,15 @@ ircd::m::dbs::desc::events
 	// Mapping of event_id to index number.
 	events__event_idx,
 
-	// (room_id, (depth, event_idx)) => (state_root)
+	// (room_idx, (depth, event_idx)) => (state_root)
 	// Sequence of all events for a room, ever.
 	events__room_events,
 
-	// (room_id, (origin, user_id)) => ()
+	// (room_idx, (origin_idx, user_idx)) => ()
 	// Sequence of all PRESENTLY JOINED joined for a room.
 	events__room_joined,
 
-	// (room_id, (type, state_key)) => (event_id)
+	// (room_idx, (type, state_key)) => (event_id)
 	// Sequence of the PRESENT STATE of the room.
 	events__room_state,
 
@@ -3222,10 +3927,18 @@ ircd::m::dbs::desc::events
 	// Mapping of state tree node id to node data.
 	events__state_node,
 
-	// (room_id, event_id) => (event_idx)
+	// (room_idx, event_id) => (event_idx)
 	// Mapping of all current head events for a room.
 	events__room_head,
 
+	// (room_id|user_id|origin) => (id_idx)
+	// Dictionary of the identifiers in the keys of the room indexes.
+	events__id_idx,
+
+	// (id_idx) => (room_id|user_id|origin)
+	// Reverse of the dictionary.
+	events__idx_id,
+
 	//
 	// These columns are legacy; they have been dropped from the schema.
 	//
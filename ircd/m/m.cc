@@ -576,6 +576,45 @@ decltype(ircd::m::vm::eval::id_ctr)
 ircd::m::vm::eval::id_ctr
 {};
 
+namespace ircd::m::vm
+{
+	static stats::histogram &eval_stat(const fault &);
+
+	extern std::array<std::unique_ptr<stats::histogram>, 9> eval_stats;
+}
+
+/// Latency of eval by result; indexed by the bit of the fault code with
+/// ACCEPT at zero.
+decltype(ircd::m::vm::eval_stats)
+ircd::m::vm::eval_stats{[]
+{
+	decltype(eval_stats) ret;
+	for(size_t i(0); i < ret.size(); ++i)
+		ret[i] = std::make_unique<stats::histogram>(json::members
+		{
+			{ "name",     "ircd.m.vm.eval.seconds"                    },
+			{ "help",     "Distribution of event evaluation times"   },
+			{ "scale",    1e-6                                        },
+			{ "labels",   json::members
+			{
+				{ "fault",    reflect(fault(i? 1U << (i - 1) : 0U))       },
+			}},
+		});
+
+	return ret;
+}()};
+
+ircd::stats::histogram &
+ircd::m::vm::eval_stat(const fault &code)
+{
+	const size_t i
+	{
+		code? 1U + __builtin_ctz(code) : 0U
+	};
+
+	return *eval_stats.at(std::min(i, eval_stats.size() - 1));
+}
+
 //
 // eval::eval
 //
@@ -687,12 +726,21 @@ ircd::m::vm::eval::operator()(const event &event)
 		"vm", "eval__event"
 	};
 
-	const vm::fault ret
+	const ircd::timer timer; try
 	{
-		function(*this, event)
-	};
+		const vm::fault ret
+		{
+			function(*this, event)
+		};
 
-	return ret;
+		eval_stat(ret)(timer.at<microseconds>());
+		return ret;
+	}
+	catch(const vm::error &e)
+	{
+		eval_stat(e.code)(timer.at<microseconds>());
+		throw;
+	}
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -1158,7 +1206,7 @@ const
 	char b58[size(hash) * 2];
 	return
 	{
-		buf, b58encode(b58, hash), my_host()
+		buf, b58encode_compat(b58, hash), my_host()
 	};
 }
 
@@ -1187,16 +1235,26 @@ ircd::m::events::rfor_each(const event::idx &start,
                            const event_filter &filter,
                            const closure_bool &closure)
 {
+	const json::strung source
+	{
+		filter
+	};
+
+	const room_event_filter::compiled compiled
+	{
+		json::object{source}
+	};
+
 	auto limit
 	{
 		json::get<"limit"_>(filter)?: 32L
 	};
 
-	return rfor_each(start, [&filter, &closure, &limit]
+	return rfor_each(start, [&compiled, &closure, &limit]
 	(const event::idx &event_idx, const m::event &event)
 	-> bool
 	{
-		if(!match(filter, event))
+		if(!compiled.match(event))
 			return true;
 
 		if(!closure(event_idx, event))
@@ -1266,16 +1324,26 @@ ircd::m::events::for_each(const event::idx &start,
                           const event_filter &filter,
                           const closure_bool &closure)
 {
+	const json::strung source
+	{
+		filter
+	};
+
+	const room_event_filter::compiled compiled
+	{
+		json::object{source}
+	};
+
 	auto limit
 	{
 		json::get<"limit"_>(filter)?: 32L
 	};
 
-	return for_each(start, [&filter, &closure, &limit]
+	return for_each(start, [&compiled, &closure, &limit]
 	(const event::idx &event_idx, const m::event &event)
 	-> bool
 	{
-		if(!match(filter, event))
+		if(!compiled.match(event))
 			return true;
 
 		if(!closure(event_idx, event))
@@ -1338,65 +1406,42 @@ ircd::m::events::for_each(const event::idx &start,
 // m/filter.h
 //
 
-//TODO: globular expression
-//TODO: tribool for contains_url; we currently ignore the false value.
+/// Matches a single event by compiling the filter for this call; callers
+/// matching more than one event should hold a room_event_filter::compiled.
 bool
 ircd::m::match(const room_event_filter &filter,
                const event &event)
 {
-	if(json::get<"contains_url"_>(filter) == true)
-		if(!at<"content"_>(event).has("url"))
-			return false;
-
-	for(const auto &room_id : json::get<"not_rooms"_>(filter))
-		if(at<"room_id"_>(event) == unquote(room_id))
-			return false;
-
-	if(empty(json::get<"rooms"_>(filter)))
-		return match(event_filter{filter}, event);
+	const json::strung source
+	{
+		filter
+	};
 
-	for(const auto &room_id : json::get<"rooms"_>(filter))
-		if(at<"room_id"_>(event) == unquote(room_id))
-			return match(event_filter{filter}, event);
+	const room_event_filter::compiled compiled
+	{
+		json::object{source}
+	};
 
-	return false;
+	return compiled.match(event);
 }
 
-//TODO: globular expression
+/// An event_filter is matched as a room_event_filter without the room and
+/// url conditions.
 bool
 ircd::m::match(const event_filter &filter,
                const event &event)
 {
-	for(const auto &type : json::get<"not_types"_>(filter))
-		if(at<"type"_>(event) == unquote(type))
-			return false;
-
-	for(const auto &sender : json::get<"not_senders"_>(filter))
-		if(at<"sender"_>(event) == unquote(sender))
-			return false;
-
-	if(empty(json::get<"senders"_>(filter)) && empty(json::get<"types"_>(filter)))
-		return true;
-
-	if(empty(json::get<"senders"_>(filter)))
+	const json::strung source
 	{
-		for(const auto &type : json::get<"types"_>(filter))
-			if(at<"type"_>(event) == unquote(type))
-				return true;
-
-		return false;
-	}
+		filter
+	};
 
-	if(empty(json::get<"types"_>(filter)))
+	const room_event_filter::compiled compiled
 	{
-		for(const auto &sender : json::get<"senders"_>(filter))
-			if(at<"sender"_>(event) == unquote(sender))
-				return true;
-
-		return false;
-	}
+		json::object{source}
+	};
 
-	return true;
+	return compiled.match(event);
 }
 
 //
@@ -1451,6 +1496,169 @@ ircd::m::room_event_filter::room_event_filter(const mutable_buffer &buf,
 {
 }
 
+//
+// room_event_filter::compiled
+//
+
+namespace ircd::m
+{
+	static bool glob(const string_view &pattern, const string_view &);
+
+	extern std::map<std::string, std::shared_ptr<const room_event_filter::compiled>, std::less<>> filter_cache;
+}
+
+decltype(ircd::m::room_event_filter::compiled::cache_max)
+ircd::m::room_event_filter::compiled::cache_max
+{
+	{ "name",     "ircd.m.filter.compiled.cache.max" },
+	{ "default",  512L                               },
+};
+
+decltype(ircd::m::filter_cache)
+ircd::m::filter_cache;
+
+/// Compiled filters are shared by the text of the filter; requests making
+/// the same query (i.e. paginating) reuse one compilation. The cache is
+/// dropped when full; holders keep their instance alive.
+std::shared_ptr<const ircd::m::room_event_filter::compiled>
+ircd::m::room_event_filter::compiled::get(const json::object &filter)
+{
+	const auto it(filter_cache.find(string_view{filter}));
+	if(it != end(filter_cache))
+		return it->second;
+
+	auto ret
+	{
+		std::make_shared<const compiled>(filter)
+	};
+
+	if(!size_t(cache_max))
+		return ret;
+
+	if(filter_cache.size() >= size_t(cache_max))
+		filter_cache.clear();
+
+	filter_cache.emplace(std::string{filter}, ret);
+	return ret;
+}
+
+ircd::m::room_event_filter::compiled::compiled(const json::object &filter)
+:source
+{
+	filter
+}
+,filter
+{
+	json::object{source}
+}
+,types{json::get<"types"_>(this->filter)}
+,not_types{json::get<"not_types"_>(this->filter)}
+,senders{json::get<"senders"_>(this->filter)}
+,not_senders{json::get<"not_senders"_>(this->filter)}
+,rooms{json::get<"rooms"_>(this->filter)}
+,not_rooms{json::get<"not_rooms"_>(this->filter)}
+,keys
+{
+	json::get<"contains_url"_>(this->filter) == true?
+		event::keys::include{"event_id", "room_id", "sender", "type", "content"}:
+		event::keys::include{"event_id", "room_id", "sender", "type"}
+}
+{
+}
+
+//TODO: tribool for contains_url; we currently ignore the false value.
+bool
+ircd::m::room_event_filter::compiled::match(const event &event)
+const
+{
+	const auto &room_id(json::get<"room_id"_>(event));
+	if(not_rooms.has(room_id) || (!rooms.empty() && !rooms.has(room_id)))
+		return false;
+
+	const auto &type(json::get<"type"_>(event));
+	if(not_types.has(type) || (!types.empty() && !types.has(type)))
+		return false;
+
+	const auto &sender(json::get<"sender"_>(event));
+	if(not_senders.has(sender) || (!senders.empty() && !senders.has(sender)))
+		return false;
+
+	if(json::get<"contains_url"_>(filter) == true)
+		if(!json::get<"content"_>(event).has("url"))
+			return false;
+
+	return true;
+}
+
+ircd::m::room_event_filter::compiled::set::set(const json::array &array)
+{
+	for(const auto &value : array)
+	{
+		const string_view &str
+		{
+			unquote(value)
+		};
+
+		if(ircd::has(str, '*'))
+			globs.emplace_back(str);
+		else
+			exact.emplace(str);
+	}
+}
+
+bool
+ircd::m::room_event_filter::compiled::set::has(const string_view &str)
+const
+{
+	if(exact.count(str))
+		return true;
+
+	return std::any_of(begin(globs), end(globs), [&str]
+	(const string_view &pattern)
+	{
+		return glob(pattern, str);
+	});
+}
+
+bool
+ircd::m::room_event_filter::compiled::set::empty()
+const
+{
+	return exact.empty() && globs.empty();
+}
+
+/// Filter wildcards: '*' matches any run of characters, including none.
+bool
+ircd::m::glob(const string_view &pattern,
+              const string_view &str)
+{
+	size_t p(0), s(0), star(-1), mark(0);
+	while(s < size(str))
+	{
+		if(p < size(pattern) && pattern[p] == '*')
+		{
+			star = p++;
+			mark = s;
+		}
+		else if(p < size(pattern) && pattern[p] == str[s])
+		{
+			++p;
+			++s;
+		}
+		else if(star != size_t(-1))
+		{
+			p = star + 1;
+			s = ++mark;
+		}
+		else return false;
+	}
+
+	while(p < size(pattern) && pattern[p] == '*')
+		++p;
+
+	return p == size(pattern);
+}
+
 //
 // event_filter
 //
@@ -1803,7 +2011,7 @@ const
 	char b58[size(hash) * 2];
 	return
 	{
-		buf, b58encode(b58, hash), my_host()
+		buf, b58encode_compat(b58, hash), my_host()
 	};
 }
 
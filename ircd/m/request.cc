@@ -148,7 +148,7 @@ const
 
 	const ed25519::sig sig
 	{
-		self::secret_key.sign(object)
+		sk.sign(object)
 	};
 
 	const auto &origin
@@ -18,9 +18,10 @@ int64_t
 ircd::m::depth(std::nothrow_t,
                const id::room &room_id)
 {
+	char room_key[dbs::ROOM_KEY_SIZE];
 	const auto it
 	{
-		dbs::room_events.begin(room_id)
+		dbs::room_events.begin(dbs::room_key(room_key, room_id))
 	};
 
 	if(!it)
@@ -44,9 +45,10 @@ ircd::m::event::idx
 ircd::m::head_idx(std::nothrow_t,
                   const id::room &room_id)
 {
+	char room_key[dbs::ROOM_KEY_SIZE];
 	const auto it
 	{
-		dbs::room_events.begin(room_id)
+		dbs::room_events.begin(dbs::room_key(room_key, room_id))
 	};
 
 	if(!it)
@@ -94,9 +96,10 @@ std::tuple<ircd::m::event::id::buf, int64_t, ircd::m::event::idx>
 ircd::m::top(std::nothrow_t,
              const id::room &room_id)
 {
+	char room_key[dbs::ROOM_KEY_SIZE];
 	const auto it
 	{
-		dbs::room_events.begin(room_id)
+		dbs::room_events.begin(dbs::room_key(room_key, room_id))
 	};
 
 	if(!it)
@@ -239,9 +242,10 @@ ircd::m::federate(const id::room &room_id)
 bool
 ircd::m::exists(const id::room &room_id)
 {
+	char room_key[dbs::ROOM_KEY_SIZE];
 	const auto it
 	{
-		dbs::room_events.begin(room_id)
+		dbs::room_events.begin(dbs::room_key(room_key, room_id))
 	};
 
 	return bool(it);
@@ -711,7 +715,8 @@ ircd::m::room::messages::operator*()
 bool
 ircd::m::room::messages::seek()
 {
-	this->it = dbs::room_events.begin(room.room_id);
+	char room_key[dbs::ROOM_KEY_SIZE];
+	this->it = dbs::room_events.begin(dbs::room_key(room_key, room.room_id));
 	return bool(*this);
 }
 
@@ -1214,7 +1219,8 @@ const
 		opts.readahead = size_t(readahead_size);
 
 	auto &column{dbs::room_state};
-	for(auto it{column.begin(room_id, opts)}; bool(it); ++it)
+	char room_key[dbs::ROOM_KEY_SIZE];
+	for(auto it{column.begin(dbs::room_key(room_key, room_id), opts)}; bool(it); ++it)
 		if(!closure(byte_view<event::idx>(it->second)))
 			return false;
 
@@ -1775,9 +1781,10 @@ const
 		return origins._for_each_([&closure, this]
 		(const string_view &key)
 		{
+			char buf[id::MAX_SIZE];
 			const string_view &member
 			{
-				std::get<1>(dbs::room_joined_key(key))
+				dbs::id_string(buf, std::get<1>(dbs::room_joined_key(key)))
 			};
 
 			bool ret{true};
@@ -1883,6 +1890,14 @@ const
 		dbs::room_joined
 	};
 
+	const uint64_t origin_idx
+	{
+		dbs::id_index(origin)
+	};
+
+	if(!origin_idx)
+		return false;
+
 	char querybuf[dbs::ROOM_JOINED_KEY_MAX_SIZE];
 	const auto query
 	{
@@ -1897,17 +1912,12 @@ const
 	if(!it)
 		return false;
 
-	const string_view &key
+	const uint64_t &key_origin
 	{
-		lstrip(it->first, "\0"_sv)
+		std::get<0>(dbs::room_joined_key(it->first))
 	};
 
-	const string_view &key_origin
-	{
-		std::get<0>(dbs::room_joined_key(key))
-	};
-
-	return key_origin == origin;
+	return key_origin == origin_idx;
 }
 
 void
@@ -1926,24 +1936,22 @@ bool
 ircd::m::room::origins::for_each(const closure_bool &view)
 const
 {
-	string_view last;
-	char lastbuf[rfc1035::NAME_BUF_SIZE];
-	return _for_each_([&last, &lastbuf, &view]
+	// Members are grouped by origin so each origin is translated once.
+	uint64_t last{0};
+	char buf[rfc1035::NAME_BUF_SIZE];
+	return _for_each_([&last, &buf, &view]
 	(const string_view &key)
 	{
-		const string_view &origin
+		const uint64_t &origin_idx
 		{
 			std::get<0>(dbs::room_joined_key(key))
 		};
 
-		if(origin == last)
+		if(origin_idx == last)
 			return true;
 
-		if(!view(origin))
-			return false;
-
-		last = { lastbuf, copy(lastbuf, origin) };
-		return true;
+		last = origin_idx;
+		return view(dbs::id_string(buf, origin_idx));
 	});
 }
 
@@ -1956,21 +1964,15 @@ const
 		dbs::room_joined
 	};
 
+	char room_key[dbs::ROOM_KEY_SIZE];
 	auto it
 	{
-		index.begin(room.room_id)
+		index.begin(dbs::room_key(room_key, room.room_id))
 	};
 
 	for(; bool(it); ++it)
-	{
-		const string_view &key
-		{
-			lstrip(it->first, "\0"_sv)
-		};
-
-		if(!view(key))
+		if(!view(it->first))
 			return false;
-	}
 
 	return true;
 }
@@ -2029,9 +2031,10 @@ const
 		dbs::room_head
 	};
 
+	char room_key[dbs::ROOM_KEY_SIZE];
 	auto it
 	{
-		index.begin(room.room_id)
+		index.begin(dbs::room_key(room_key, room.room_id))
 	};
 
 	for(; it; ++it)
@@ -799,6 +799,12 @@ ircd::m::state::get_node(const std::nothrow_t,
 	return column(node_id, std::nothrow, closure);
 }
 
+decltype(ircd::m::state::node_written)
+ircd::m::state::node_written;
+
+decltype(ircd::m::state::node_dead)
+ircd::m::state::node_dead;
+
 /// Writes a node to the db::txn and returns the id of this node (a hash) into
 /// the buffer.
 ircd::m::state::id
@@ -826,6 +832,9 @@ ircd::m::state::set_node(db::txn &iov,
 		}
 	};
 
+	if(node_written)
+		node_written(hashb64);
+
 	return hashb64;
 }
 
@@ -17,6 +17,18 @@ namespace ircd::net
 	void wait_close_sockets();
 }
 
+namespace ircd::net::session
+{
+	struct entry;
+
+	static void free_key(void *, void *, CRYPTO_EX_DATA *, int, long, void *);
+	static int handle_new(SSL *, SSL_SESSION *) noexcept;
+	static void init();
+
+	extern std::map<std::string, entry, std::less<>> cache;
+	extern int ex_index;
+}
+
 void
 ircd::net::wait_close_sockets()
 {
@@ -38,13 +50,16 @@ ircd::net::init::init()
 {
 	sslv23_client.set_verify_mode(asio::ssl::verify_peer);
 	sslv23_client.set_default_verify_paths();
+	session::init();
 }
 
 /// Network subsystem shutdown
 ircd::net::init::~init()
 noexcept
 {
+	listener::acceptor::handshake_pool.join();
 	wait_close_sockets();
+	session::clear();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -599,6 +614,13 @@ ircd::net::open_opts::default_allow_expired
 	{ "default",  false                          },
 };
 
+decltype(ircd::net::open_opts::default_session_resume)
+ircd::net::open_opts::default_session_resume
+{
+	{ "name",     "ircd.net.open.session_resume"  },
+	{ "default",  true                            },
+};
+
 /// Open new socket with future-based report.
 ///
 ircd::ctx::future<std::shared_ptr<ircd::net::socket>>
@@ -924,6 +946,9 @@ ircd::net::listen
 // listener
 //
 
+decltype(ircd::net::listener::handshake_stats)
+ircd::net::listener::handshake_stats;
+
 std::ostream &
 ircd::net::operator<<(std::ostream &s, const listener &a)
 {
@@ -1076,6 +1101,62 @@ ircd::net::listener::acceptor::timeout
 	{ "default",  12000L                      },
 };
 
+decltype(ircd::net::listener::acceptor::session_cache_size)
+ircd::net::listener::acceptor::session_cache_size
+{
+	{ "name",     "ircd.net.acceptor.session.cache_size" },
+	{ "default",  16384L                                  },
+};
+
+decltype(ircd::net::listener::acceptor::session_timeout)
+ircd::net::listener::acceptor::session_timeout
+{
+	{ "name",     "ircd.net.acceptor.session.timeout" },
+	{ "default",  7200L                               },
+};
+
+decltype(ircd::net::listener::acceptor::session_tickets)
+ircd::net::listener::acceptor::session_tickets
+{
+	{ "name",     "ircd.net.acceptor.session.tickets" },
+	{ "default",  true                                },
+};
+
+decltype(ircd::net::listener::acceptor::handshake_offload)
+ircd::net::listener::acceptor::handshake_offload
+{
+	{ "name",     "ircd.net.acceptor.handshake.offload" },
+	{ "default",  true                                  },
+};
+
+decltype(ircd::net::listener::acceptor::handshake_pool_size)
+ircd::net::listener::acceptor::handshake_pool_size
+{
+	{ "name",     "ircd.net.acceptor.handshake.pool_size" },
+	{ "default",  64L                                     },
+};
+
+/// Kernel TLS for egress on accepted sockets. This only takes effect with
+/// handshake offload because the handshake must run on the socket's fd for
+/// OpenSSL to install the keys; when the kernel (tls module), the OpenSSL
+/// build or the negotiated cipher can't support it the socket falls back to
+/// userspace encryption as usual. This requires OpenSSL 3.0 (with
+/// SSL_OP_ENABLE_KTLS); against older builds the item has no effect.
+decltype(ircd::net::listener::acceptor::handshake_ktls)
+ircd::net::listener::acceptor::handshake_ktls
+{
+	{ "name",     "ircd.net.acceptor.handshake.ktls" },
+	{ "default",  false                              },
+};
+
+/// Contexts driving offloaded handshakes; these only wait on the socket and
+/// on the offload thread so their stacks are small.
+decltype(ircd::net::listener::acceptor::handshake_pool)
+ircd::net::listener::acceptor::handshake_pool
+{
+	"tlshs", 64_KiB
+};
+
 std::ostream &
 ircd::net::operator<<(std::ostream &s, const struct listener::acceptor &a)
 {
@@ -1302,12 +1383,22 @@ noexcept try
 		socket::handshake_type::server
 	};
 
+	++handshaking;
+	if(handshake_offload)
+	{
+		if(handshake_pool.size() < size_t(handshake_pool_size))
+			handshake_pool.add(size_t(handshake_pool_size) - handshake_pool.size());
+
+		++handshake_stats.queued;
+		handshake_pool(std::bind(&acceptor::handshake_offloaded, this, sock, a, now<steady_point>()));
+		return;
+	}
+
 	auto handshake
 	{
 		std::bind(&acceptor::handshake, this, ph::_1, sock, a)
 	};
 
-	++handshaking;
 	sock->set_timeout(milliseconds(timeout));
 	sock->ssl.async_handshake(handshake_type, std::move(handshake));
 }
@@ -1375,6 +1466,184 @@ ircd::net::listener::acceptor::check_accept_error(const error_code &ec,
 	throw_system_error(ec);
 }
 
+/// Runs the server handshake on a handshake_pool context. The OpenSSL state
+/// machine is stepped on the ctx::ole threads, so the key exchange and
+/// signature work happens off the main thread; the context waits on the
+/// socket between steps. During the handshake the SSL reads and writes the
+/// socket directly; asio's BIO pair is restored afterward, and nothing has
+/// passed through it yet.
+///
+/// With handshake_ktls OpenSSL installs the traffic keys into the kernel
+/// when each side changes cipher state; for TLS 1.2 on recent kernels that
+/// includes the read side. Each side the kernel took keeps the socket BIO and
+/// only the other returns to asio; the socket's write or read suite then
+/// passes cleartext through the kernel (see socket::ktls and ktls_rx).
+void
+ircd::net::listener::acceptor::handshake_offloaded(const std::shared_ptr<socket> sock,
+                                                   const std::weak_ptr<acceptor> a,
+                                                   const steady_point queued)
+{
+	auto &stats(handshake_stats);
+	--stats.queued;
+
+	const auto acceptor(a.lock());
+	if(unlikely(!acceptor))
+		return;
+
+	const auto started(now<steady_point>());
+	const auto queue_time(duration_cast<microseconds>(started - queued));
+	stats.queue_total += queue_time;
+	stats.queue_max = std::max(stats.queue_max, queue_time);
+	stats.active_max = std::max(stats.active_max, ++stats.active);
+	++stats.total;
+	const unwind dec{[&stats]
+	{
+		--stats.active;
+	}};
+
+	SSL *const ssl(sock->ssl.native_handle());
+	BIO *const bio(SSL_get_rbio(ssl));
+	assert(bio == SSL_get_wbio(ssl));
+	#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+	BIO_up_ref(bio);
+	#else
+	CRYPTO_add(&bio->references, 1, CRYPTO_LOCK_BIO);
+	#endif
+
+	SSL_set_fd(ssl, sock->sd.native_handle());
+	SSL_set_accept_state(ssl);
+
+	#ifdef SSL_OP_ENABLE_KTLS
+	if(handshake_ktls)
+		SSL_set_options(ssl, SSL_OP_ENABLE_KTLS);
+	#endif
+
+	// An exception, i.e. ctx::terminated when the pool is joined at shutdown,
+	// leaves this frame for the pool's handler; the socket is dropped on the
+	// way out.
+	const unwind::exceptional drop{[this, &sock]
+	{
+		--handshaking;
+		close(*sock, dc::RST, close_ignore);
+	}};
+
+	error_code ec;
+	{
+		const unwind restore{[&sock, &ec, ssl, bio]
+		{
+			#ifdef SSL_OP_ENABLE_KTLS
+			sock->ktls = !ec && BIO_get_ktls_send(SSL_get_wbio(ssl));
+			sock->ktls_rx = !ec && BIO_get_ktls_recv(SSL_get_rbio(ssl));
+			if(sock->ktls || sock->ktls_rx)
+			{
+				// Each set0 takes the reference held here; with both sides in
+				// the kernel asio's BIO pair is not reinstalled at all.
+				if(!sock->ktls_rx)
+					SSL_set0_rbio(ssl, bio);
+				else if(!sock->ktls)
+					SSL_set0_wbio(ssl, bio);
+				else
+					BIO_free(bio);
+
+				++handshake_stats.ktls;
+				return;
+			}
+			#endif
+
+			SSL_set_bio(ssl, bio, bio);
+		}};
+
+		const auto deadline
+		{
+			queued + milliseconds(timeout)
+		};
+
+		while((ec = handshake_offload_step(*sock, deadline)) == asio::error::would_block);
+	}
+
+	handshake(ec, sock, a);
+}
+
+/// One step of the offloaded handshake; returns would_block for another.
+boost::system::error_code
+ircd::net::listener::acceptor::handshake_offload_step(socket &sock,
+                                                      const steady_point &deadline)
+try
+{
+	using boost::asio::error::get_ssl_category;
+
+	if(unlikely(interrupting))
+		return make_error_code(boost::system::errc::operation_canceled);
+
+	SSL *const ssl(sock.ssl.native_handle());
+	int ret(0), err(0), syserr(0);
+	ulong code(0);
+	const auto started(now<steady_point>());
+	ctx::offload([ssl, &ret, &err, &code, &syserr]
+	{
+		ERR_clear_error();
+		errno = 0;
+		ret = SSL_do_handshake(ssl);
+		syserr = errno;
+		err = ret == 1? SSL_ERROR_NONE : SSL_get_error(ssl, ret);
+		code = err == SSL_ERROR_SSL? ERR_get_error() : 0;
+	});
+
+	++handshake_stats.steps;
+	handshake_stats.cpu_total += duration_cast<microseconds>(now<steady_point>() - started);
+
+	const auto remaining
+	{
+		duration_cast<milliseconds>(deadline - now<steady_point>())
+	};
+
+	switch(err)
+	{
+		case SSL_ERROR_NONE:
+			return {};
+
+		case SSL_ERROR_WANT_READ:
+		case SSL_ERROR_WANT_WRITE:
+			if(remaining <= milliseconds(0))
+			{
+				sock.timedout = true;
+				return make_error_code(boost::system::errc::operation_canceled);
+			}
+
+			sock.wait(wait_opts
+			{
+				err == SSL_ERROR_WANT_READ? ready::READ : ready::WRITE, remaining
+			});
+
+			return asio::error::would_block;
+
+		case SSL_ERROR_SSL:
+			return error_code{int(code), get_ssl_category()};
+
+		case SSL_ERROR_SYSCALL:
+			return syserr?
+				error_code{syserr, boost::system::system_category()}:
+				error_code{asio::error::eof};
+
+		default:
+			return error_code{err, get_ssl_category()};
+	}
+}
+catch(const ctx::interrupted &)
+{
+	return make_error_code(boost::system::errc::operation_canceled);
+}
+catch(const std::system_error &e)
+{
+	if(e.code() == std::errc::timed_out)
+	{
+		sock.timedout = true;
+		return make_error_code(boost::system::errc::operation_canceled);
+	}
+
+	return error_code{e.code().value(), boost::system::system_category()};
+}
+
 void
 ircd::net::listener::acceptor::handshake(const error_code &ec,
                                          const std::shared_ptr<socket> sock,
@@ -1630,6 +1899,61 @@ ircd::net::listener::acceptor::configure(const json::object &opts)
 			string(logheadbuf, *this)
 		};
 	}
+
+	configure_sessions(opts);
+}
+
+/// Allows remote servers to resume their TLS sessions with this listener,
+/// either statelessly with tickets (keys are generated by OpenSSL for the
+/// lifetime of this context) or by session ID with the server-side cache.
+void
+ircd::net::listener::acceptor::configure_sessions(const json::object &opts)
+{
+	auto *const ctx
+	{
+		ssl.native_handle()
+	};
+
+	const string_view sid_ctx
+	{
+		name.data(), std::min(name.size(), size_t(SSL_MAX_SID_CTX_LENGTH))
+	};
+
+	SSL_CTX_set_session_id_context(ctx, reinterpret_cast<const uint8_t *>(sid_ctx.data()), sid_ctx.size());
+
+	const size_t cache_size
+	{
+		opts.get<size_t>("session_cache_size", size_t(session_cache_size))
+	};
+
+	SSL_CTX_set_session_cache_mode(ctx, cache_size? SSL_SESS_CACHE_SERVER : SSL_SESS_CACHE_OFF);
+	SSL_CTX_sess_set_cache_size(ctx, cache_size);
+
+	const seconds timeout
+	{
+		opts.get<long>("session_timeout", seconds(session_timeout).count())
+	};
+
+	SSL_CTX_set_timeout(ctx, timeout.count());
+
+	const bool tickets
+	{
+		opts.get<bool>("session_tickets", bool(session_tickets))
+	};
+
+	if(tickets)
+		SSL_CTX_clear_options(ctx, SSL_OP_NO_TICKET);
+	else
+		SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
+
+	log::debug
+	{
+		log, "%s session resumption cache:%zu timeout:%ld$s tickets:%b",
+		string(logheadbuf, *this),
+		cache_size,
+		timeout.count(),
+		tickets
+	};
 }
 
 //
@@ -1897,6 +2221,218 @@ ircd::net::sslv23_client
 	boost::asio::ssl::context::method::sslv23_client
 };
 
+//
+// session
+//
+
+struct ircd::net::session::entry
+{
+	std::unique_ptr<SSL_SESSION, void (*)(SSL_SESSION *)> sess
+	{
+		nullptr, ::SSL_SESSION_free
+	};
+
+	steady_point last;
+};
+
+decltype(ircd::net::session::max)
+ircd::net::session::max
+{
+	{ "name",     "ircd.net.session.max"  },
+	{ "default",  1024L                   },
+};
+
+decltype(ircd::net::session::cache)
+ircd::net::session::cache;
+
+decltype(ircd::net::session::ex_index)
+ircd::net::session::ex_index
+{
+	-1
+};
+
+decltype(ircd::net::session::offered)
+ircd::net::session::offered;
+
+decltype(ircd::net::session::resumed)
+ircd::net::session::resumed;
+
+decltype(ircd::net::session::stored)
+ircd::net::session::stored;
+
+/// Sessions are delivered by OpenSSL through the new-session callback rather
+/// than fetched after the handshake because TLS 1.3 tickets arrive after the
+/// handshake completes. The internal store is disabled since lookups are
+/// made by server name and not by session ID.
+void
+ircd::net::session::init()
+{
+	auto *const ctx
+	{
+		sslv23_client.native_handle()
+	};
+
+	ex_index = SSL_get_ex_new_index(0, nullptr, nullptr, nullptr, free_key);
+	SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+	SSL_CTX_sess_set_new_cb(ctx, handle_new);
+}
+
+void
+ircd::net::session::clear()
+{
+	cache.clear();
+}
+
+size_t
+ircd::net::session::count()
+{
+	return cache.size();
+}
+
+void
+ircd::net::session::erase(const string_view &key)
+{
+	const auto it
+	{
+		cache.find(key)
+	};
+
+	if(it != end(cache))
+		cache.erase(it);
+}
+
+/// Attaches the cache key to the socket's SSL object for handle_new() and
+/// sets any cached session to be offered in the ClientHello. Returns true
+/// if a session was offered.
+bool
+ircd::net::session::offer(socket &socket,
+                          const open_opts &opts)
+{
+	if(!opts.session_resume || ex_index < 0)
+		return false;
+
+	char buf[rfc1035::NAME_BUF_SIZE + 8];
+	const string_view key
+	{
+		session::key(buf, opts)
+	};
+
+	SSL *const ssl
+	{
+		socket.ssl.native_handle()
+	};
+
+	auto *const keystr
+	{
+		new std::string(key)
+	};
+
+	if(unlikely(!SSL_set_ex_data(ssl, ex_index, keystr)))
+	{
+		delete keystr;
+		return false;
+	}
+
+	const auto it
+	{
+		cache.find(key)
+	};
+
+	if(it == end(cache))
+		return false;
+
+	auto &entry(it->second);
+	if(!SSL_set_session(ssl, entry.sess.get()))
+	{
+		cache.erase(it);
+		return false;
+	}
+
+	entry.last = now<steady_point>();
+	++offered;
+	return true;
+}
+
+ircd::string_view
+ircd::net::session::key(const mutable_buffer &buf,
+                        const open_opts &opts)
+{
+	return fmt::sprintf
+	{
+		buf, "%s:%u",
+		common_name(opts),
+		port(opts.hostport)
+	};
+}
+
+int
+ircd::net::session::handle_new(SSL *const ssl,
+                               SSL_SESSION *const sess)
+noexcept try
+{
+	const auto *const key
+	{
+		reinterpret_cast<const std::string *>(SSL_get_ex_data(ssl, ex_index))
+	};
+
+	if(!key || empty(*key) || !size_t(max))
+		return 0;
+
+	auto it
+	{
+		cache.lower_bound(*key)
+	};
+
+	if(it == end(cache) || it->first != *key)
+	{
+		// Evict the least recently used session to make room; this is a
+		// linear scan but only occurs for a new server at capacity.
+		if(cache.size() >= size_t(max))
+		{
+			const auto lru
+			{
+				std::min_element(begin(cache), end(cache), []
+				(const auto &a, const auto &b)
+				{
+					return a.second.last < b.second.last;
+				})
+			};
+
+			cache.erase(lru);
+		}
+
+		it = cache.emplace_hint(it, *key, entry{});
+	}
+
+	auto &entry(it->second);
+	entry.sess.reset(sess);
+	entry.last = now<steady_point>();
+	++stored;
+
+	// Returning 1 takes ownership of the reference.
+	return 1;
+}
+catch(const std::exception &e)
+{
+	log::error
+	{
+		log, "Failed to cache TLS session: %s", e.what()
+	};
+
+	return 0;
+}
+
+void
+ircd::net::session::free_key(void *const parent,
+                             void *const ptr,
+                             CRYPTO_EX_DATA *const ad,
+                             int idx,
+                             long argl,
+                             void *const argp)
+{
+	delete reinterpret_cast<std::string *>(ptr);
+}
+
 decltype(ircd::net::socket::count)
 ircd::net::socket::count
 {};
@@ -2001,6 +2537,7 @@ ircd::net::socket::handshake(const open_opts &opts,
 		std::bind(&socket::handle_verify, this, ph::_1, ph::_2, opts)
 	};
 
+	session::offer(*this, opts);
 	set_timeout(opts.handshake_timeout);
 	ssl.set_verify_callback(std::move(verify_handler));
 	ssl.async_handshake(handshake_type::client, std::move(handshake_handler));
@@ -2053,6 +2590,14 @@ try
 
 		case dc::SSL_NOTIFY:
 		{
+			// The peer's close_notify can't be read back through asio when the
+			// kernel owns ingress; the connection is closed with a FIN instead.
+			if(ktls_rx)
+			{
+				sd.shutdown(ip::tcp::socket::shutdown_both);
+				break;
+			}
+
 			auto disconnect_handler
 			{
 				std::bind(&socket::handle_disconnect, this, shared_from(*this), std::move(callback), ph::_1)
@@ -2223,8 +2768,9 @@ try
 			// those userspace buffers, the socket won't know about it and perform
 			// the wait. ASIO should fix this by adding a ssl::stream.wait() method
 			// which will bail out immediately in this case before passing up to the
-			// real socket wait.
-			if(SSL_peek(ssl.native_handle(), buf, sizeof(buf)) >= ssize_t(sizeof(buf)))
+			// real socket wait. With ktls_rx nothing is buffered in SSL, and a peek
+			// there would consume a record from the socket.
+			if(!ktls_rx && SSL_peek(ssl.native_handle(), buf, sizeof(buf)) >= ssize_t(sizeof(buf)))
 			{
 				ircd::post([handle(std::move(handle))]
 				{
@@ -2545,11 +3091,30 @@ noexcept try
 	if(timedout && ec == errc::operation_canceled)
 		ec = make_error_code(errc::timed_out);
 
+	const auto &key
+	{
+		session::ex_index >= 0?
+			reinterpret_cast<const std::string *>(SSL_get_ex_data(ssl.native_handle(), session::ex_index)):
+			nullptr
+	};
+
+	const bool reused
+	{
+		!ec && SSL_session_reused(ssl.native_handle())
+	};
+
+	// Any session cached for a server we failed to handshake with is not
+	// offered again; a stale ticket should not fail the next attempt too.
+	if(ec && key)
+		session::erase(*key);
+
+	session::resumed += reused;
 	log::debug
 	{
-		log, "%s handshake %s",
+		log, "%s handshake %s%s",
 		loghead(*this),
-		string(ec)
+		string(ec),
+		reused? " (resumed)" : ""
 	};
 
 	// This is the end of the asynchronous call chain; the user is called
@@ -2952,6 +3517,23 @@ ircd::net::dns::resolve(const hostport &hp,
 	function(hp, op, std::move(cb));
 }
 
+/// Convenience callback with a single AAAA record which was selected from
+/// the vector randomly.
+void
+ircd::net::dns::resolve(const hostport &hp,
+                        const opts &op,
+                        callback_AAAA_one cb)
+{
+	using prototype = void (const hostport &, opts, callback_AAAA_one);
+
+	static mods::import<prototype> function
+	{
+		"s_dns", "_resolve__AAAA"
+	};
+
+	function(hp, op, std::move(cb));
+}
+
 /// Fundamental callback with a vector of abstract resource records.
 void
 ircd::net::dns::resolve(const hostport &hp,
@@ -351,6 +351,97 @@ decltype(ircd::server::peers)
 ircd::server::peers
 {};
 
+namespace ircd::server
+{
+	template<class F> static void expose(const stats::writer &, F&&);
+
+	extern stats::collector requests_stat, errors_stat, links_stat, tags_stat;
+	extern stats::collector latency_stat;
+}
+
+decltype(ircd::server::requests_stat)
+ircd::server::requests_stat
+{
+	{
+		{ "name",     "ircd.server.requests"                  },
+		{ "help",     "Requests completed by remote peer"    },
+		{ "type",     "counter"                               },
+	},
+	[](const stats::writer &w)
+	{
+		expose(w, [](const peer &p) { return p.latency.dones; });
+	}
+};
+
+decltype(ircd::server::errors_stat)
+ircd::server::errors_stat
+{
+	{
+		{ "name",     "ircd.server.errors"                    },
+		{ "help",     "Link and peer errors by remote peer"  },
+		{ "type",     "counter"                               },
+	},
+	[](const stats::writer &w)
+	{
+		expose(w, [](const peer &p) { return p.errors; });
+	}
+};
+
+decltype(ircd::server::links_stat)
+ircd::server::links_stat
+{
+	{
+		{ "name",     "ircd.server.links"                     },
+		{ "help",     "Open links by remote peer"            },
+		{ "type",     "gauge"                                 },
+	},
+	[](const stats::writer &w)
+	{
+		expose(w, [](const peer &p) { return p.link_count(); });
+	}
+};
+
+decltype(ircd::server::tags_stat)
+ircd::server::tags_stat
+{
+	{
+		{ "name",     "ircd.server.tags"                      },
+		{ "help",     "Requests in flight by remote peer"    },
+		{ "type",     "gauge"                                 },
+	},
+	[](const stats::writer &w)
+	{
+		expose(w, [](const peer &p) { return p.tag_count(); });
+	}
+};
+
+decltype(ircd::server::latency_stat)
+ircd::server::latency_stat
+{
+	{
+		{ "name",     "ircd.server.latency.seconds"             },
+		{ "help",     "Distribution of response times by peer" },
+		{ "type",     "histogram"                               },
+	},
+	[](const stats::writer &w)
+	{
+		for(const auto &p : peers)
+			w({{ "peer", string_view{p.second->hostcanon} }},
+			  p.second->latency.histogram,
+			  0.001,
+			  p.second->latency.done_total.count() / 1e6);
+	}
+};
+
+template<class F>
+void
+ircd::server::expose(const stats::writer &w,
+                     F&& value)
+{
+	for(const auto &p : peers)
+		w({{ "peer", string_view{p.second->hostcanon} }}, double(value(*p.second)));
+}
+
 decltype(ircd::server::peer::link_min_default)
 ircd::server::peer::link_min_default
 {
@@ -365,6 +456,13 @@ ircd::server::peer::link_max_default
 	{ "default",  2L                          }
 };
 
+decltype(ircd::server::peer::link_eta_max)
+ircd::server::peer::link_eta_max
+{
+	{ "name",     "ircd.server.peer.link_eta_max" },
+	{ "default",  1500L                           }
+};
+
 //
 // peer::peer
 //
@@ -434,6 +532,7 @@ void
 ircd::server::peer::err_set(A&&... args)
 {
 	this->e = std::make_unique<err>(std::forward<A>(args)...);
+	++errors;
 }
 
 ircd::string_view
@@ -572,6 +671,39 @@ ircd::server::peer::link_get(const request &request)
 		if(!best_maxed && cand_maxed)
 			continue;
 
+		// A link whose head-of-line tag has gone unanswered for several times
+		// its usual time-to-head is blocked; anything moving is preferred.
+		const bool best_stalled
+		{
+			best->stalled()
+		};
+
+		const bool cand_stalled
+		{
+			cand.stalled()
+		};
+
+		if(best_stalled && !cand_stalled)
+		{
+			best = &cand;
+			continue;
+		}
+
+		if(!best_stalled && cand_stalled)
+			continue;
+
+		// When response times have been measured the link expected to finish
+		// its queue first is chosen.
+		const auto best_eta(best->eta());
+		const auto cand_eta(cand.eta());
+		if(best_eta != cand_eta)
+		{
+			if(cand_eta < best_eta)
+				best = &cand;
+
+			continue;
+		}
+
 		// Candidates's queue has less or same backlog of unsent requests, but
 		// now measure if candidate will take longer to process at least the
 		// write-side of those requests.
@@ -585,8 +717,8 @@ ircd::server::peer::link_get(const request &request)
 		if(cand.read_remaining() > best->read_remaining())
 			continue;
 
-		// Coarse distribution based on who has more work; this is weak, should
-		// be replaced.
+		// Coarse distribution based on who has more work; this only decides
+		// when there are no response times to go on.
 		if(cand.tag_count() > best->tag_count())
 			continue;
 
@@ -618,7 +750,14 @@ ircd::server::peer::link_get(const request &request)
 		return best;
 	}
 
-	if(best->tag_uncommitted() < best->tag_commit_max())
+	// For a slow peer another link is opened before a queue builds behind
+	// the work already on the best link, rather than after.
+	const bool best_slow
+	{
+		best->tag_count() && (best->stalled() || best->eta() > milliseconds(link_eta_max))
+	};
+
+	if(!best_slow && best->tag_uncommitted() < best->tag_commit_max())
 		return best;
 
 	best = &link_add();
@@ -700,6 +839,7 @@ ircd::server::peer::handle_error(link &link,
                                  std::exception_ptr eptr)
 {
 	assert(bool(eptr));
+	++errors;
 	link.cancel_committed(eptr);
 	log::derror
 	{
@@ -757,6 +897,7 @@ ircd::server::peer::handle_error(link &link,
 		e.what()
 	};
 
+	++errors;
 	link.cancel_committed(std::make_exception_ptr(e));
 	link.close(net::dc::RST);
 }
@@ -795,6 +936,17 @@ noexcept try
 		link.tag_count() - 1
 	};
 
+	if(tag.state.started != steady_point{})
+	{
+		const auto elapsed
+		{
+			duration_cast<microseconds>(now<steady_point>() - tag.state.started)
+		};
+
+		link.latency.done(elapsed);
+		latency.done(elapsed);
+	}
+
 	if(link.tag_committed() >= link.tag_commit_max())
 		link.wait_writable();
 }
@@ -831,10 +983,21 @@ ircd::server::peer::handle_link_done(link &link)
 /// We can use this to learn information from the tag's request and the
 /// response head etc.
 void
-ircd::server::peer::handle_head_recv(const link &link,
+ircd::server::peer::handle_head_recv(link &link,
                                      const tag &tag,
                                      const http::response::head &head)
 {
+	if(tag.state.started != steady_point{})
+	{
+		const auto elapsed
+		{
+			duration_cast<microseconds>(tag.state.head_recv - tag.state.started)
+		};
+
+		link.latency.head(elapsed);
+		latency.head(elapsed);
+	}
+
 	// Learn the software version of the remote peer so we can shape
 	// requests more effectively.
 	if(!server_name && head.server)
@@ -1209,6 +1372,13 @@ ircd::server::link::tag_commit_max_default
 	{ "default",  3L                                }
 };
 
+decltype(ircd::server::link::stall_factor)
+ircd::server::link::stall_factor
+{
+	{ "name",     "ircd.server.link.stall_factor" },
+	{ "default",  4.0                             }
+};
+
 //
 // link::link
 //
@@ -1492,6 +1662,8 @@ bool
 ircd::server::link::process_write(tag &tag)
 {
 	if(!tag.committed())
+	{
+		tag.state.started = now<steady_point>();
 		log::debug
 		{
 			log, "peer(%p) link(%p) starting on tag(%p) %zu of %zu: wt:%zu",
@@ -1502,6 +1674,7 @@ ircd::server::link::process_write(tag &tag)
 			tag_count(),
 			tag.write_size()
 		};
+	}
 
 	while(tag.write_remaining())
 	{
@@ -1831,6 +2004,50 @@ const
 	return queue.size();
 }
 
+/// The queue is estimated to take the average done time for each tag. When
+/// this link has no samples the peer's average is used; zero when neither
+/// has been measured.
+ircd::microseconds
+ircd::server::link::eta()
+const
+{
+	const auto &avg
+	{
+		latency.dones || !peer? latency.done_avg : peer->latency.done_avg
+	};
+
+	return avg * tag_count();
+}
+
+/// The tag at the front of the queue was written but has not received its
+/// response head after stall_factor times the usual time-to-head.
+bool
+ircd::server::link::stalled()
+const
+{
+	if(queue.empty())
+		return false;
+
+	const auto &tag(queue.front());
+	if(!tag.committed() || tag.state.head_read)
+		return false;
+
+	const auto &avg
+	{
+		latency.heads || !peer? latency.head_avg : peer->latency.head_avg
+	};
+
+	if(avg == microseconds(0))
+		return false;
+
+	const auto elapsed
+	{
+		duration_cast<microseconds>(now<steady_point>() - tag.state.started)
+	};
+
+	return elapsed.count() > avg.count() * double(stall_factor);
+}
+
 size_t
 ircd::server::link::read_total()
 const
@@ -1962,6 +2179,56 @@ const
 	});
 }
 
+//
+// latency
+//
+
+decltype(ircd::server::latency::alpha)
+ircd::server::latency::alpha
+{
+	{ "name",     "ircd.server.latency.alpha" },
+	{ "default",  0.125                       }
+};
+
+void
+ircd::server::latency::head(const microseconds &elapsed)
+{
+	const double a(alpha);
+	head_avg = heads++?
+		microseconds(long(a * elapsed.count() + (1.0 - a) * head_avg.count())):
+		elapsed;
+}
+
+void
+ircd::server::latency::done(const microseconds &elapsed)
+{
+	const double a(alpha);
+	done_avg = dones++?
+		microseconds(long(a * elapsed.count() + (1.0 - a) * done_avg.count())):
+		elapsed;
+
+	done_max = std::max(done_max, elapsed);
+	done_total += elapsed;
+	++histogram.at(bucket(elapsed));
+}
+
+/// Bucket 0 counts under 1ms; bucket i counts [2^(i-1), 2^i) ms; the last
+/// bucket counts everything beyond.
+size_t
+ircd::server::latency::bucket(const microseconds &elapsed)
+{
+	const auto ms
+	{
+		duration_cast<milliseconds>(elapsed).count()
+	};
+
+	size_t ret(0);
+	for(auto i(ms); i > 0 && ret < BUCKETS - 1; i >>= 1)
+		++ret;
+
+	return ret;
+}
+
 //
 // tag
 //
@@ -2404,6 +2671,7 @@ ircd::server::tag::read_head(const const_buffer &buffer,
 	// Proffer the HTTP head to the peer instance which owns the link working
 	// this tag so it can learn from any header data.
 	assert(link.peer);
+	state.head_recv = now<steady_point>();
 	link.peer->handle_head_recv(link, *this, head);
 
 	if(contiguous)
@@ -0,0 +1,339 @@
+// Matrix Construct
+//
+// Copyright (C) Matrix Construct Developers, Authors & Contributors
+// Copyright (C) 2016-2018 Jason Volk <jason@zemos.net>
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice is present in all copies. The
+// full license for this software is available in the LICENSE file.
+
+namespace ircd::stats
+{
+	static string_view exposition_name(const mutable_buffer &, const string_view &);
+	static void write_labels(std::ostream &, const json::object &, const string_view &le);
+	static string_view format_value(const mutable_buffer &, const double &);
+}
+
+template<>
+decltype(ircd::util::instance_list<ircd::stats::item>::list)
+ircd::util::instance_list<ircd::stats::item>::list
+{};
+
+/// Writes every registered item in the Prometheus text exposition format
+/// (version 0.0.4). Items of the same name are written together under one
+/// HELP and TYPE header.
+void
+ircd::stats::expose(std::ostream &out)
+{
+	std::vector<const item *> items
+	{
+		begin(item::list), end(item::list)
+	};
+
+	std::stable_sort(begin(items), end(items), []
+	(const item *const &a, const item *const &b)
+	{
+		return a->name < b->name;
+	});
+
+	char namebuf[item::NAME_MAX_LEN + 1];
+	string_view last, name;
+	for(const auto *const &item : items)
+	{
+		if(item->name != last)
+		{
+			last = item->name;
+			name = exposition_name(namebuf, item->name);
+			out << "# HELP " << name << ' ' << item->help << '\n'
+			    << "# TYPE " << name << ' ' << item->type() << '\n';
+		}
+
+		item->write(writer{out, name});
+	}
+
+	out.flush();
+}
+
+ircd::string_view
+ircd::stats::exposition_name(const mutable_buffer &buf,
+                             const string_view &name)
+{
+	const size_t len
+	{
+		std::min(size(name), size(buf))
+	};
+
+	std::transform(begin(name), begin(name) + len, data(buf), []
+	(const char &c)
+	{
+		return c == '.' || c == '-'? '_' : c;
+	});
+
+	return { data(buf), len };
+}
+
+void
+ircd::stats::write_labels(std::ostream &out,
+                          const json::object &labels,
+                          const string_view &le)
+{
+	if(labels.empty() && !le)
+		return;
+
+	char sep('{');
+	for(const auto &member : labels)
+	{
+		out << sep << member.first << "=\"";
+		for(const char &c : unquote(member.second))
+			switch(c)
+			{
+				case '\\':  out << "\\\\";  break;
+				case '"':   out << "\\\"";  break;
+				case '\n':  out << "\\n";   break;
+				default:    out << c;       break;
+			}
+
+		out << '"';
+		sep = ',';
+	}
+
+	if(le)
+		out << sep << "le=\"" << le << '"';
+
+	out << '}';
+}
+
+ircd::string_view
+ircd::stats::format_value(const mutable_buffer &buf,
+                          const double &value)
+{
+	if(std::isinf(value))
+		return value > 0? "+Inf" : "-Inf";
+
+	if(std::trunc(value) == value && std::abs(value) < 9e15)
+		return lex_cast(int64_t(value), buf);
+
+	const auto len
+	{
+		::snprintf(data(buf), size(buf), "%.9g", value)
+	};
+
+	return { data(buf), std::min(size_t(std::max(len, 0)), size(buf) - 1) };
+}
+
+//
+// item
+//
+
+ircd::stats::item::item(const json::members &opts)
+:feature_
+{
+	opts
+}
+,feature
+{
+	feature_
+}
+,name
+{
+	unquote(feature.at("name"))
+}
+,help
+{
+	unquote(feature.get("help"))
+}
+,labels
+{
+	feature.get("labels")
+}
+{
+	if(size(name) > NAME_MAX_LEN)
+		throw error
+		{
+			"Stats item '%s' name length:%zu exceeds max:%zu",
+			name,
+			size(name),
+			NAME_MAX_LEN
+		};
+}
+
+ircd::stats::item::~item()
+noexcept
+{
+}
+
+//
+// counter
+//
+
+ircd::string_view
+ircd::stats::counter::type()
+const
+{
+	return "counter";
+}
+
+void
+ircd::stats::counter::write(const writer &w)
+const
+{
+	w(labels, value);
+}
+
+//
+// gauge
+//
+
+ircd::stats::gauge::gauge(const json::members &opts,
+                          closure fetch)
+:item{opts}
+,fetch{std::move(fetch)}
+{
+}
+
+ircd::string_view
+ircd::stats::gauge::type()
+const
+{
+	return "gauge";
+}
+
+void
+ircd::stats::gauge::write(const writer &w)
+const
+{
+	w(labels, fetch? fetch() : value);
+}
+
+//
+// histogram
+//
+
+ircd::stats::histogram::histogram(const json::members &opts)
+:item{opts}
+,scale
+{
+	feature.get<double>("scale", 1.0)
+}
+{
+}
+
+ircd::string_view
+ircd::stats::histogram::type()
+const
+{
+	return "histogram";
+}
+
+void
+ircd::stats::histogram::write(const writer &w)
+const
+{
+	w(labels, bucket, scale, sum * scale);
+}
+
+//
+// collector
+//
+
+ircd::stats::collector::collector(const json::members &opts,
+                                  closure fetch)
+:item{opts}
+,fetch{std::move(fetch)}
+{
+}
+
+ircd::string_view
+ircd::stats::collector::type()
+const
+{
+	return unquote(feature.get("type", "untyped"));
+}
+
+void
+ircd::stats::collector::write(const writer &w)
+const
+{
+	fetch(w);
+}
+
+//
+// writer
+//
+
+void
+ircd::stats::writer::operator()(const json::members &labels,
+                                const double &value,
+                                const string_view &suffix)
+const
+{
+	const json::strung labels_
+	{
+		labels
+	};
+
+	operator()(json::object{labels_}, value, suffix);
+}
+
+void
+ircd::stats::writer::operator()(const json::object &labels,
+                                const double &value,
+                                const string_view &suffix)
+const
+{
+	char buf[64];
+	out << name << suffix;
+	write_labels(out, labels, {});
+	out << ' ' << format_value(buf, value) << '\n';
+}
+
+void
+ircd::stats::writer::operator()(const json::members &labels,
+                                const vector_view<const size_t> &buckets,
+                                const double &bound,
+                                const double &sum)
+const
+{
+	const json::strung labels_
+	{
+		labels
+	};
+
+	operator()(json::object{labels_}, buckets, bound, sum);
+}
+
+/// Writes a histogram of power-of-two buckets; bucket i has the upper bound
+/// bound * 2^i, and the last bucket is unbounded.
+void
+ircd::stats::writer::operator()(const json::object &labels,
+                                const vector_view<const size_t> &buckets,
+                                const double &bound,
+                                const double &sum)
+const
+{
+	char buf[64];
+	size_t count(0);
+	for(size_t i(0); i < buckets.size(); ++i)
+	{
+		count += buckets[i];
+		const double le
+		{
+			i + 1 < buckets.size()?
+				bound * double(1UL << i):
+				std::numeric_limits<double>::infinity()
+		};
+
+		out << name << "_bucket";
+		write_labels(out, labels, format_value(buf, le));
+		out << ' ' << count << '\n';
+	}
+
+	out << name << "_sum";
+	write_labels(out, labels, {});
+	out << ' ' << format_value(buf, sum) << '\n';
+
+	out << name << "_count";
+	write_labels(out, labels, {});
+	out << ' ' << count << '\n';
+}
@@ -73,11 +73,29 @@ get__messages(client &client,
 		url::decode(filter_buf, filter_query)
 	};
 
-	const m::room_event_filter filter
+	// When there's a filter the iteration fetches only the keys needed to
+	// decide the filter (and the page); the rest of an event is fetched
+	// only once it has matched.
+	const auto filter
+	{
+		!empty(filter_json)?
+			m::room_event_filter::compiled::get
+			(
+				filter_json.has("filter_json")?
+					json::object{filter_json.get("filter_json")}:
+					filter_json
+			):
+			nullptr
+	};
+
+	const m::event::fetch::opts filter_fetch_opts
+	{
+		filter? filter->keys : m::event::keys::selection{}
+	};
+
+	m::event::fetch matched
 	{
-		filter_json.has("filter_json")?
-			json::object{filter_json.get("filter_json")}:
-			filter_json
+		&default_fetch_opts
 	};
 
 	const m::room room
@@ -93,7 +111,7 @@ get__messages(client &client,
 
 	m::room::messages it
 	{
-		room, page.from, &default_fetch_opts
+		room, page.from, filter? &filter_fetch_opts : &default_fetch_opts
 	};
 
 	resource::response::chunked response
@@ -136,11 +154,16 @@ get__messages(client &client,
 				break;
 			}
 
-			if(empty(filter_json) || match(filter, event))
+			if(!filter)
 			{
 				messages.append(event);
 				++hit;
 			}
+			else if(filter->match(event) && seek(matched, it.event_idx(), std::nothrow))
+			{
+				messages.append(matched);
+				++hit;
+			}
 			else ++miss;
 
 			if(hit >= page.limit || miss >= size_t(max_filter_miss))
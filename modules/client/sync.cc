@@ -631,6 +631,19 @@ ircd::m::sync::linear::handle(client &client,
 	return true;
 }
 
+//
+// shortpoll
+//
+
+ircd::m::sync::shortpoll::~shortpoll()
+noexcept
+{
+	// The top object has closed and flushed by now so the snapshot holds
+	// the complete response body.
+	if(snapshot && snapshot_complete && committed)
+		polylog::cache::put(*this);
+}
+
 //
 // polylog
 //
@@ -649,6 +662,56 @@ ircd::m::sync::polylog::prefetch_timeline
 	{ "default",  true                                          },
 };
 
+ircd::conf::item<size_t>
+ircd::m::sync::polylog::rooms_parallel
+{
+	{ "name",     "ircd.client.sync.polylog.rooms.parallel"  },
+	{ "default",  8L                                         },
+};
+
+ircd::conf::item<size_t>
+ircd::m::sync::polylog::rooms_stack_size
+{
+	{ "name",     "ircd.client.sync.polylog.rooms.stack_size"  },
+	{ "default",  ssize_t(512_KiB)                             },
+};
+
+decltype(ircd::m::sync::polylog::rooms_stat)
+ircd::m::sync::polylog::rooms_stat
+{
+	{ "name",     "ircd.client.sync.polylog.seconds"               },
+	{ "help",     "Distribution of polylog sync time by section"  },
+	{ "scale",    1e-6                                             },
+	{ "labels",   json::members {{ "section", "rooms" }}           },
+};
+
+decltype(ircd::m::sync::polylog::presence_stat)
+ircd::m::sync::polylog::presence_stat
+{
+	{ "name",     "ircd.client.sync.polylog.seconds"               },
+	{ "help",     "Distribution of polylog sync time by section"  },
+	{ "scale",    1e-6                                             },
+	{ "labels",   json::members {{ "section", "presence" }}        },
+};
+
+decltype(ircd::m::sync::polylog::account_data_stat)
+ircd::m::sync::polylog::account_data_stat
+{
+	{ "name",     "ircd.client.sync.polylog.seconds"               },
+	{ "help",     "Distribution of polylog sync time by section"  },
+	{ "scale",    1e-6                                             },
+	{ "labels",   json::members {{ "section", "account_data" }}    },
+};
+
+decltype(ircd::m::sync::polylog::snapshot_stat)
+ircd::m::sync::polylog::snapshot_stat
+{
+	{ "name",     "ircd.client.sync.polylog.seconds"               },
+	{ "help",     "Distribution of polylog sync time by section"  },
+	{ "scale",    1e-6                                             },
+	{ "labels",   json::members {{ "section", "snapshot" }}        },
+};
+
 bool
 ircd::m::sync::polylog::handle(client &client,
                                shortpoll &sp,
@@ -660,12 +723,34 @@ try
 	sync::stats stats{sp.stats};
 	stats.timer = timer{};
 
+	if(cache::get(sp))
+	{
+		snapshot_stat(stats.timer.at<microseconds>());
+		log::info
+		{
+			log, "polylog %s %s snapshot %s wc:%zu in %lu$ms",
+			string(rembuf, ircd::remote(sp.client)),
+			string_view{sp.request.user_id},
+			pretty(iecbuf, iec(sp.stats.flush_bytes)),
+			sp.stats.flush_count,
+			sp.stats.timer.at<milliseconds>().count()
+		};
+
+		return true;
+	}
+
+	// A full sync is captured for the cache as it's flushed to the client.
+	if(bool(cache::enable) && sp.since == 0 && !sp.args.full_state)
+		sp.snapshot = std::make_unique<std::string>();
+
 	{
 		json::stack::member member{object, "rooms"};
 		json::stack::object object{member};
 		rooms(sp, object);
 	}
 
+	rooms_stat(stats.timer.at<microseconds>());
+
 	#ifdef RB_DEBUG
 	log::debug
 	{
@@ -676,9 +761,10 @@ try
 		sp.stats.flush_count - stats.flush_count,
 		stats.timer.at<milliseconds>().count()
 	};
+	#endif
+
 	stats = sync::stats{sp.stats};
 	stats.timer = timer{};
-	#endif
 
 	{
 		json::stack::member member{object, "presence"};
@@ -686,6 +772,8 @@ try
 		presence(sp, object);
 	}
 
+	presence_stat(stats.timer.at<microseconds>());
+
 	#ifdef RB_DEBUG
 	log::debug
 	{
@@ -696,9 +784,10 @@ try
 		sp.stats.flush_count - stats.flush_count,
 		stats.timer.at<milliseconds>().count()
 	};
+	#endif
+
 	stats = sync::stats{sp.stats};
 	stats.timer = timer{};
-	#endif
 
 	{
 		json::stack::member member{object, "account_data"};
@@ -706,6 +795,8 @@ try
 		account_data(sp, object);
 	}
 
+	account_data_stat(stats.timer.at<microseconds>());
+
 	#ifdef RB_DEBUG
 	log::debug
 	{
@@ -725,6 +816,7 @@ try
 		};
 	}
 
+	sp.snapshot_complete = true;
 	log::info
 	{
 		log, "polylog %s %s %s wc:%zu in %lu$ms",
@@ -751,6 +843,181 @@ catch(const std::exception &e)
 	throw;
 }
 
+//
+// polylog::cache
+//
+
+decltype(ircd::m::sync::polylog::cache::enable)
+ircd::m::sync::polylog::cache::enable
+{
+	{ "name",     "ircd.client.sync.polylog.cache.enable"  },
+	{ "default",  true                                     },
+};
+
+decltype(ircd::m::sync::polylog::cache::size_max)
+ircd::m::sync::polylog::cache::size_max
+{
+	{ "name",     "ircd.client.sync.polylog.cache.size_max"  },
+	{ "default",  ssize_t(64_MiB)                            },
+};
+
+decltype(ircd::m::sync::polylog::cache::entry_max)
+ircd::m::sync::polylog::cache::entry_max
+{
+	{ "name",     "ircd.client.sync.polylog.cache.entry_max"  },
+	{ "default",  ssize_t(8_MiB)                              },
+};
+
+decltype(ircd::m::sync::polylog::cache::snapshots)
+ircd::m::sync::polylog::cache::snapshots;
+
+decltype(ircd::m::sync::polylog::cache::bytes)
+ircd::m::sync::polylog::cache::bytes
+{
+	0
+};
+
+decltype(ircd::m::sync::polylog::cache::member_hook)
+ircd::m::sync::polylog::cache::member_hook
+{
+	handle_member,
+	{
+		{ "_site",  "vm.notify"      },
+		{ "type",   "m.room.member"  },
+	}
+};
+
+/// A membership change alters which rooms the user's full sync contains.
+void
+ircd::m::sync::polylog::cache::handle_member(const m::event &event,
+                                             m::vm::eval &eval)
+{
+	if(snapshots.empty())
+		return;
+
+	const m::user::id &user_id
+	{
+		at<"state_key"_>(event)
+	};
+
+	if(my(user_id))
+		invalidate(user_id);
+}
+
+/// Answers a full sync from a snapshot. A snapshot further behind than
+/// linear::delta_max is dropped instead, so the client's next sync from the
+/// snapshot's next_batch always remains a cheap linear delta.
+bool
+ircd::m::sync::polylog::cache::get(shortpoll &sp)
+{
+	if(!bool(enable) || sp.since != 0 || sp.args.full_state)
+		return false;
+
+	const auto it
+	{
+		snapshots.find(key(sp.user.user_id, sp.args.filter_id))
+	};
+
+	if(it == end(snapshots))
+		return false;
+
+	auto &snapshot(it->second);
+	if(sp.current - snapshot.sequence > size_t(linear::delta_max))
+	{
+		bytes -= size(snapshot.body);
+		snapshots.erase(it);
+		return false;
+	}
+
+	// The body includes the braces of the top object which the request's
+	// stack already has open; only the members are written here.
+	assert(size(snapshot.body) >= 2);
+	const string_view members
+	{
+		snapshot.body.data() + 1, snapshot.body.size() - 2
+	};
+
+	snapshot.last_used = now<steady_point>();
+	sp.committed = true;
+	for(size_t i(0); i < size(members); i += 32_KiB)
+		sp.out.append(members.substr(i, 32_KiB));
+
+	return true;
+}
+
+void
+ircd::m::sync::polylog::cache::put(shortpoll &sp)
+noexcept try
+{
+	auto &body(*sp.snapshot);
+	if(size(body) > size_t(entry_max) || size(body) < 2)
+		return;
+
+	auto &snapshot
+	{
+		snapshots[key(sp.user.user_id, sp.args.filter_id)]
+	};
+
+	bytes -= size(snapshot.body);
+	bytes += size(body);
+	snapshot.sequence = sp.current;
+	snapshot.body = std::move(body);
+	snapshot.last_used = now<steady_point>();
+
+	// Evict the least recently used snapshots until under the limit.
+	while(bytes > size_t(size_max) && !snapshots.empty())
+	{
+		const auto lru
+		{
+			std::min_element(begin(snapshots), end(snapshots), []
+			(const auto &a, const auto &b)
+			{
+				return a.second.last_used < b.second.last_used;
+			})
+		};
+
+		bytes -= size(lru->second.body);
+		snapshots.erase(lru);
+	}
+}
+catch(const std::exception &e)
+{
+	log::derror
+	{
+		log, "polylog snapshot for %s :%s",
+		string_view{sp.user.user_id},
+		e.what()
+	};
+}
+
+void
+ircd::m::sync::polylog::cache::invalidate(const m::user::id &user_id)
+{
+	const auto prefix
+	{
+		key(user_id, string_view{})
+	};
+
+	auto it(snapshots.lower_bound(prefix));
+	while(it != end(snapshots) && startswith(it->first, prefix))
+	{
+		bytes -= size(it->second.body);
+		it = snapshots.erase(it);
+	}
+}
+
+std::string
+ircd::m::sync::polylog::cache::key(const m::user::id &user_id,
+                                   const string_view &filter_id)
+{
+	std::string ret;
+	ret.reserve(size(user_id) + 1 + size(filter_id));
+	ret.append(data(user_id), size(user_id));
+	ret.push_back(' ');
+	ret.append(data(filter_id), size(filter_id));
+	return ret;
+}
+
 void
 ircd::m::sync::polylog::presence(shortpoll &sp,
                                  json::stack::object &out)
@@ -874,40 +1141,126 @@ ircd::m::sync::polylog::sync_rooms(shortpoll &sp,
 {
 	json::stack::member rooms_member{out, membership};
 	json::stack::object rooms_object{rooms_member};
-	sp.rooms.for_each(membership, [&sp, &rooms_object]
+
+	// Up to rooms_parallel rooms are in flight on helper contexts; the
+	// oldest is always emitted first so the output order is unchanged. The
+	// window is destroyed before rooms_object on error, which interrupts
+	// and joins any helper still running.
+	const size_t parallel
+	{
+		std::max(size_t(rooms_parallel), 1UL)
+	};
+
+	std::deque<fragment> window;
+	sp.rooms.for_each(membership, [&sp, &rooms_object, &window, &parallel]
 	(const m::room &room, const string_view &membership)
 	{
-		if(head_idx(std::nothrow, room) <= sp.since)
-			return;
+		if(window.size() >= parallel)
+		{
+			window.front().emit(rooms_object);
+			window.pop_front();
+		}
+
+		window.emplace_back(sp, room, membership, parallel > 1);
+	});
+
+	for(; !window.empty(); window.pop_front())
+		window.front().emit(rooms_object);
+}
 
-		// Generate individual stats for this room's sync
-		#ifdef RB_DEBUG
-		sync::stats stats{sp.stats};
-		stats.timer = timer{};
-		#endif
+//
+// fragment
+//
 
-		// This scope ensures the object destructs and flushes before
-		// the log message tallying the stats for this room below.
+ircd::m::sync::polylog::fragment::fragment(shortpoll &sp,
+                                           const m::room &room,
+                                           const string_view &membership,
+                                           const bool &spawn)
+:sp{sp}
+,room_id{room.room_id}
+,membership{membership}
+{
+	if(!spawn)
+	{
+		(*this)();
+		return;
+	}
+
+	context = ctx::context
+	{
+		"sync room", size_t(rooms_stack_size), std::bind(&fragment::operator(), this)
+	};
+}
+
+void
+ircd::m::sync::polylog::fragment::operator()()
+noexcept try
+{
+	const m::room room
+	{
+		room_id
+	};
+
+	if(head_idx(std::nothrow, room) <= sp.since)
+		return;
+
+	char buf[8_KiB];
+	json::stack out
+	{
+		buf, [this](const const_buffer &buf)
 		{
-			json::stack::member member{rooms_object, room.room_id};
-			json::stack::object object{member};
-			sync_room(sp, object, room, membership);
+			json.append(data(buf), size(buf));
+			return buf;
 		}
+	};
 
-		#ifdef RB_DEBUG
-		thread_local char iecbuf[64], rembuf[128];
-		log::debug
-		{
-			log, "polylog %s %s %s %s wc:%zu in %lu$ms",
-			string(rembuf, ircd::remote(sp.client)),
-			string_view{sp.request.user_id},
-			string_view{room.room_id},
-			pretty(iecbuf, iec(sp.stats.flush_bytes - stats.flush_bytes)),
-			sp.stats.flush_count - stats.flush_count,
-			stats.timer.at<milliseconds>().count()
-		};
-		#endif
-	});
+	{
+		json::stack::object object{out};
+		sync_room(sp, object, room, membership);
+	}
+
+	out.flush(true);
+	if(out.eptr)
+		std::rethrow_exception(out.eptr);
+}
+catch(...)
+{
+	eptr = std::current_exception();
+}
+
+void
+ircd::m::sync::polylog::fragment::emit(json::stack::object &out)
+{
+	if(context)
+		context.join();
+
+	if(eptr)
+		std::rethrow_exception(eptr);
+
+	// Nothing new in this room since the client's last sync.
+	if(json.empty())
+		return;
+
+	// The fragment is already a complete JSON object so it is written as
+	// the member's value directly; the pieces are bounded so the request's
+	// stack can always make room by flushing.
+	json::stack::member member{out, room_id};
+	const string_view fragment{json};
+	for(size_t i(0); i < size(fragment); i += 32_KiB)
+		sp.out.append(fragment.substr(i, 32_KiB));
+
+	#ifdef RB_DEBUG
+	thread_local char iecbuf[64], rembuf[128];
+	log::debug
+	{
+		log, "polylog %s %s %s %s in %lu$ms",
+		string(rembuf, ircd::remote(sp.client)),
+		string_view{sp.request.user_id},
+		string_view{room_id},
+		pretty(iecbuf, iec(size(fragment))),
+		timer.at<milliseconds>().count()
+	};
+	#endif
 }
 
 void
@@ -917,11 +1270,14 @@ ircd::m::sync::polylog::sync_room(shortpoll &sp,
                                   const string_view &membership)
 try
 {
+	// Depth of the oldest timeline event; state is sent from before it.
+	uint64_t state_at{0};
+
 	// timeline
 	{
 		json::stack::member member{out, "timeline"};
 		json::stack::object object{member};
-		room_timeline(sp, object, room);
+		room_timeline(sp, object, room, state_at);
 	}
 
 	// state
@@ -934,7 +1290,7 @@ try
 		};
 
 		json::stack::object object{member};
-		room_state(sp, object, room);
+		room_state(sp, object, room, state_at);
 	}
 
 	// ephemeral
@@ -974,7 +1330,8 @@ catch(const json::not_found &e)
 void
 ircd::m::sync::polylog::room_state(shortpoll &sp,
                                    json::stack::object &out,
-                                   const m::room &room)
+                                   const m::room &room,
+                                   const uint64_t &state_at)
 {
 	static const m::event::fetch::opts fopts
 	{
@@ -1013,7 +1370,7 @@ ircd::m::sync::polylog::room_state(shortpoll &sp,
 	state.for_each([&]
 	(const m::event &event)
 	{
-		if(at<"depth"_>(event) >= int64_t(sp.state_at))
+		if(at<"depth"_>(event) >= int64_t(state_at))
 			return;
 
 		const auto &event_idx
@@ -1032,7 +1389,8 @@ ircd::m::sync::polylog::room_state(shortpoll &sp,
 void
 ircd::m::sync::polylog::room_timeline(shortpoll &sp,
                                       json::stack::object &out,
-                                      const m::room &room)
+                                      const m::room &room,
+                                      uint64_t &state_at)
 {
 	// events
 	bool limited{false};
@@ -1040,7 +1398,7 @@ ircd::m::sync::polylog::room_timeline(shortpoll &sp,
 	{
 		json::stack::member member{out, "events"};
 		json::stack::array array{member};
-		prev = room_timeline_events(sp, array, room, limited);
+		prev = room_timeline_events(sp, array, room, limited, state_at);
 	}
 
 	// prev_batch
@@ -1064,7 +1422,8 @@ ircd::m::event::id::buf
 ircd::m::sync::polylog::room_timeline_events(shortpoll &sp,
                                              json::stack::array &out,
                                              const m::room &room,
-                                             bool &limited)
+                                             bool &limited,
+                                             uint64_t &state_at)
 {
 	static const m::event::fetch::opts fopts
 	{
@@ -1118,7 +1477,7 @@ ircd::m::sync::polylog::room_timeline_events(shortpoll &sp,
 	if(i > 0 && it)
 	{
 		const m::event &event{*it};
-		sp.state_at = at<"depth"_>(event);
+		state_at = at<"depth"_>(event);
 	}
 
 	if(i > 0)
@@ -75,12 +75,21 @@ namespace ircd::m::sync::linear
 
 namespace ircd::m::sync::polylog
 {
+	struct fragment;
+
 	extern conf::item<bool> prefetch_state;
 	extern conf::item<bool> prefetch_timeline;
+	extern conf::item<size_t> rooms_parallel;
+	extern conf::item<size_t> rooms_stack_size;
+
+	extern ircd::stats::histogram rooms_stat;
+	extern ircd::stats::histogram presence_stat;
+	extern ircd::stats::histogram account_data_stat;
+	extern ircd::stats::histogram snapshot_stat;
 
-	static void room_state(shortpoll &, json::stack::object &, const m::room &);
-	static m::event::id::buf room_timeline_events(shortpoll &, json::stack::array &, const m::room &, bool &limited);
-	static void room_timeline(shortpoll &, json::stack::object &, const m::room &);
+	static void room_state(shortpoll &, json::stack::object &, const m::room &, const uint64_t &state_at);
+	static m::event::id::buf room_timeline_events(shortpoll &, json::stack::array &, const m::room &, bool &limited, uint64_t &state_at);
+	static void room_timeline(shortpoll &, json::stack::object &, const m::room &, uint64_t &state_at);
 	static void room_ephemeral_events(shortpoll &, json::stack::array &, const m::room &);
 	static void room_ephemeral(shortpoll &, json::stack::object &, const m::room &);
 	static void room_account_data(shortpoll &, json::stack::object &, const m::room &);
@@ -93,6 +102,31 @@ namespace ircd::m::sync::polylog
 	static bool handle(client &, shortpoll &, json::stack::object &);
 }
 
+/// Serialized results of full (initial) polylog syncs keyed by user and
+/// filter. A later full sync by the same user with the same filter is
+/// answered with the stored body as it was; nothing since is merged into
+/// it. Its next_batch is the sequence it was made at, so the client catches
+/// up with its following sync, which is a small linear delta.
+namespace ircd::m::sync::polylog::cache
+{
+	struct snapshot;
+
+	extern conf::item<bool> enable;
+	extern conf::item<size_t> size_max;
+	extern conf::item<size_t> entry_max;
+
+	extern std::map<std::string, snapshot, std::less<>> snapshots;
+	extern size_t bytes;
+
+	static std::string key(const m::user::id &, const string_view &filter_id);
+	static void invalidate(const m::user::id &);
+	static void put(shortpoll &) noexcept;
+	static bool get(shortpoll &);
+
+	static void handle_member(const m::event &, m::vm::eval &);
+	extern m::hookfn<m::vm::eval &> member_hook;
+}
+
 /// Argument parser for the client's /sync request
 struct ircd::m::sync::args
 {
@@ -169,6 +203,8 @@ struct ircd::m::sync::shortpoll
 	,args{args}
 	{}
 
+	~shortpoll() noexcept;
+
 	sync::stats stats;
 	ircd::client &client;
 	const sync::args &args;
@@ -219,12 +255,14 @@ struct ircd::m::sync::shortpoll
 		user
 	};
 
-	uint64_t state_at
+	bool committed
 	{
-		0
+		false
 	};
 
-	bool committed
+	/// Copy of the whole response body for polylog::cache, when capturing.
+	std::unique_ptr<std::string> snapshot;
+	bool snapshot_complete
 	{
 		false
 	};
@@ -250,14 +288,52 @@ struct ircd::m::sync::shortpoll
 
 	const_buffer flush(const const_buffer &buf)
 	{
+		// Output discarded here can't be reproduced from a snapshot.
 		if(!committed)
+		{
+			snapshot.reset();
 			return buf;
+		}
 
 		if(!response)
 			commit();
 
 		stats.flush_bytes += response->write(buf);
 		stats.flush_count++;
+		if(snapshot)
+			snapshot->append(data(buf), size(buf));
+
 		return buf;
 	}
 };
+
+/// A room of the polylog sync rendered by a helper context. Each room's JSON
+/// object is composed into a buffer owned here so several rooms can wait on
+/// the database at once; the request context then appends the fragments to
+/// its own json::stack in the order the rooms were iterated.
+struct ircd::m::sync::polylog::fragment
+{
+	shortpoll &sp;
+	m::room::id::buf room_id;
+	std::string membership;
+	std::string json;
+	std::exception_ptr eptr;
+	ircd::timer timer;
+	ctx::context context;
+
+	void operator()() noexcept;
+
+  public:
+	void emit(json::stack::object &out);
+
+	fragment(shortpoll &, const m::room &, const string_view &membership, const bool &spawn);
+	fragment(fragment &&) = delete;
+	fragment(const fragment &) = delete;
+};
+
+struct ircd::m::sync::polylog::cache::snapshot
+{
+	uint64_t sequence {0};
+	std::string body;
+	steady_point last_used;
+};
@@ -565,6 +565,31 @@ console_cmd__mark(opt &out, const string_view &line)
 	return console_cmd__log__mark(out, line);
 }
 
+bool
+console_cmd__log__stats(opt &out, const string_view &line)
+{
+	const auto stats
+	{
+		log::stats()
+	};
+
+	if(!stats.size)
+	{
+		out << "The log is written synchronously." << std::endl;
+		return true;
+	}
+
+	out << std::setw(12) << std::left << "size" << stats.size << std::endl
+	    << std::setw(12) << std::left << "queued" << stats.queued << std::endl
+	    << std::setw(12) << std::left << "pushed" << stats.pushed << std::endl
+	    << std::setw(12) << std::left << "written" << stats.written << std::endl
+	    << std::setw(12) << std::left << "dropped" << stats.dropped << std::endl
+	    << std::setw(12) << std::left << "blocked" << stats.blocked << std::endl
+	    << std::setw(12) << std::left << "batches" << stats.batches << std::endl;
+
+	return true;
+}
+
 //
 // info
 //
@@ -1080,6 +1105,38 @@ console_cmd__conf__reset(opt &out, const string_view &line)
 	return true;
 }
 
+//
+// stats
+//
+
+bool
+console_cmd__stats(opt &out, const string_view &line)
+{
+	const params param{line, " ",
+	{
+		"prefix"
+	}};
+
+	const auto &prefix
+	{
+		param.at("prefix", ""_sv)
+	};
+
+	std::stringstream ss;
+	stats::expose(ss);
+	tokens(ss.str(), '\n', [&out, &prefix]
+	(const string_view &line)
+	{
+		if(startswith(line, '#'))
+			return;
+
+		if(!prefix || startswith(line, prefix))
+			out << line << std::endl;
+	});
+
+	return true;
+}
+
 //
 // hook
 //
@@ -1353,6 +1410,60 @@ console_cmd__ctx__list(opt &out, const string_view &line)
 		out << std::endl;
 	}
 
+	const auto &stats(ctx::stack_pool::stats);
+	out << std::endl
+	    << "stack pool: "
+	    << ctx::stack_pool::count() << " cached "
+	    << pretty(iec(ctx::stack_pool::bytes())) << " ("
+	    << pretty(iec(ctx::stack_pool::bytes_resident())) << " resident); "
+	    << stats.allocs << " allocs "
+	    << stats.reuses << " reuses "
+	    << stats.maps << " maps "
+	    << stats.unmaps << " unmaps "
+	    << stats.trims << " trims"
+	    << std::endl;
+
+	ctx::stack_pool::for_each([&out]
+	(const size_t &size, const size_t &count)
+	{
+		out << std::setw(12) << std::right << size
+		    << "  " << count
+		    << std::endl;
+
+		return true;
+	});
+
+	return true;
+}
+
+bool
+console_cmd__ctx__sched(opt &out, const string_view &line)
+{
+	out << std::setw(12) << std::left << "CLASS"
+	    << std::setw(8) << std::right << "READY"
+	    << std::setw(14) << std::right << "RESUMES"
+	    << std::setw(12) << std::right << "DEFERS"
+	    << std::setw(12) << std::right << "WAIT AVG us"
+	    << std::setw(12) << std::right << "WAIT MAX us"
+	    << std::endl;
+
+	for(uint i(0); i < ctx::sched::stat.size(); ++i)
+	{
+		const auto &stat(ctx::sched::stat[i]);
+		const auto avg
+		{
+			stat.resumes? stat.wait_total.count() / stat.resumes : 0
+		};
+
+		out << std::setw(12) << std::left << ctx::sched::reflect(ctx::sched::prio(i))
+		    << std::setw(8) << std::right << stat.ready
+		    << std::setw(14) << std::right << stat.resumes
+		    << std::setw(12) << std::right << stat.defers
+		    << std::setw(12) << std::right << avg
+		    << std::setw(12) << std::right << stat.wait_max.count()
+		    << std::endl;
+	}
+
 	return true;
 }
 
@@ -1365,6 +1476,97 @@ console_cmd__ctx(opt &out, const string_view &line)
 	return true;
 }
 
+//
+// prof
+//
+
+bool
+console_cmd__prof(opt &out, const string_view &line)
+{
+	out << "running:   " << (ctx::prof::sample::running()? "yes" : "no") << std::endl
+	    << "samples:   " << ctx::prof::sample::count() << std::endl
+	    << "hz:        " << size_t(ctx::prof::sample::hz) << std::endl
+	    << "ring:      " << size_t(ctx::prof::sample::ring_size) << std::endl;
+
+	return true;
+}
+
+bool
+console_cmd__prof__start(opt &out, const string_view &line)
+{
+	ctx::prof::sample::start();
+	out << "Sampling the main thread at "
+	    << size_t(ctx::prof::sample::hz) << " Hz."
+	    << std::endl;
+
+	return true;
+}
+
+bool
+console_cmd__prof__stop(opt &out, const string_view &line)
+{
+	ctx::prof::sample::stop();
+	out << "Stopped after "
+	    << ctx::prof::sample::count() << " samples."
+	    << std::endl;
+
+	return true;
+}
+
+bool
+console_cmd__prof__dump(opt &out, const string_view &line)
+{
+	const params param{line, " ",
+	{
+		"ctx"
+	}};
+
+	const auto &ctx_name
+	{
+		param.at("ctx", ""_sv)
+	};
+
+	ctx::prof::sample::dump(out, ctx_name);
+	return true;
+}
+
+bool
+console_cmd__prof__save(opt &out, const string_view &line)
+{
+	const params param{line, " ",
+	{
+		"path", "ctx"
+	}};
+
+	const auto &path
+	{
+		param.at("path")
+	};
+
+	const auto &ctx_name
+	{
+		param.at("ctx", ""_sv)
+	};
+
+	std::stringstream ss;
+	const size_t count
+	{
+		ctx::prof::sample::dump(ss, ctx_name)
+	};
+
+	const std::string str
+	{
+		ss.str()
+	};
+
+	fs::overwrite(path, const_buffer{str});
+	out << "Wrote " << count << " samples to " << path
+	    << " in the folded format; render with flamegraph.pl."
+	    << std::endl;
+
+	return true;
+}
+
 //
 // db
 //
@@ -3633,6 +3835,8 @@ console_cmd__peer(opt &out, const string_view &line)
 		    << " " << setw(9) << right << peer.read_size()      << " DN Q"
 		    << " " << setw(9) << right << peer.write_total()    << " UP"
 		    << " " << setw(9) << right << peer.read_total()     << " DN"
+		    << " " << setw(7) << right << duration_cast<milliseconds>(peer.latency.head_avg).count() << " HD ms"
+		    << " " << setw(7) << right << duration_cast<milliseconds>(peer.latency.done_avg).count() << " RT ms"
 		    ;
 
 		if(peer.err_has() && peer.err_msg())
@@ -3666,6 +3870,28 @@ console_cmd__peer(opt &out, const string_view &line)
 		};
 
 		print(peer.hostcanon, peer);
+		out << std::endl;
+		for(const auto &link : peer.links)
+			out << "link " << &link
+			    << " " << std::setw(2) << std::right << link.tag_count() << " T"
+			    << " " << std::setw(7) << std::right << duration_cast<milliseconds>(link.latency.head_avg).count() << " HD ms"
+			    << " " << std::setw(7) << std::right << duration_cast<milliseconds>(link.latency.done_avg).count() << " RT ms"
+			    << " " << std::setw(7) << std::right << duration_cast<milliseconds>(link.eta()).count() << " ETA ms"
+			    << (link.stalled()? " STALLED" : "")
+			    << std::endl;
+
+		const auto &latency(peer.latency);
+		out << std::endl
+		    << "responses: " << latency.dones
+		    << " max: " << duration_cast<milliseconds>(latency.done_max).count() << " ms"
+		    << std::endl;
+
+		for(size_t i(0); i < latency.histogram.size(); ++i)
+			out << (i + 1 < latency.histogram.size()? "<  " : ">= ")
+			    << std::setw(6) << std::right << (1L << (i + 1 < latency.histogram.size()? i : i - 1)) << " ms "
+			    << std::setw(9) << std::right << latency.histogram[i]
+			    << std::endl;
+
 		return true;
 	}
 
@@ -4045,6 +4271,51 @@ console_cmd__net__host__cache__A__clear(opt &out, const string_view &line)
 	return true;
 }
 
+bool
+console_cmd__net__host__cache__AAAA(opt &out, const string_view &line)
+{
+	net::dns::cache::for_each("AAAA", [&]
+	(const auto &host, const auto &r)
+	{
+		const auto &record
+		{
+			dynamic_cast<const rfc1035::record::AAAA &>(r)
+		};
+
+		const net::ipport ipp{record.ip6, 0};
+		out << std::setw(48) << std::right << host
+		    << "  =>  " << std::setw(41) << std::left << ipp
+		    << "  expires " << timestr(record.ttl, ircd::localtime)
+		    << " (" << record.ttl << ")"
+		    << std::endl;
+
+		return true;
+	});
+
+	return true;
+}
+
+bool
+console_cmd__net__host__cache__AAAA__count(opt &out, const string_view &line)
+{
+	size_t count[2] {0};
+	net::dns::cache::for_each("AAAA", [&]
+	(const auto &host, const auto &r)
+	{
+		const auto &record
+		{
+			dynamic_cast<const rfc1035::record::AAAA &>(r)
+		};
+
+		++count[bool(record.ip6)];
+		return true;
+	});
+
+	out << "resolved:  " << count[1] << std::endl;
+	out << "error:     " << count[0] << std::endl;
+	return true;
+}
+
 bool
 console_cmd__net__host__cache__SRV(opt &out, const string_view &line)
 {
@@ -4165,6 +4436,42 @@ console_cmd__net__host__prefetch(opt &out, const string_view &line)
 	return true;
 }
 
+bool
+console_cmd__net__session(opt &out, const string_view &line)
+{
+	out << "cached:    " << net::session::count() << " of " << size_t(net::session::max) << std::endl;
+	out << "stored:    " << net::session::stored << std::endl;
+	out << "offered:   " << net::session::offered << std::endl;
+	out << "resumed:   " << net::session::resumed << std::endl;
+	return true;
+}
+
+bool
+console_cmd__net__session__clear(opt &out, const string_view &line)
+{
+	const params param{line, " ",
+	{
+		"hostport"
+	}};
+
+	if(!param.count())
+	{
+		net::session::clear();
+		out << "Cleared all cached TLS sessions." << std::endl;
+		return true;
+	}
+
+	net::open_opts opts
+	{
+		net::hostport{param.at("hostport")}
+	};
+
+	char buf[rfc1035::NAME_BUF_SIZE + 8];
+	net::session::erase(net::session::key(buf, opts));
+	out << "Cleared any cached TLS session for " << opts.hostport << std::endl;
+	return true;
+}
+
 bool
 console_cmd__net__listen__list(opt &out, const string_view &line)
 {
@@ -4185,6 +4492,23 @@ console_cmd__net__listen__list(opt &out, const string_view &line)
 	return true;
 }
 
+bool
+console_cmd__net__listen__handshake(opt &out, const string_view &line)
+{
+	const auto &stats(net::listener::handshake_stats);
+	out << "queued:       " << stats.queued << std::endl
+	    << "active:       " << stats.active << std::endl
+	    << "active max:   " << stats.active_max << std::endl
+	    << "total:        " << stats.total << std::endl
+	    << "steps:        " << stats.steps << std::endl
+	    << "ktls:         " << stats.ktls << std::endl
+	    << "queue avg:    " << (stats.total? stats.queue_total.count() / stats.total : 0) << " us" << std::endl
+	    << "queue max:    " << stats.queue_max.count() << " us" << std::endl
+	    << "crypto avg:   " << (stats.total? stats.cpu_total.count() / stats.total : 0) << " us" << std::endl;
+
+	return true;
+}
+
 bool
 console_cmd__net__listen(opt &out, const string_view &line)
 {
@@ -5657,22 +5981,34 @@ console_cmd__state__root(opt &out, const string_view &line)
 	return true;
 }
 
+bool
+console_cmd__state__gc__status(opt &out, const string_view &line)
+{
+	using prototype = void (std::ostream &);
+	static mods::import<prototype> status
+	{
+		"m_state", "ircd__m__state__gc_status"
+	};
+
+	status(out);
+	return true;
+}
+
 bool
 console_cmd__state__gc(opt &out, const string_view &line)
 {
-	using prototype = size_t ();
+	using prototype = bool ();
 	static mods::import<prototype> gc
 	{
 		"m_state", "ircd__m__state__gc"
 	};
 
-	const size_t count
-	{
-		gc()
-	};
+	if(gc())
+		out << "Started state garbage collection." << std::endl;
+	else
+		out << "State garbage collection is already running." << std::endl;
 
-	out << "done: " << count << std::endl;
-	return true;
+	return console_cmd__state__gc__status(out, line);
 }
 
 //
@@ -5762,11 +6098,6 @@ console_cmd__eval__file(opt &out, const string_view &line)
 		token.at(0)
 	};
 
-	const fs::fd file
-	{
-		path
-	};
-
 	const auto limit
 	{
 		token.at<size_t>(1)
@@ -5777,97 +6108,70 @@ console_cmd__eval__file(opt &out, const string_view &line)
 		token[2]? lex_cast<size_t>(token[2]) : 0
 	};
 
-	const string_view id{token[3]};
-	const string_view room_id
+	const string_view id
 	{
-		id && m::sigil(id) == m::id::ROOM? id : string_view{}
+		token[3]
 	};
 
-	const string_view event_id
+	using prototype = void (std::ostream &,
+	                        const string_view &,
+	                        const size_t &,
+	                        const size_t &,
+	                        const string_view &);
+
+	static mods::import<prototype> import_file
 	{
-		id && m::sigil(id) == m::id::EVENT? id : string_view{}
+		"m_import", "ircd__m__import__file"
 	};
 
-	const string_view sender
+	import_file(out, path, limit, start, id);
+	return true;
+}
+
+//
+// loadgen
+//
+
+bool
+console_cmd__loadgen(opt &out, const string_view &line)
+{
+	const params param{line, " ",
 	{
-		id && m::sigil(id) == m::id::USER? id : string_view{}
-	};
+		"seconds", "clients", "peers", "remote"
+	}};
 
-	m::vm::opts opts;
-	opts.non_conform.set(m::event::conforms::MISSING_PREV_STATE);
-	opts.non_conform.set(m::event::conforms::MISSING_MEMBERSHIP);
-	opts.prev_check_exists = false;
-	opts.notify = false;
-	opts.verify = false;
-	m::vm::eval eval
+	const seconds duration
 	{
-		opts
+		param.at<long>(0)
 	};
 
-	size_t foff{0};
-	size_t i(0), j(0), r(0);
-	for(; !limit || i < limit; ++r)
+	const auto clients
 	{
-		static char buf[512_KiB];
-		const string_view read
-		{
-			fs::read(file, buf, foff)
-		};
-
-		size_t boff(0);
-		json::object object;
-		json::vector vector{read};
-		for(; boff < size(read) && i < limit; ) try
-		{
-			object = *begin(vector);
-			boff += size(string_view{object});
-			vector = { data(read) + boff, size(read) - boff };
-			const m::event event
-			{
-				object
-			};
-
-			if(room_id && json::get<"room_id"_>(event) != room_id)
-				continue;
-
-			if(event_id && json::get<"event_id"_>(event) != event_id)
-				continue;
-
-			if(sender && json::get<"sender"_>(event) != sender)
-				continue;
-
-			if(j++ < start)
-				continue;
+		param.at<size_t>(1, 16)
+	};
 
-			eval(event);
-			++i;
-		}
-		catch(const json::parse_error &e)
-		{
-			break;
-		}
-		catch(const std::exception &e)
-		{
-			out << fmt::snstringf
-			{
-				128, "Error at i=%zu j=%zu r=%zu foff=%zu boff=%zu\n",
-				i, j, r, foff, boff
-			};
+	const auto peers
+	{
+		param.at<size_t>(2, 0)
+	};
 
-			out << string_view{object} << std::endl;
-			out << e.what() << std::endl;
-			return true;
-		}
+	const string_view remote
+	{
+		param[3]
+	};
 
-		foff += boff;
-	}
+	using prototype = void (std::ostream &,
+	                        const string_view &,
+	                        const seconds &,
+	                        const size_t &,
+	                        const size_t &);
 
-	out << "Executed " << i
-	    << " of " << j << " events"
-	    << " in " << foff << " bytes"
-	    << " using " << r << " reads"
-	    << std::endl;
+	static mods::import<prototype> loadgen
+	{
+		"m_loadgen", "ircd__m__loadgen"
+	};
 
+	loadgen(out, remote, duration, clients, peers);
 	return true;
 }
 
@@ -6265,6 +6569,19 @@ console_cmd__room__depth(opt &out, const string_view &line)
 	return true;
 }
 
+bool
+console_cmd__room__visible__cache(opt &out, const string_view &line)
+{
+	using prototype = void (std::ostream &);
+	static mods::import<prototype> stats
+	{
+		"m_room_history_visibility", "visible_cache_stats"
+	};
+
+	stats(out);
+	return true;
+}
+
 bool
 console_cmd__room__visible(opt &out, const string_view &line)
 {
@@ -6772,7 +7089,7 @@ console_cmd__room__state__keys(opt &out, const string_view &line)
 
 	const string_view &prefix
 	{
-		param.at("prefix", string_view{})
+		param.at("prefix", ""_sv)
 	};
 
 	const m::room room
@@ -7092,6 +7409,11 @@ console_cmd__room__count(opt &out, const string_view &line)
 		param[1]
 	};
 
+	const m::room_event_filter::compiled compiled
+	{
+		json::object{param[1]}
+	};
+
 	const m::room room
 	{
 		room_id
@@ -7107,7 +7429,7 @@ console_cmd__room__count(opt &out, const string_view &line)
 	for(; it && limit; --it, --limit)
 	{
 		const m::event &event{*it};
-		count += match(filter, event);
+		count += compiled.match(event);
 	}
 
 	out << count << std::endl;
@@ -8161,6 +8483,23 @@ console_cmd__user__events__count(opt &out, const string_view &line)
 	return true;
 }
 
+//
+// push
+//
+
+bool
+console_cmd__push__stats(opt &out, const string_view &line)
+{
+	using prototype = void (std::ostream &);
+	static mods::import<prototype> stats
+	{
+		"m_push", "push__stats"
+	};
+
+	stats(out);
+	return true;
+}
+
 //
 // users
 //
@@ -8175,7 +8514,7 @@ console_cmd__users(opt &out, const string_view &line)
 
 	const auto prefix
 	{
-		param.at("prefix", string_view{})
+		param.at("prefix", ""_sv)
 	};
 
 	m::users::for_each(prefix, m::user::closure_bool{[&out, &prefix]
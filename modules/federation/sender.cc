@@ -86,6 +86,11 @@ handle_notify(const m::event &event,
 void
 send_worker()
 {
+	const ctx::sched::scope prio
+	{
+		ctx::sched::prio::FEDERATION
+	};
+
 	while(1) try
 	{
 		notified_dock.wait([]
@@ -246,6 +251,11 @@ catch(const std::exception &e)
 void
 recv_worker()
 {
+	const ctx::sched::scope prio
+	{
+		ctx::sched::prio::FEDERATION
+	};
+
 	while(1)
 	{
 		recv_action.wait([]
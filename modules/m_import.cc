@@ -0,0 +1,355 @@
+// Matrix Construct
+//
+// Copyright (C) Matrix Construct Developers, Authors & Contributors
+// Copyright (C) 2016-2018 Jason Volk <jason@zemos.net>
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice is present in all copies. The
+// full license for this software is available in the LICENSE file.
+
+using namespace ircd;
+
+mapi::header
+IRCD_MODULE
+{
+	"Matrix bulk event import"
+};
+
+/// Bulk import of a file of concatenated JSON events (i.e. the output of
+/// tools/synapse.db.py).
+///
+/// The import is a two stage pipeline. While the events of one batch are
+/// evaluated in file order on the main thread, the next batch is read from
+/// the file, split into objects, parsed and checked for conformity on an
+/// offload (ctx::ole) thread. The evaluation itself must remain sequential:
+/// each event's state tree is built from the root left by the prior event.
+///
+namespace ircd::m::import
+{
+	struct batch;
+
+	extern conf::item<size_t> read_size;
+	extern conf::item<bool> journal;
+	extern log::log log;
+
+	static size_t split(const string_view &buf, std::vector<json::object> &out);
+	static void prepare(batch &, const fs::fd &, const size_t &offset) noexcept;
+
+	extern "C" void
+	ircd__m__import__file(std::ostream &out,
+	                      const string_view &path,
+	                      const size_t &limit,
+	                      const size_t &start,
+	                      const string_view &id);
+}
+
+struct ircd::m::import::batch
+{
+	unique_buffer<mutable_buffer> buf;
+	std::vector<json::object> objects;
+	std::vector<m::event> events;
+	std::vector<m::event::conforms> reports;
+	std::exception_ptr eptr;
+	size_t offset {0};
+	size_t consumed {0};
+	bool eof {false};
+
+	batch(const size_t &size)
+	:buf{size}
+	{}
+};
+
+decltype(ircd::m::import::read_size)
+ircd::m::import::read_size
+{
+	{ "name",     "ircd.m.import.read_size" },
+	{ "default",  int64_t(16_MiB)           },
+};
+
+/// Disabling the journal speeds up an import considerably but is only safe
+/// when nothing else writes to the database during the import: a journaled
+/// write which refers to state written unjournaled is recovered after a
+/// crash without the state it refers to. The memtables are flushed to SST
+/// when an unjournaled import finishes or fails.
+decltype(ircd::m::import::journal)
+ircd::m::import::journal
+{
+	{ "name",     "ircd.m.import.journal" },
+	{ "default",  true                    },
+};
+
+decltype(ircd::m::import::log)
+ircd::m::import::log
+{
+	"m.import"
+};
+
+void
+ircd::m::import::ircd__m__import__file(std::ostream &out,
+                                       const string_view &path,
+                                       const size_t &limit,
+                                       const size_t &start,
+                                       const string_view &id)
+{
+	const ctx::sched::scope prio
+	{
+		ctx::sched::prio::BACKGROUND
+	};
+
+	const fs::fd file
+	{
+		path
+	};
+
+	const string_view room_id
+	{
+		id && m::sigil(id) == m::id::ROOM? id : string_view{}
+	};
+
+	const string_view event_id
+	{
+		id && m::sigil(id) == m::id::EVENT? id : string_view{}
+	};
+
+	const string_view sender
+	{
+		id && m::sigil(id) == m::id::USER? id : string_view{}
+	};
+
+	// The conformity report is computed by the prepare stage and handed to
+	// each eval through opts.report.
+	m::vm::opts opts;
+	opts.non_conform.set(m::event::conforms::MISSING_PREV_STATE);
+	opts.non_conform.set(m::event::conforms::MISSING_MEMBERSHIP);
+	opts.conformed = true;
+	opts.prev_check_exists = false;
+	opts.notify = false;
+	opts.verify = false;
+	opts.journal = bool(journal);
+	m::vm::eval eval
+	{
+		opts
+	};
+
+	const size_t bufsz
+	{
+		std::max(size_t(read_size), size_t(64_KiB))
+	};
+
+	batch a{bufsz}, b{bufsz};
+	batch *cur{&a}, *next{&b};
+	prepare(*cur, file, 0);
+
+	// Unjournaled writes exist only in the memtables until those are flushed
+	// to SST; FlushWAL would persist nothing here.
+	const unwind flush{[&opts]
+	{
+		if(!opts.journal) try
+		{
+			db::sort(*m::dbs::events, true);
+		}
+		catch(const std::exception &e)
+		{
+			log::critical
+			{
+				log, "Failed to flush the unjournaled import :%s", e.what()
+			};
+		}
+	}};
+
+	const auto started(ircd::time());
+	size_t i(0), j(0), r(0), foff(0);
+	for(; !limit || i < limit; ++r)
+	{
+		if(cur->eptr)
+			std::rethrow_exception(cur->eptr);
+
+		if(cur->objects.empty())
+		{
+			if(!cur->eof)
+				log::error
+				{
+					log, "Object at offset %zu larger than the %zu byte read buffer",
+					cur->offset,
+					bufsz
+				};
+
+			break;
+		}
+
+		// The next batch is prepared on the offload thread while this one is
+		// evaluated here.
+		ctx::context preparer
+		{
+			"import", 256_KiB, [&file, next, offset(cur->offset + cur->consumed)]
+			{
+				prepare(*next, file, offset);
+			},
+			ctx::context::POST
+		};
+
+		const unwind join{[&preparer]
+		{
+			preparer.join();
+		}};
+
+		for(size_t k(0); k < cur->events.size() && (!limit || i < limit); ++k) try
+		{
+			const auto &event(cur->events[k]);
+			if(room_id && json::get<"room_id"_>(event) != room_id)
+				continue;
+
+			if(event_id && json::get<"event_id"_>(event) != event_id)
+				continue;
+
+			if(sender && json::get<"sender"_>(event) != sender)
+				continue;
+
+			if(j++ < start)
+				continue;
+
+			opts.report = cur->reports[k];
+			eval(event);
+			++i;
+		}
+		catch(const std::exception &e)
+		{
+			out << fmt::snstringf
+			{
+				128, "Error at i=%zu j=%zu r=%zu foff=%zu\n",
+				i, j, r, cur->offset
+			};
+
+			out << string_view{cur->objects[k]} << std::endl;
+			out << e.what() << std::endl;
+			return;
+		}
+
+		foff = cur->offset + cur->consumed;
+		std::swap(cur, next);
+	}
+
+	log::info
+	{
+		log, "Imported %zu of %zu events from `%s' in %zu bytes, %zu reads, %ld$s",
+		i,
+		j,
+		path,
+		foff,
+		r,
+		ircd::time() - started
+	};
+
+	out << "Executed " << i
+	    << " of " << j << " events"
+	    << " in " << foff << " bytes"
+	    << " using " << r << " reads"
+	    << std::endl;
+}
+
+/// Fills the batch with everything which can be done off the main thread:
+/// the read, the split into objects, the parse into m::event tuples and the
+/// conformity check. Exceptions are carried in the batch.
+void
+ircd::m::import::prepare(batch &batch,
+                         const fs::fd &file,
+                         const size_t &offset)
+noexcept try
+{
+	batch.objects.clear();
+	batch.events.clear();
+	batch.reports.clear();
+	batch.eptr = {};
+	batch.offset = offset;
+	batch.consumed = 0;
+
+	// This runs on an offload thread where there is no ctx to wait on an
+	// AIO completion; the read is made with a direct syscall instead.
+	fs::read_opts ropts
+	{
+		off_t(offset)
+	};
+
+	ropts.aio = false;
+	ctx::offload([&batch, &file, &ropts]
+	{
+		const string_view read
+		{
+			fs::read(file, batch.buf, ropts)
+		};
+
+		batch.eof = size(read) < size(batch.buf);
+		batch.consumed = split(read, batch.objects);
+		batch.events.reserve(batch.objects.size());
+		batch.reports.reserve(batch.objects.size());
+		for(const auto &object : batch.objects)
+		{
+			batch.events.emplace_back(object);
+			batch.reports.emplace_back(batch.events.back());
+		}
+	});
+}
+catch(...)
+{
+	batch.eptr = std::current_exception();
+}
+
+/// Finds the top-level objects in the buffer with a structural scan which
+/// tracks only braces, strings and escapes; this is far cheaper than the full
+/// parse. Returns the number of bytes consumed; an incomplete object at the
+/// tail is left for the next read.
+size_t
+ircd::m::import::split(const string_view &buf,
+                       std::vector<json::object> &out)
+{
+	const char *const start(data(buf)), *const stop(data(buf) + size(buf));
+	const char *begin(nullptr), *end(start);
+	size_t depth(0);
+	bool quote(false);
+	for(const char *p(start); p < stop; ++p)
+	{
+		if(quote)
+		{
+			if(*p == '\\')
+				++p;
+			else if(*p == '"')
+				quote = false;
+
+			continue;
+		}
+
+		switch(*p)
+		{
+			case '"':
+				quote = true;
+				continue;
+
+			case '{':
+				if(depth++ == 0)
+					begin = p;
+
+				continue;
+
+			case '}':
+				if(unlikely(!depth))
+					throw json::parse_error
+					{
+						"Unbalanced object at offset %zu", size_t(p - start)
+					};
+
+				if(--depth == 0)
+				{
+					end = p + 1;
+					out.emplace_back(string_view{begin, end});
+				}
+
+				continue;
+
+			default:
+				continue;
+		}
+	}
+
+	return depth == 0 && !quote? size(buf) : size_t(end - start);
+}
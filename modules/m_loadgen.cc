@@ -0,0 +1,954 @@
+// Matrix Construct
+//
+// Copyright (C) Matrix Construct Developers, Authors & Contributors
+// Copyright (C) 2016-2018 Jason Volk <jason@zemos.net>
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice is present in all copies. The
+// full license for this software is available in the LICENSE file.
+
+using namespace ircd;
+
+mapi::header
+IRCD_MODULE
+{
+	"Matrix synthetic load generator"
+};
+
+/// Synthetic load against a homeserver's listener, for capacity testing.
+///
+/// Every request is made over the network with server::request so the
+/// whole path (listener, resource, vm, sync) is exercised as it would be in
+/// production. Two populations are simulated for a fixed duration:
+///
+/// - clients: local users (@loadgen_N) spread across local rooms. Each
+/// client holds a /sync longpoll open on one context while another context
+/// joins its room, sends messages and occasionally paginates /messages.
+///
+/// - peers: fake federation origins (loadgenN.invalid), each with its own
+/// ed25519 key seeded into the key cache. A peer builds its own room DAG and
+/// pushes it with signed /send transactions of signed PDUs.
+///
+/// Users, rooms and peer keys are provisioned in-process before the run;
+/// access tokens are issued like a login would. Peer keys are generated
+/// randomly for each run and are only valid for about its duration. The
+/// cached keys and the issued tokens are erased again when the run ends, so
+/// nothing provisioned can be used after it. The latency of each request
+/// is recorded per endpoint and percentiles and throughput are reported.
+///
+/// The users and rooms themselves are not removed: the server has no way to
+/// delete a user, and a room purge would race the federation traffic still
+/// in flight. Their names are deterministic, so later runs reuse them rather
+/// than accumulating more. They persist in the database until cleaned up by
+/// hand: `room purge !loadgenN:<origin>` for the local rooms and
+/// `room purge !loadgen:loadgenN.invalid` for the peer rooms, followed by
+/// `user deactivate @loadgen_N:<origin>` for each local user.
+///
+namespace ircd::m::loadgen
+{
+	struct endpoint;
+	struct client;
+	struct peer;
+
+	using endpoints = std::map<string_view, endpoint, std::less<>>;
+	using closure = std::function<void (const json::object &)>;
+
+	extern conf::item<milliseconds> think_time;
+	extern conf::item<milliseconds> sync_timeout;
+	extern conf::item<milliseconds> request_timeout;
+	extern conf::item<size_t> room_size;
+	extern conf::item<size_t> messages_interval;
+	extern conf::item<size_t> join_interval;
+	extern conf::item<size_t> txn_pdus;
+	extern log::log log;
+
+	static bool call(endpoint &, const net::hostport &, server::out, server::in, const closure & = {});
+	static bool call(endpoint &, const net::hostport &, const client &, const string_view &method, const string_view &uri, const json::members &content = {}, const closure & = {});
+	static bool call(endpoint &, const net::hostport &, peer &, const vector_view<const std::string> &pdus);
+
+	static std::string make_pdu(peer &, json::iov &event, const json::iov &content);
+	static void provision(peer &, const seconds &duration);
+	static void provision(client &);
+	static void erase(const m::room &, const string_view &type, const string_view &state_key) noexcept;
+	static void release(peer &) noexcept;
+	static void release(client &) noexcept;
+
+	static void run_client(endpoints &, const net::hostport &, client &, const steady_point &deadline);
+	static void run_syncer(endpoints &, const net::hostport &, client &, const steady_point &deadline);
+	static void run_peer(endpoints &, const net::hostport &, peer &, const steady_point &deadline);
+	static void report(std::ostream &, endpoints &, const seconds &elapsed);
+
+	extern "C" void
+	ircd__m__loadgen(std::ostream &out,
+	                 const string_view &remote,
+	                 const seconds &duration,
+	                 const size_t &clients,
+	                 const size_t &peers);
+}
+
+struct ircd::m::loadgen::endpoint
+{
+	std::vector<uint32_t> samples;  // microseconds
+	size_t errors {0};
+};
+
+struct ircd::m::loadgen::client
+{
+	m::user::id::buf user_id;
+	m::room::id::buf room_id;
+	std::string access_token;
+	std::string since;
+	size_t txnid {0};
+};
+
+struct ircd::m::loadgen::peer
+{
+	std::string origin;
+	std::string key_id;
+	ed25519::pk pk;
+	ed25519::sk sk;
+	m::user::id::buf user_id;
+	m::room::id::buf room_id;
+	m::event::id::buf create_id;
+	m::event::id::buf member_id;
+	m::event::id::buf head;
+	int64_t depth {0};
+	size_t txnid {0};
+};
+
+decltype(ircd::m::loadgen::think_time)
+ircd::m::loadgen::think_time
+{
+	{ "name",     "ircd.m.loadgen.think_time" },
+	{ "default",  250L                        },
+};
+
+decltype(ircd::m::loadgen::sync_timeout)
+ircd::m::loadgen::sync_timeout
+{
+	{ "name",     "ircd.m.loadgen.sync_timeout" },
+	{ "default",  10000L                        },
+};
+
+decltype(ircd::m::loadgen::request_timeout)
+ircd::m::loadgen::request_timeout
+{
+	{ "name",     "ircd.m.loadgen.request_timeout" },
+	{ "default",  30000L                           },
+};
+
+decltype(ircd::m::loadgen::room_size)
+ircd::m::loadgen::room_size
+{
+	{ "name",     "ircd.m.loadgen.room_size" },
+	{ "default",  16L                        },
+};
+
+decltype(ircd::m::loadgen::messages_interval)
+ircd::m::loadgen::messages_interval
+{
+	{ "name",     "ircd.m.loadgen.messages_interval" },
+	{ "default",  8L                                 },
+};
+
+decltype(ircd::m::loadgen::join_interval)
+ircd::m::loadgen::join_interval
+{
+	{ "name",     "ircd.m.loadgen.join_interval" },
+	{ "default",  32L                            },
+};
+
+decltype(ircd::m::loadgen::txn_pdus)
+ircd::m::loadgen::txn_pdus
+{
+	{ "name",     "ircd.m.loadgen.txn_pdus" },
+	{ "default",  4L                        },
+};
+
+decltype(ircd::m::loadgen::log)
+ircd::m::loadgen::log
+{
+	"m.loadgen"
+};
+
+void
+ircd::m::loadgen::ircd__m__loadgen(std::ostream &out,
+                                   const string_view &remote_,
+                                   const seconds &duration,
+                                   const size_t &clients_,
+                                   const size_t &peers_)
+{
+	const net::hostport remote
+	{
+		remote_?: my_host()
+	};
+
+	std::vector<client> clients(clients_);
+	std::vector<peer> peers(peers_);
+
+	// Runs after the contexts below are gone, including when this command
+	// is interrupted or provisioning fails part way.
+	const unwind release_all{[&clients, &peers]
+	{
+		for(auto &client : clients)
+			release(client);
+
+		for(auto &peer : peers)
+			release(peer);
+	}};
+
+	for(size_t i(0); i < clients.size(); ++i)
+	{
+		auto &client(clients[i]);
+		client.user_id = m::user::id::buf
+		{
+			fmt::snstringf{64, "loadgen_%zu", i}, my_host()
+		};
+
+		client.room_id = m::room::id::buf
+		{
+			fmt::snstringf{64, "loadgen%zu", i / std::max(size_t(room_size), 1UL)}, my_host()
+		};
+
+		provision(client);
+	}
+
+	for(size_t i(0); i < peers.size(); ++i)
+	{
+		auto &peer(peers[i]);
+		peer.origin = fmt::snstringf
+		{
+			128, "loadgen%zu.invalid", i
+		};
+
+		provision(peer, duration);
+	}
+
+	log::notice
+	{
+		log, "Generating load on %s for %ld s with %zu clients and %zu peers",
+		string(remote),
+		duration.count(),
+		clients.size(),
+		peers.size()
+	};
+
+	endpoints endpoints;
+	const ircd::timer timer;
+	const steady_point deadline
+	{
+		now<steady_point>() + duration
+	};
+
+	std::vector<ctx::context> contexts;
+	contexts.reserve(clients.size() * 2 + peers.size());
+	for(auto &client : clients)
+	{
+		contexts.emplace_back("loadgen", 256_KiB, [&endpoints, &remote, &client, &deadline]
+		{
+			run_syncer(endpoints, remote, client, deadline);
+		},
+		ctx::context::POST);
+
+		contexts.emplace_back("loadgen", 256_KiB, [&endpoints, &remote, &client, &deadline]
+		{
+			run_client(endpoints, remote, client, deadline);
+		},
+		ctx::context::POST);
+	}
+
+	for(auto &peer : peers)
+		contexts.emplace_back("loadgen", 256_KiB, [&endpoints, &remote, &peer, &deadline]
+		{
+			run_peer(endpoints, remote, peer, deadline);
+		},
+		ctx::context::POST);
+
+	// The generators leave on their own at the deadline; an interruption of
+	// this command terminates them by the destructors on the way out.
+	for(auto &context : contexts)
+		context.join();
+
+	report(out, endpoints, timer.at<seconds>());
+}
+
+void
+ircd::m::loadgen::report(std::ostream &out,
+                         endpoints &endpoints,
+                         const seconds &elapsed)
+{
+	const auto percentile{[]
+	(const std::vector<uint32_t> &samples, const size_t &pct)
+	{
+		const size_t idx
+		{
+			std::min(samples.size() * pct / 100, samples.size() - 1)
+		};
+
+		return samples.empty()? 0.0 : samples.at(idx) / 1000.0;
+	}};
+
+	out << std::setw(12) << std::left << "ENDPOINT"
+	    << " " << std::setw(9) << std::right << "REQUESTS"
+	    << " " << std::setw(7) << std::right << "ERRORS"
+	    << " " << std::setw(9) << std::right << "REQ/S"
+	    << " " << std::setw(9) << std::right << "P50 MS"
+	    << " " << std::setw(9) << std::right << "P90 MS"
+	    << " " << std::setw(9) << std::right << "P99 MS"
+	    << " " << std::setw(9) << std::right << "MAX MS"
+	    << std::endl;
+
+	for(auto &p : endpoints)
+	{
+		const auto &name(p.first);
+		auto &samples(p.second.samples);
+		std::sort(begin(samples), end(samples));
+
+		const double rate
+		{
+			samples.size() / std::max(double(elapsed.count()), 1.0)
+		};
+
+		out << std::setw(12) << std::left << name
+		    << " " << std::setw(9) << std::right << samples.size()
+		    << " " << std::setw(7) << std::right << p.second.errors
+		    << " " << std::setw(9) << std::right << std::fixed << std::setprecision(1) << rate
+		    << " " << std::setw(9) << std::right << percentile(samples, 50)
+		    << " " << std::setw(9) << std::right << percentile(samples, 90)
+		    << " " << std::setw(9) << std::right << percentile(samples, 99)
+		    << " " << std::setw(9) << std::right << percentile(samples, 100)
+		    << std::endl;
+
+		log::info
+		{
+			log, "%s: %zu requests %zu errors %.1lf/s p50:%.2lf p90:%.2lf p99:%.2lf ms",
+			name,
+			samples.size(),
+			p.second.errors,
+			rate,
+			percentile(samples, 50),
+			percentile(samples, 90),
+			percentile(samples, 99),
+		};
+	}
+}
+
+//
+// clients
+//
+
+void
+ircd::m::loadgen::run_client(endpoints &endpoints,
+                             const net::hostport &remote,
+                             client &client,
+                             const steady_point &deadline)
+{
+	char room_id[768], uri[1024];
+	url::encode(room_id, client.room_id);
+
+	const string_view join_uri
+	{
+		fmt::sprintf
+		{
+			uri, "/_matrix/client/r0/rooms/%s/join", string_view{room_id}
+		}
+	};
+
+	call(endpoints["join"], remote, client, "POST", join_uri);
+	for(size_t i(1); now<steady_point>() < deadline; ++i)
+	{
+		const string_view send_uri
+		{
+			fmt::sprintf
+			{
+				uri, "/_matrix/client/r0/rooms/%s/send/m.room.message/loadgen%zu",
+				string_view{room_id},
+				client.txnid++
+			}
+		};
+
+		char body[64];
+		call(endpoints["send"], remote, client, "PUT", send_uri,
+		{
+			{ "msgtype",  "m.text"                                                 },
+			{ "body",     string_view{fmt::sprintf{body, "loadgen message %zu", i}}},
+		});
+
+		if(messages_interval && i % size_t(messages_interval) == 0)
+		{
+			const string_view messages_uri
+			{
+				fmt::sprintf
+				{
+					uri, "/_matrix/client/r0/rooms/%s/messages?dir=b&limit=16",
+					string_view{room_id}
+				}
+			};
+
+			call(endpoints["messages"], remote, client, "GET", messages_uri);
+		}
+
+		if(join_interval && i % size_t(join_interval) == 0)
+			call(endpoints["join"], remote, client, "POST", join_uri);
+
+		ctx::sleep(milliseconds(think_time));
+	}
+}
+
+void
+ircd::m::loadgen::run_syncer(endpoints &endpoints,
+                             const net::hostport &remote,
+                             client &client,
+                             const steady_point &deadline)
+{
+	char uri[256];
+	while(now<steady_point>() < deadline)
+	{
+		// The longpoll is shortened to end near the deadline so the run
+		// doesn't overstay its duration by a whole sync timeout.
+		const auto remaining
+		{
+			duration_cast<milliseconds>(deadline - now<steady_point>())
+		};
+
+		const auto timeout
+		{
+			std::max(std::min(milliseconds(sync_timeout), remaining), 0ms)
+		};
+
+		const string_view sync_uri
+		{
+			!client.since.empty()?
+				fmt::sprintf
+				{
+					uri, "/_matrix/client/r0/sync?timeout=%ld&since=%s",
+					timeout.count(),
+					string_view{client.since}
+				}:
+				fmt::sprintf
+				{
+					uri, "/_matrix/client/r0/sync?timeout=%ld",
+					timeout.count()
+				}
+		};
+
+		const bool ok
+		{
+			call(endpoints[!client.since.empty()? "sync" : "sync.initial"], remote, client, "GET", sync_uri, {}, [&client]
+			(const json::object &response)
+			{
+				client.since = unquote(response.get("next_batch"));
+			})
+		};
+
+		if(!ok)
+			ctx::sleep(milliseconds(think_time));
+	}
+}
+
+bool
+ircd::m::loadgen::call(endpoint &endpoint,
+                       const net::hostport &remote,
+                       const client &client,
+                       const string_view &method,
+                       const string_view &uri,
+                       const json::members &content_,
+                       const closure &closure)
+{
+	const bool has_content
+	{
+		method != "GET"
+	};
+
+	const json::strung content
+	{
+		content_
+	};
+
+	m::request request;
+	json::get<"origin"_>(request) = my_host();
+	json::get<"destination"_>(request) = my_host();
+	json::get<"method"_>(request) = method;
+	json::get<"uri"_>(request) = uri;
+	if(has_content)
+		json::get<"content"_>(request) = json::object{content};
+
+	char authorization[256];
+	const http::header headers[]
+	{
+		{ "Authorization", fmt::sprintf
+		{
+			authorization, "Bearer %s", string_view{client.access_token}
+		}},
+	};
+
+	const unique_buffer<mutable_buffer> buf
+	{
+		16_KiB
+	};
+
+	server::out out;
+	out.head = request(buf, { headers, 1 });
+	out.content = json::get<"content"_>(request);
+
+	// The head buffer is shared with the response head; the response
+	// content is allocated by server::request to fit.
+	server::in in;
+	in.head = buf + size(out.head);
+	return call(endpoint, remote, std::move(out), std::move(in), closure);
+}
+
+void
+ircd::m::loadgen::provision(client &client)
+{
+	if(!exists(client.user_id))
+		m::create(client.user_id);
+
+	if(!exists(client.room_id))
+	{
+		m::create(client.room_id, m::me.user_id);
+		send(client.room_id, m::me.user_id, "m.room.join_rules", "",
+		{
+			{ "join_rule", "public" }
+		});
+	}
+
+	// Issued the same way as a password login would.
+	char access_token[32];
+	client.access_token = m::user::gen_access_token(access_token);
+	m::send(m::user::tokens, client.user_id, "ircd.access_token", client.access_token,
+	{
+		{ "ip",      "127.0.0.1"  },
+		{ "device",  "loadgen"    },
+	});
+}
+
+void
+ircd::m::loadgen::release(client &client)
+noexcept
+{
+	if(client.access_token.empty())
+		return;
+
+	erase(m::user::tokens, "ircd.access_token", client.access_token);
+	client.access_token.clear();
+}
+
+//
+// peers
+//
+
+void
+ircd::m::loadgen::run_peer(endpoints &endpoints,
+                           const net::hostport &remote,
+                           peer &peer,
+                           const steady_point &deadline)
+{
+	std::vector<std::string> pdus;
+	pdus.reserve(std::max(size_t(txn_pdus), 2UL));
+
+	// The peer's room is created and joined by its first transaction.
+	{
+		json::iov event, content;
+		const json::iov::push push[]
+		{
+			{ event,    { "type",        "m.room.create"  }},
+			{ event,    { "state_key",   ""               }},
+			{ content,  { "creator",     peer.user_id     }},
+		};
+
+		pdus.emplace_back(make_pdu(peer, event, content));
+		peer.create_id = peer.head;
+	}
+
+	{
+		json::iov event, content;
+		const json::iov::push push[]
+		{
+			{ event,    { "type",        "m.room.member"  }},
+			{ event,    { "state_key",   peer.user_id     }},
+			{ event,    { "membership",  "join"           }},
+			{ content,  { "membership",  "join"           }},
+		};
+
+		pdus.emplace_back(make_pdu(peer, event, content));
+		peer.member_id = peer.head;
+	}
+
+	call(endpoints["fed.send"], remote, peer, pdus);
+	for(size_t i(0); now<steady_point>() < deadline;)
+	{
+		pdus.clear();
+		for(size_t j(0); j < std::max(size_t(txn_pdus), 1UL); ++j, ++i)
+		{
+			char body[64];
+			json::iov event, content;
+			const json::iov::push push[]
+			{
+				{ event,    { "type",     "m.room.message"                                  }},
+				{ content,  { "msgtype",  "m.text"                                          }},
+				{ content,  { "body",     string_view{fmt::sprintf{body, "loadgen pdu %zu", i}}}},
+			};
+
+			pdus.emplace_back(make_pdu(peer, event, content));
+		}
+
+		call(endpoints["fed.send"], remote, peer, pdus);
+		ctx::sleep(milliseconds(think_time));
+	}
+}
+
+/// Composes a PDU in the peer's room following the peer's last event; the
+/// id, hashes and signature are produced the same way vm::eval__commit does
+/// for our own events, but with the peer's origin and key.
+std::string
+ircd::m::loadgen::make_pdu(peer &peer,
+                           json::iov &event,
+                           const json::iov &contents)
+{
+	char prev_buf[512];
+	const json::array prev_events
+	{
+		peer.head?
+			string_view{fmt::sprintf{prev_buf, "[[\"%s\",{}]]", string_view{peer.head}}}:
+			json::empty_array
+	};
+
+	char auth_buf[1024];
+	const json::array auth_events
+	{
+		peer.member_id?
+			string_view{fmt::sprintf
+			{
+				auth_buf, "[[\"%s\",{}],[\"%s\",{}]]",
+				string_view{peer.create_id},
+				string_view{peer.member_id}
+			}}:
+		peer.create_id?
+			string_view{fmt::sprintf{auth_buf, "[[\"%s\",{}]]", string_view{peer.create_id}}}:
+			json::empty_array
+	};
+
+	const json::iov::push push[]
+	{
+		{ event,    { "origin",            string_view{peer.origin}  }},
+		{ event,    { "origin_server_ts",  time<milliseconds>()      }},
+		{ event,    { "room_id",           peer.room_id              }},
+		{ event,    { "sender",            peer.user_id              }},
+		{ event,    { "depth",             ++peer.depth              }},
+		{ event,    { "prev_events",       prev_events               }},
+		{ event,    { "auth_events",       auth_events               }},
+		{ event,    { "prev_state",        json::empty_array         }},
+	};
+
+	const json::strung content
+	{
+		contents
+	};
+
+	sha256::buf event_id_hash;
+	{
+		const json::iov::push _content
+		{
+			event, { "content", content },
+		};
+
+		thread_local char preimage_buf[64_KiB];
+		event_id_hash = sha256
+		{
+			stringify(mutable_buffer{preimage_buf}, event)
+		};
+	}
+
+	char readable[b58encode_size(sha256::digest_size)];
+	const m::event::id event_id
+	{
+		peer.head, b58encode(readable, event_id_hash), peer.origin
+	};
+
+	peer.head.assigned(event_id);
+	const json::iov::push _event_id
+	{
+		event, { "event_id", event_id }
+	};
+
+	char hashes_buf[128];
+	const json::iov::push _hashes
+	{
+		event, { "hashes", m::event::hashes(hashes_buf, event, content) }
+	};
+
+	const ed25519::sig sig
+	{
+		m::event::sign(event, contents, peer.sk)
+	};
+
+	char sigb64[b64encode_size(sizeof(sig))], sigs_buf[384];
+	const json::members sigs
+	{
+		{ peer.origin, json::members
+		{
+			{ peer.key_id, b64encode_unpadded(sigb64, sig) }
+		}}
+	};
+
+	const json::iov::push _signatures
+	{
+		event, { "signatures", json::stringify(mutable_buffer{sigs_buf}, sigs) }
+	};
+
+	const json::iov::push _content
+	{
+		event, { "content", content },
+	};
+
+	return json::strung
+	{
+		event
+	};
+}
+
+bool
+ircd::m::loadgen::call(endpoint &endpoint,
+                       const net::hostport &remote,
+                       peer &peer,
+                       const vector_view<const std::string> &pdus_)
+{
+	std::vector<json::value> pdus;
+	pdus.reserve(pdus_.size());
+	for(const auto &pdu : pdus_)
+		pdus.emplace_back(json::object{pdu});
+
+	const json::strung content{json::members
+	{
+		{ "origin",            string_view{peer.origin}            },
+		{ "origin_server_ts",  time<milliseconds>()                },
+		{ "pdus",              { pdus.data(), pdus.size() }        },
+	}};
+
+	char txnid[64], uri[256];
+	m::request request
+	{
+		peer.origin, my_host(), "PUT", fmt::sprintf
+		{
+			uri, "/_matrix/federation/v1/send/%s/",
+			string_view{fmt::sprintf{txnid, "loadgen%zu", peer.txnid++}}
+		},
+		json::object{content}
+	};
+
+	// m::request() signs with our own key; the peer's X-Matrix header is
+	// generated here with the peer's key instead.
+	char authorization[1024];
+	const http::header headers[]
+	{
+		{ "Authorization", request.generate(authorization, peer.sk, peer.key_id) },
+		{ "User-Agent", info::user_agent },
+	};
+
+	const unique_buffer<mutable_buffer> buf
+	{
+		16_KiB
+	};
+
+	window_buffer sb{buf};
+	http::request
+	{
+		sb,
+		my_host(),
+		"PUT",
+		at<"uri"_>(request),
+		size(string_view(content)),
+		"application/json; charset=utf-8",
+		{ headers, 2 }
+	};
+
+	server::out out;
+	out.head = sb.completed();
+	out.content = string_view(content);
+
+	server::in in;
+	in.head = buf + size(out.head);
+	return call(endpoint, remote, std::move(out), std::move(in));
+}
+
+void
+ircd::m::loadgen::provision(peer &peer,
+                           const seconds &duration)
+{
+	using cache_set_prototype = size_t (const json::object &);
+	static mods::import<cache_set_prototype> cache_set
+	{
+		"s_keys", "cache_set"
+	};
+
+	// A fresh key under a fresh key_id each run; nothing about it can be
+	// derived from the origin, and a key cached by an earlier run is never
+	// presented again.
+	uint32_t seed[8];
+	static_assert(sizeof(seed) >= ed25519::SEED_SZ);
+	std::generate(std::begin(seed), std::end(seed), std::ref(rand::device));
+	peer.sk = ed25519::sk
+	{
+		&peer.pk, const_buffer{reinterpret_cast<const char *>(seed), sizeof(seed)}
+	};
+
+	char key_id[16];
+	peer.key_id = fmt::snstringf
+	{
+		64, "ed25519:%s", rand::string(rand::dict::alnum, key_id)
+	};
+
+	peer.user_id = m::user::id::buf
+	{
+		"loadgen", peer.origin
+	};
+
+	peer.room_id = m::room::id::buf
+	{
+		"loadgen", peer.origin
+	};
+
+	char pkb64[b64encode_size(sizeof(peer.pk))];
+	const json::members verify_keys_
+	{{
+		string_view{peer.key_id},
+		{
+			{ "key", b64encode_unpadded(pkb64, peer.pk) }
+		}
+	}};
+
+	m::keys keys;
+	json::get<"server_name"_>(keys) = peer.origin;
+	json::get<"old_verify_keys"_>(keys) = "{}";
+	json::get<"tls_fingerprints"_>(keys) = "[]";
+	json::get<"valid_until_ts"_>(keys) = ircd::time<milliseconds>() + duration_cast<milliseconds>(duration + minutes(5)).count();
+
+	const json::strung verify_keys{verify_keys_}; // must be on stack until keys serialized.
+	json::get<"verify_keys"_>(keys) = verify_keys;
+
+	const json::strung presig
+	{
+		keys
+	};
+
+	const ed25519::sig sig
+	{
+		peer.sk.sign(const_buffer{presig})
+	};
+
+	char signature[256];
+	const json::strung signatures{json::members
+	{
+		{ peer.origin,
+		{
+			{ string_view{peer.key_id}, b64encode_unpadded(signature, sig) }
+		}}
+	}};
+
+	json::get<"signatures"_>(keys) = signatures;
+	cache_set(json::strung{keys});
+}
+
+void
+ircd::m::loadgen::release(peer &peer)
+noexcept
+{
+	if(peer.key_id.empty())
+		return;
+
+	const m::node::id::buf node_id
+	{
+		m::node::id::origin, peer.origin
+	};
+
+	erase(m::node::room{node_id}, "ircd.key", peer.key_id);
+	peer.key_id.clear();
+}
+
+//
+// util
+//
+
+/// Erases the current state event outright. A redaction would leave the
+/// state cell behind, and with it a usable token or key.
+void
+ircd::m::loadgen::erase(const m::room &room,
+                        const string_view &type,
+                        const string_view &state_key)
+noexcept try
+{
+	const m::event::id::buf event_id
+	{
+		m::room::state{room}.get(std::nothrow, type, state_key)
+	};
+
+	if(!event_id)
+		return;
+
+	const m::event::fetch event
+	{
+		event_id
+	};
+
+	db::txn txn
+	{
+		*m::dbs::events
+	};
+
+	m::dbs::write_opts opts;
+	opts.op = db::op::DELETE;
+	opts.event_idx = index(event);
+	m::dbs::write(txn, event, opts);
+	txn();
+}
+catch(const std::exception &e)
+{
+	log::error
+	{
+		log, "Failed to erase %s in %s: %s",
+		type,
+		string_view{room.room_id},
+		e.what()
+	};
+}
+
+/// Submits the request and records its latency for the endpoint. Failures
+/// (including any non-2xx status) are counted as errors and not sampled.
+bool
+ircd::m::loadgen::call(endpoint &endpoint,
+                       const net::hostport &remote,
+                       server::out out,
+                       server::in in,
+                       const closure &closure)
+try
+{
+	const ircd::timer timer;
+	server::request request
+	{
+		remote, std::move(out), std::move(in)
+	};
+
+	request.wait(milliseconds(request_timeout));
+	request.get();
+	endpoint.samples.emplace_back(timer.at<microseconds>().count());
+	if(closure)
+		closure(json::object{request.in.content});
+
+	return true;
+}
+catch(const ctx::interrupted &)
+{
+	throw;
+}
+catch(const std::exception &e)
+{
+	++endpoint.errors;
+	log::derror
+	{
+		log, "%s", e.what()
+	};
+
+	return false;
+}
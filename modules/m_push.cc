@@ -0,0 +1,705 @@
+// Matrix Construct
+//
+// Copyright (C) Matrix Construct Developers, Authors & Contributors
+// Copyright (C) 2016-2018 Jason Volk <jason@zemos.net>
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice is present in all copies. The
+// full license for this software is available in the LICENSE file.
+
+using namespace ircd;
+
+mapi::header
+IRCD_MODULE
+{
+	"Matrix push rule evaluation"
+};
+
+/// Push rule evaluation for the local members of a room.
+///
+/// The content rules of every local joined member of a room (the default
+/// .m.rule.contains_user_name, .m.rule.contains_display_name and the
+/// user_id itself) along with .m.rule.roomnotif are compiled into one
+/// Aho-Corasick automaton per room. Each message is scanned once, and the
+/// cost is linear in the size of its body rather than in the number of
+/// members times their rules. Matches are resolved to the users whose rules
+/// produced them after the condition checks (word boundaries; the sender's
+/// power for @room; a user is never highlighted by themself).
+///
+/// Highlights are recorded as event_idx's per (room, user) so the sync
+/// counts are a pair of binary searches. The record only covers events
+/// evaluated since this module was loaded, and it is dropped whenever it
+/// reaches ircd.m.push.highlights.max entries; ranges starting before the
+/// record fall back to scanning in m_user. A room's rules are recompiled on
+/// the next message after any m.room.member or m.room.power_levels event in
+/// that room.
+///
+/// Notification counts are not kept here; under the default underride rules
+/// they're the count of messages since the read marker which sync computes
+/// per user. `notified` is only an aggregate statistic.
+///
+/// The fallback scan in m_user matches each event with push__highlighted(),
+/// i.e. the same compiled rules, so both counts agree.
+///
+namespace ircd::m::push
+{
+	struct automaton;
+	struct rules;
+	struct entry;
+
+	extern conf::item<bool> enable;
+	extern conf::item<size_t> highlights_max;
+	extern log::log log;
+
+	extern std::map<std::string, entry, std::less<>> compiled;
+	extern std::map<std::string, std::vector<event::idx>, std::less<>> highlights;
+	extern size_t highlights_count;
+	extern event::idx since, last;
+	extern uint64_t evaluated, highlighted, notified, compiles, discarded;
+
+	static std::string key(const room::id &, const user::id &);
+	static std::shared_ptr<const rules> get(const room::id &);
+	static void evaluate(const event &, vm::eval &);
+	static void invalidate(const event &, vm::eval &);
+
+	extern "C" bool push__highlighted(const event &, const user &);
+	extern "C" bool push__highlight_count(const user &, const room &, const event::idx &, const event::idx &, size_t &);
+	extern "C" void push__stats(std::ostream &);
+}
+
+/// Case-insensitive (ASCII) Aho-Corasick automaton. Patterns are added and
+/// then compile() builds the failure and dictionary links breadth first.
+/// The transitions of a node are kept in a small sorted vector since the
+/// alphabet of names is sparse at every depth but the root.
+struct ircd::m::push::automaton
+{
+	static constexpr const uint32_t npos
+	{
+		std::numeric_limits<uint32_t>::max()
+	};
+
+	struct node
+	{
+		std::vector<std::pair<char, uint32_t>> next;
+		uint32_t fail {0};
+		uint32_t out {npos};             // pattern ending here
+		uint32_t dict {npos};            // nearest suffix node with an output
+	};
+
+	std::vector<node> nodes {1};
+	std::vector<uint32_t> lens;
+
+	uint32_t child(const uint32_t &, const char &) const;
+	uint32_t step(uint32_t, const char &) const;
+
+  public:
+	template<class closure> void scan(const string_view &, closure&&) const;
+
+	uint32_t add(const string_view &);
+	void compile();
+};
+
+/// A room's slot in the cache. The generation is bumped by every
+/// invalidation so a compile which yielded across one is not cached.
+struct ircd::m::push::entry
+{
+	std::shared_ptr<rules> ptr;
+	uint64_t generation {0};
+};
+
+/// The compiled rules of the local members of one room.
+struct ircd::m::push::rules
+{
+	struct target
+	{
+		uint32_t user;
+		bool word;
+	};
+
+	static constexpr const uint32_t everyone
+	{
+		automaton::npos
+	};
+
+	automaton ac;
+	std::vector<user::id::buf> users;
+	std::map<std::string, uint32_t, std::less<>> patterns;
+	std::vector<std::vector<target>> targets;
+	int64_t room_notif_level {50};
+
+	void add(const string_view &pattern, const uint32_t &user, const bool &word);
+
+  public:
+	void highlights(const event &, std::vector<uint32_t> &out) const;
+	bool has_user(const user::id &) const;
+
+	rules(const room::id &);
+};
+
+decltype(ircd::m::push::enable)
+ircd::m::push::enable
+{
+	{ "name",     "ircd.m.push.enable" },
+	{ "default",  true                 },
+};
+
+/// Total event_idx's recorded across all highlight lists before the record
+/// is dropped and restarted.
+decltype(ircd::m::push::highlights_max)
+ircd::m::push::highlights_max
+{
+	{ "name",     "ircd.m.push.highlights.max" },
+	{ "default",  1048576L                     },
+};
+
+decltype(ircd::m::push::log)
+ircd::m::push::log
+{
+	"m.push"
+};
+
+decltype(ircd::m::push::compiled)
+ircd::m::push::compiled;
+
+decltype(ircd::m::push::highlights)
+ircd::m::push::highlights;
+
+decltype(ircd::m::push::highlights_count)
+ircd::m::push::highlights_count;
+
+decltype(ircd::m::push::since)
+ircd::m::push::since;
+
+decltype(ircd::m::push::last)
+ircd::m::push::last;
+
+decltype(ircd::m::push::evaluated)
+ircd::m::push::evaluated;
+
+decltype(ircd::m::push::highlighted)
+ircd::m::push::highlighted;
+
+decltype(ircd::m::push::notified)
+ircd::m::push::notified;
+
+decltype(ircd::m::push::compiles)
+ircd::m::push::compiles;
+
+decltype(ircd::m::push::discarded)
+ircd::m::push::discarded;
+
+const m::hookfn<m::vm::eval &>
+_push_evaluate
+{
+	m::push::evaluate,
+	{
+		{ "_site",    "vm.effect"       },
+		{ "type",     "m.room.message"  },
+	}
+};
+
+const m::hookfn<m::vm::eval &>
+_push_invalidate
+{
+	m::push::invalidate,
+	{
+		{ "_site",    "vm.effect"       },
+		{ "type",     "m.room.member"   },
+	}
+};
+
+const m::hookfn<m::vm::eval &>
+_push_invalidate_power
+{
+	m::push::invalidate,
+	{
+		{ "_site",    "vm.effect"             },
+		{ "type",     "m.room.power_levels"   },
+	}
+};
+
+void
+ircd::m::push::evaluate(const event &event,
+                        vm::eval &eval)
+{
+	if(!bool(enable))
+		return;
+
+	const auto &room_id
+	{
+		at<"room_id"_>(event)
+	};
+
+	const event::idx &event_idx
+	{
+		eval.sequence
+	};
+
+	if(!since)
+		since = event_idx;
+
+	// The record is restarted after the last event it could have covered;
+	// evals still in flight below that are left to the fallback scan.
+	if(highlights_count >= size_t(highlights_max))
+	{
+		log::dwarning
+		{
+			log, "Dropping %zu highlights of %zu lists; restarting after %lu",
+			highlights_count,
+			highlights.size(),
+			last
+		};
+
+		highlights.clear();
+		highlights_count = 0;
+		since = last + 1;
+	}
+
+	last = std::max(last, event_idx);
+
+	// Held by reference count since the rules can be invalidated by a
+	// member event while this context yields for the power levels.
+	const auto rules
+	{
+		get(room_id)
+	};
+
+	std::vector<uint32_t> hits;
+	rules->highlights(event, hits);
+	for(const auto &user : hits)
+	{
+		auto &list
+		{
+			highlights[key(room_id, rules->users.at(user))]
+		};
+
+		// Concurrent evals can finish their scans out of order.
+		list.emplace(std::upper_bound(begin(list), end(list), event_idx), event_idx);
+		++highlights_count;
+		++highlighted;
+	}
+
+	// Under the default underride rules every member but the sender is
+	// notified of a message.
+	notified += rules->users.size() - rules->has_user(at<"sender"_>(event));
+	++evaluated;
+}
+
+void
+ircd::m::push::invalidate(const event &event,
+                          vm::eval &eval)
+{
+	const auto it
+	{
+		compiled.find(at<"room_id"_>(event))
+	};
+
+	if(it == end(compiled))
+		return;
+
+	auto &entry(it->second);
+	entry.ptr.reset();
+	++entry.generation;
+}
+
+/// Entries are never erased, so the reference held across the compile
+/// remains valid.
+std::shared_ptr<const ircd::m::push::rules>
+ircd::m::push::get(const room::id &room_id)
+{
+	auto it
+	{
+		compiled.lower_bound(room_id)
+	};
+
+	if(it == end(compiled) || it->first != room_id)
+		it = compiled.emplace_hint(it, std::string{room_id}, entry{});
+
+	auto &entry(it->second);
+	if(entry.ptr)
+		return entry.ptr;
+
+	// Compiling yields for the member states. The result is still used for
+	// this event if the room was invalidated meanwhile, but it isn't cached.
+	const auto generation(entry.generation);
+	auto ret
+	{
+		std::make_shared<rules>(room_id)
+	};
+
+	++compiles;
+	if(entry.generation != generation)
+	{
+		++discarded;
+		return ret;
+	}
+
+	entry.ptr = ret;
+	return ret;
+}
+
+std::string
+ircd::m::push::key(const room::id &room_id,
+                   const user::id &user_id)
+{
+	std::string ret;
+	ret.reserve(size(room_id) + 1 + size(user_id));
+	ret.append(data(room_id), size(room_id));
+	ret.push_back(' ');
+	ret.append(data(user_id), size(user_id));
+	return ret;
+}
+
+bool
+ircd::m::push::push__highlighted(const event &event,
+                                 const user &user)
+{
+	if(json::get<"type"_>(event) != "m.room.message")
+		return false;
+
+	const auto rules
+	{
+		get(at<"room_id"_>(event))
+	};
+
+	std::vector<uint32_t> hits;
+	rules->highlights(event, hits);
+	return std::any_of(begin(hits), end(hits), [&rules, &user]
+	(const uint32_t &i)
+	{
+		return rules->users.at(i) == user.user_id;
+	});
+}
+
+bool
+ircd::m::push::push__highlight_count(const user &user,
+                                     const room &room,
+                                     const event::idx &a,
+                                     const event::idx &b,
+                                     size_t &ret)
+{
+	if(!bool(enable) || !since || a + 1 < since)
+		return false;
+
+	const auto it
+	{
+		highlights.find(key(room.room_id, user.user_id))
+	};
+
+	if(it == end(highlights))
+	{
+		ret = 0;
+		return true;
+	}
+
+	// Counted over (a, b] as with the scan.
+	const auto &list(it->second);
+	ret = std::distance(std::upper_bound(begin(list), end(list), a),
+	                    std::upper_bound(begin(list), end(list), b));
+	return true;
+}
+
+void
+ircd::m::push::push__stats(std::ostream &out)
+{
+	out << "since:        " << since << std::endl
+	    << "evaluated:    " << evaluated << std::endl
+	    << "highlighted:  " << highlighted << std::endl
+	    << "notified:     " << notified << std::endl
+	    << "rooms:        " << compiled.size() << std::endl
+	    << "compiles:     " << compiles << std::endl
+	    << "discarded:    " << discarded << std::endl
+	    << "lists:        " << highlights.size() << std::endl
+	    << "entries:      " << highlights_count << std::endl;
+}
+
+//
+// rules
+//
+
+ircd::m::push::rules::rules(const room::id &room_id)
+{
+	const m::room room
+	{
+		room_id
+	};
+
+	const m::room::members members
+	{
+		room
+	};
+
+	members.for_each("join", event::closure{[this]
+	(const event &event)
+	{
+		const user::id &user_id
+		{
+			at<"state_key"_>(event)
+		};
+
+		if(!my(user_id))
+			return;
+
+		const uint32_t user(users.size());
+		users.emplace_back(user_id);
+
+		const json::object &content
+		{
+			json::get<"content"_>(event)
+		};
+
+		const string_view &displayname
+		{
+			unquote(content.get("displayname"))
+		};
+
+		add(user_id, user, false);
+		add(user_id.localname(), user, true);
+		if(!empty(displayname))
+			add(displayname, user, true);
+	}});
+
+	add("@room", everyone, true);
+
+	const m::room::power power
+	{
+		room
+	};
+
+	power.view([this](const json::object &content)
+	{
+		const json::object &notifications
+		{
+			content.get("notifications")
+		};
+
+		room_notif_level = notifications.get<int64_t>("room", room_notif_level);
+	});
+
+	ac.compile();
+	log::debug
+	{
+		log, "Compiled push rules of %zu local members in %s; %zu patterns %zu nodes",
+		users.size(),
+		string_view{room_id},
+		patterns.size(),
+		ac.nodes.size()
+	};
+}
+
+void
+ircd::m::push::rules::add(const string_view &pattern,
+                          const uint32_t &user,
+                          const bool &word)
+{
+	// The automaton matches without case, so patterns differing only in
+	// case are one pattern with the targets of both.
+	std::string key(size(pattern), char{});
+	std::transform(begin(pattern), end(pattern), begin(key), []
+	(const char &c)
+	{
+		return tolower(uint8_t(c));
+	});
+
+	auto it
+	{
+		patterns.lower_bound(key)
+	};
+
+	if(it == end(patterns) || it->first != key)
+	{
+		it = patterns.emplace_hint(it, std::move(key), ac.add(pattern));
+		targets.resize(ac.lens.size());
+	}
+
+	targets.at(it->second).emplace_back(target{user, word});
+}
+
+bool
+ircd::m::push::rules::has_user(const user::id &user_id)
+const
+{
+	return std::any_of(begin(users), end(users), [&user_id]
+	(const auto &user)
+	{
+		return user == user_id;
+	});
+}
+
+void
+ircd::m::push::rules::highlights(const event &event,
+                                 std::vector<uint32_t> &out)
+const
+{
+	const json::object &content
+	{
+		json::get<"content"_>(event)
+	};
+
+	const auto &sender
+	{
+		json::get<"sender"_>(event)
+	};
+
+	bool room_notif(false);
+	const auto matched{[this, &out, &room_notif]
+	(const string_view &text, const uint32_t &pattern, const size_t &end)
+	{
+		const size_t &len(ac.lens.at(pattern));
+		const size_t start(end - len);
+		const bool word
+		{
+			(start == 0 || !isalnum(uint8_t(text[start - 1]))) &&
+			(end == size(text) || !isalnum(uint8_t(text[end])))
+		};
+
+		for(const auto &target : targets.at(pattern))
+		{
+			if(target.word && !word)
+				continue;
+
+			if(target.user == everyone)
+				room_notif = true;
+			else
+				out.emplace_back(target.user);
+		}
+	}};
+
+	for(const auto &text : {content.get("body"), content.get("formatted_body")})
+	{
+		const string_view &body
+		{
+			unquote(text)
+		};
+
+		ac.scan(body, [&matched, &body]
+		(const uint32_t &pattern, const size_t &end)
+		{
+			matched(body, pattern, end);
+		});
+	}
+
+	if(room_notif)
+	{
+		const m::room::power power
+		{
+			m::room{at<"room_id"_>(event)}
+		};
+
+		if(power.level_user(sender) >= room_notif_level)
+			for(uint32_t i(0); i < users.size(); ++i)
+				out.emplace_back(i);
+	}
+
+	std::sort(begin(out), end(out));
+	out.erase(std::unique(begin(out), end(out)), end(out));
+	out.erase(std::remove_if(begin(out), end(out), [this, &sender]
+	(const uint32_t &user)
+	{
+		return users.at(user) == sender;
+	}), end(out));
+}
+
+//
+// automaton
+//
+
+uint32_t
+ircd::m::push::automaton::add(const string_view &pattern)
+{
+	uint32_t cur(0);
+	for(const char &c : pattern)
+	{
+		const char lc(tolower(uint8_t(c)));
+		uint32_t next(child(cur, lc));
+		if(next == npos)
+		{
+			next = nodes.size();
+			auto &edges(nodes.at(cur).next);
+			edges.emplace(std::lower_bound(begin(edges), end(edges), std::make_pair(lc, 0U)), lc, next);
+			nodes.emplace_back();
+		}
+
+		cur = next;
+	}
+
+	const uint32_t id(lens.size());
+	assert(nodes.at(cur).out == npos);
+	nodes.at(cur).out = id;
+	lens.emplace_back(size(pattern));
+	return id;
+}
+
+void
+ircd::m::push::automaton::compile()
+{
+	std::deque<uint32_t> queue;
+	for(const auto &edge : nodes.at(0).next)
+	{
+		nodes.at(edge.second).fail = 0;
+		queue.emplace_back(edge.second);
+	}
+
+	while(!queue.empty())
+	{
+		const uint32_t cur(queue.front());
+		queue.pop_front();
+		for(const auto &edge : nodes.at(cur).next)
+		{
+			const auto &[c, next] {edge};
+			const uint32_t fail(step(nodes.at(cur).fail, c));
+			auto &node(nodes.at(next));
+			node.fail = fail;
+			node.dict = nodes.at(fail).out != npos? fail : nodes.at(fail).dict;
+			queue.emplace_back(next);
+		}
+	}
+}
+
+/// The closure is called with the pattern id and the offset one past the end
+/// of the match for every occurrence of every pattern.
+template<class closure>
+void
+ircd::m::push::automaton::scan(const string_view &text,
+                               closure&& matched)
+const
+{
+	uint32_t cur(0);
+	for(size_t i(0); i < size(text); ++i)
+	{
+		cur = step(cur, tolower(uint8_t(text[i])));
+		for(uint32_t n(nodes[cur].out != npos? cur : nodes[cur].dict); n != npos; n = nodes[n].dict)
+			matched(nodes[n].out, i + 1);
+	}
+}
+
+uint32_t
+ircd::m::push::automaton::step(uint32_t cur,
+                               const char &c)
+const
+{
+	for(;; cur = nodes[cur].fail)
+	{
+		const uint32_t next(child(cur, c));
+		if(next != npos)
+			return next;
+
+		if(cur == 0)
+			return 0;
+	}
+}
+
+uint32_t
+ircd::m::push::automaton::child(const uint32_t &cur,
+                                const char &c)
+const
+{
+	const auto &edges(nodes[cur].next);
+	const auto it
+	{
+		std::lower_bound(begin(edges), end(edges), std::make_pair(c, 0U))
+	};
+
+	return it != end(edges) && it->first == c? it->second : npos;
+}
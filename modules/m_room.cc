@@ -316,6 +316,11 @@ state__force_present(const m::event &event)
 		*m::dbs::events
 	};
 
+	const unwind release{[&txn]
+	{
+		m::dbs::id_release(txn);
+	}};
+
 	if(!defined(json::get<"state_key"_>(event)))
 		throw error
 		{
@@ -369,6 +374,11 @@ state__rebuild_present(const m::room &room)
 		*m::dbs::events
 	};
 
+	const unwind release{[&txn]
+	{
+		m::dbs::id_release(txn);
+	}};
+
 	for(; it; ++it)
 	{
 		const m::event &event{*it};
@@ -423,6 +433,11 @@ state__rebuild_history(const m::room &room)
 		*m::dbs::events
 	};
 
+	const unwind release{[&txn]
+	{
+		m::dbs::id_release(txn);
+	}};
+
 	uint r(0);
 	char root[2][64] {0};
 	m::dbs::write_opts opts;
@@ -487,9 +502,15 @@ state__clear_history(const m::room &room)
 		*m::dbs::events
 	};
 
+	const uint64_t room_idx
+	{
+		m::dbs::id_index(room.room_id)
+	};
+
+	char room_key[m::dbs::ROOM_KEY_SIZE];
 	auto it
 	{
-		m::dbs::room_events.begin(room.room_id, gopts)
+		m::dbs::room_events.begin(m::dbs::room_key(room_key, room_idx), gopts)
 	};
 
 	size_t ret{0};
@@ -505,7 +526,7 @@ state__clear_history(const m::room &room)
 		thread_local char buf[m::dbs::ROOM_EVENTS_KEY_MAX_SIZE];
 		const string_view key
 		{
-			m::dbs::room_events_key(buf, room.room_id, depth, event_idx)
+			m::dbs::room_events_key(buf, room_idx, depth, event_idx)
 		};
 
 		db::txn::append
@@ -590,6 +611,11 @@ head__rebuild(const m::room &room)
 		*m::dbs::events
 	};
 
+	const unwind release{[&txn]
+	{
+		m::dbs::id_release(txn);
+	}};
+
 	m::dbs::write_opts opts;
 	opts.op = db::op::SET;
 	opts.head = true;
@@ -629,6 +655,11 @@ head__reset(const m::room &room)
 		*m::dbs::events
 	};
 
+	const unwind release{[&txn]
+	{
+		m::dbs::id_release(txn);
+	}};
+
 	// Iterate all of the existing heads with a delete operation
 	m::dbs::write_opts opts;
 	opts.op = db::op::DELETE;
@@ -684,6 +715,11 @@ head__modify(const m::event::id &event_id,
 		*m::dbs::events
 	};
 
+	const unwind release{[&txn]
+	{
+		m::dbs::id_release(txn);
+	}};
+
 	// Iterate all of the existing heads with a delete operation
 	m::dbs::write_opts opts;
 	opts.op = op;
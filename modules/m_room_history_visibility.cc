@@ -16,12 +16,59 @@ IRCD_MODULE
 	"Matrix m.room.history_visibility"
 };
 
-static bool
+/// Visibility at an event is decided by the state at that event: the room's
+/// history_visibility and the user's membership. Both are state tree lookups,
+/// and pages of /messages, /context and /backfill make them for every event.
+/// The state tree is content-addressed, so a root is immutable and all the
+/// events between two state changes share the same root. The part of the
+/// verdict decided by the state at a root is cached here per (root, mxid);
+/// a page then costs one root lookup per event and tree walks only at state
+/// boundaries. Nothing needs invalidating when state changes since the new
+/// state has a new root. The parts which depend on the present state (the
+/// present membership for "shared"; the origins for servers) are evaluated
+/// live on each call.
+namespace visibility
+{
+	enum verdict :uint8_t;
+
+	extern conf::item<size_t> cache_max;
+	extern std::map<std::string, verdict, std::less<>> cache;
+	extern uint64_t hits, misses;
+}
+
+enum visibility::verdict
+:uint8_t
+{
+	DENY,
+	ALLOW,
+	PRESENT_JOIN,     // allowed if joined to the room at present
+	ORIGIN,           // allowed if the server is in the room
+};
+
+decltype(visibility::cache_max)
+visibility::cache_max
+{
+	{ "name",     "ircd.m.room.history_visibility.cache.max" },
+	{ "default",  16384L                                     },
+};
+
+decltype(visibility::cache)
+visibility::cache;
+
+decltype(visibility::hits)
+visibility::hits;
+
+decltype(visibility::misses)
+visibility::misses;
+
+static visibility::verdict
 _visible_(const m::event &event,
           const m::user::id &user_id,
           const m::room &room,
           const string_view &history_visibility)
 {
+	using namespace visibility;
+
 	char membership_buf[32];
 	const string_view membership
 	{
@@ -29,52 +76,41 @@ _visible_(const m::event &event,
 	};
 
 	if(membership == "join")
-		return true;
+		return ALLOW;
 
 	if(history_visibility == "joined")
-		return false;
+		return DENY;
 
 	if(history_visibility == "invited")
-		return membership == "invite";
+		return membership == "invite"? ALLOW : DENY;
 
 	assert(history_visibility == "shared");
 
 	// If the room is not at the present event then we have to run another
 	// test for membership here. Otherwise the "join" test already failed.
-	if(room.event_id)
-	{
-		const m::room present{room.room_id};
-		return present.membership(user_id, "join");
-	}
-
-	return false;
+	return room.event_id? PRESENT_JOIN : DENY;
 }
 
-static bool
+static visibility::verdict
 _visible_(const m::event &event,
           const m::node::id &node_id,
           const m::room &room,
           const string_view &history_visibility)
 {
-	const m::room::origins origins
-	{
-		room
-	};
-
-	return origins.has(node_id.host());
+	return visibility::ORIGIN;
 }
 
-static bool
+static visibility::verdict
 _visible(const m::event &event,
          const string_view &mxid,
          const m::room &room,
          const string_view &history_visibility)
 {
 	if(history_visibility == "world_readable")
-		return true;
+		return visibility::ALLOW;
 
 	if(empty(mxid))
-		return false;
+		return visibility::DENY;
 
 	switch(m::sigil(mxid))
 	{
@@ -92,26 +128,13 @@ _visible(const m::event &event,
 	}
 }
 
-extern "C" bool
-visible(const m::event &event,
-        const string_view &mxid)
+static visibility::verdict
+_visible(const m::event &event,
+         const string_view &mxid,
+         const m::room &room,
+         const m::room::state &state)
 {
-	const m::room room
-	{
-		at<"room_id"_>(event), json::get<"event_id"_>(event)
-	};
-
-	static const m::event::fetch::opts fopts
-	{
-		m::event::keys::include{"content"}
-	};
-
-	const m::room::state state
-	{
-		room, &fopts
-	};
-
-	bool ret{false};
+	auto ret{visibility::DENY};
 	const bool has_state_event
 	{
 		state.get(std::nothrow, "m.room.history_visibility", "", [&]
@@ -136,6 +159,104 @@ visible(const m::event &event,
 		ret;
 }
 
+/// The verdict from the state at the event, through the cache when the
+/// event has a state root (i.e. it is not a query of the present state).
+static visibility::verdict
+_verdict(const m::event &event,
+         const string_view &mxid,
+         const m::room &room)
+{
+	using namespace visibility;
+
+	static const m::event::fetch::opts fopts
+	{
+		m::event::keys::include{"content"}
+	};
+
+	const m::room::state state
+	{
+		room, &fopts
+	};
+
+	if(!state.root_id || !size_t(cache_max))
+		return _visible(event, mxid, room, state);
+
+	thread_local char keybuf[512];
+	const string_view key
+	{
+		fmt::sprintf
+		{
+			keybuf, "%s %s", string_view{state.root_id}, mxid
+		}
+	};
+
+	const auto it(cache.find(key));
+	if(it != end(cache))
+	{
+		++hits;
+		return it->second;
+	}
+
+	++misses;
+	const auto ret
+	{
+		_visible(event, mxid, room, state)
+	};
+
+	// The entries are small and most pages only touch a few roots, so the
+	// cache is simply dropped when it fills rather than tracking recency.
+	if(cache.size() >= size_t(cache_max))
+		cache.clear();
+
+	cache.emplace(std::string{key}, ret);
+	return ret;
+}
+
+extern "C" bool
+visible(const m::event &event,
+        const string_view &mxid)
+{
+	const m::room room
+	{
+		at<"room_id"_>(event), json::get<"event_id"_>(event)
+	};
+
+	switch(_verdict(event, mxid, room))
+	{
+		case visibility::ALLOW:
+			return true;
+
+		case visibility::DENY:
+			return false;
+
+		case visibility::PRESENT_JOIN:
+		{
+			const m::room present{room.room_id};
+			return present.membership(m::user::id{mxid}, "join");
+		}
+
+		case visibility::ORIGIN:
+		{
+			const m::room::origins origins
+			{
+				room
+			};
+
+			return origins.has(m::node::id{mxid}.host());
+		}
+	}
+
+	return false;
+}
+
+extern "C" void
+visible_cache_stats(std::ostream &out)
+{
+	out << "entries:      " << visibility::cache.size() << std::endl
+	    << "hits:         " << visibility::hits << std::endl
+	    << "misses:       " << visibility::misses << std::endl;
+}
+
 static void
 _changed_visibility(const m::event &event,
                     m::vm::eval &)
@@ -10,65 +10,492 @@
 
 using namespace ircd;
 
+static void on_unload();
+
 mapi::header
 IRCD_MODULE
 {
-	"Matrix state library; modular components."
+	"Matrix state library; modular components.", {}, on_unload
 };
 
-namespace ircd::m::state
+/// State tree garbage collection.
+///
+/// Nodes of the state tree are content-addressed and shared between the
+/// trees of every event, so nodes are never deleted when a new root is
+/// written. Nodes which can no longer be reached from any root in the
+/// room_events column accumulate in state_node. The collector runs in three
+/// phases:
+///
+/// - mark: every root in room_events is walked and each reachable node id is
+/// recorded as a 128-bit fingerprint (the leading half of its sha256).
+///
+/// - scan: state_node is iterated once; every node not marked is recorded in
+/// a sorted dead set. Key boundaries are sampled to divide the column into
+/// ranges for the sweep.
+///
+/// - sweep: the column's compaction filter (state::node_dead) is pointed at
+/// the dead set and each range in turn is marked for background compaction,
+/// which drops the dead nodes at its own priority; no context is held in a
+/// manual compaction. The sweep ends once no compaction is pending.
+///
+/// Both sets are bounded. A collection whose reachable set would exceed
+/// ircd.m.state.gc.reachable_max fails before anything is dropped; dead nodes
+/// past ircd.m.state.gc.dead_max are left for the next collection.
+///
+/// Nodes written while a collection is in progress are observed through
+/// state::node_written and are never dropped, even when an identical node
+/// was found dead; this covers a node being recreated after the mark. Before
+/// the mark begins, evaluations which may have written nodes before the
+/// observer was installed are waited on until their transaction is done, so
+/// every uncommitted node is either observed or committed under a root the
+/// mark will read.
+///
+namespace ircd::m::state::gc
 {
-	extern "C" size_t ircd__m__state__gc(void);
+	using fingerprint = uint128_t;
+
+	struct fingerprint_hash
+	{
+		size_t operator()(const fingerprint &f) const noexcept
+		{
+			return uint64_t(f);
+		}
+	};
+
+	using fingerprint_set = std::unordered_set<fingerprint, fingerprint_hash>;
+
+	struct status
+	{
+		string_view phase {"idle"};
+		size_t roots {0};
+		size_t reachable {0};
+		size_t nodes {0};
+		size_t dead {0};
+		size_t deferred {0};
+		size_t ranges {0};
+		size_t ranges_done {0};
+		std::atomic<size_t> swept {0};
+		time_t started {0};
+		time_t finished {0};
+	};
+
+	extern conf::item<size_t> range_keys;
+	extern conf::item<milliseconds> range_interval;
+	extern conf::item<size_t> reachable_max;
+	extern conf::item<size_t> dead_max;
+	extern log::log log;
+
+	extern status stat;
+	extern std::vector<fingerprint> dead;
+	extern fingerprint_set written;
+	extern std::mutex written_mutex;
+	extern ctx::context worker;
+
+	static fingerprint make_fingerprint(const string_view &id);
+	static bool is_dead(const string_view &id);
+	static void handle_written(const id &);
+	static bool handle_dead(const id &);
+
+	static void fence();
+	static void mark(fingerprint_set &reachable);
+	static void scan(const fingerprint_set &reachable, std::vector<std::string> &bounds);
+	static void sweep(const std::vector<std::string> &bounds);
+	static void run() noexcept;
+
+	extern "C" bool ircd__m__state__gc(void);
+	extern "C" void ircd__m__state__gc_status(std::ostream &);
 }
 
-size_t
-ircd::m::state::ircd__m__state__gc()
+decltype(ircd::m::state::gc::range_keys)
+ircd::m::state::gc::range_keys
+{
+	{ "name",     "ircd.m.state.gc.range_keys" },
+	{ "default",  262144L                      },
+};
+
+decltype(ircd::m::state::gc::range_interval)
+ircd::m::state::gc::range_interval
 {
-	std::set<id_buffer> heads;
+	{ "name",     "ircd.m.state.gc.range_interval" },
+	{ "default",  5000L                            },
+};
+
+/// About 48 bytes each; the default bounds the mark near 3 GiB.
+decltype(ircd::m::state::gc::reachable_max)
+ircd::m::state::gc::reachable_max
+{
+	{ "name",     "ircd.m.state.gc.reachable_max" },
+	{ "default",  67108864L                       },
+};
+
+/// 16 bytes each.
+decltype(ircd::m::state::gc::dead_max)
+ircd::m::state::gc::dead_max
+{
+	{ "name",     "ircd.m.state.gc.dead_max" },
+	{ "default",  67108864L                  },
+};
+
+decltype(ircd::m::state::gc::log)
+ircd::m::state::gc::log
+{
+	"m.state.gc"
+};
+
+decltype(ircd::m::state::gc::stat)
+ircd::m::state::gc::stat;
+
+decltype(ircd::m::state::gc::dead)
+ircd::m::state::gc::dead;
+
+decltype(ircd::m::state::gc::written)
+ircd::m::state::gc::written;
+
+decltype(ircd::m::state::gc::written_mutex)
+ircd::m::state::gc::written_mutex;
+
+decltype(ircd::m::state::gc::worker)
+ircd::m::state::gc::worker;
+
+void
+on_unload()
+{
+	using namespace ircd::m::state;
+
+	if(!gc::worker)
+		return;
+
+	gc::worker.interrupt();
+	gc::worker.join();
+}
+
+/// Starts a collection in the background. Returns false if one is already
+/// running.
+bool
+ircd::m::state::gc::ircd__m__state__gc()
+{
+	if(worker && !worker.joined())
+		return false;
+
+	worker = ctx::context
+	{
+		"stategc", 512_KiB, run, ctx::context::POST
+	};
+
+	return true;
+}
+
+void
+ircd::m::state::gc::ircd__m__state__gc_status(std::ostream &out)
+{
+	out << "phase:        " << stat.phase << std::endl
+	    << "started:      " << stat.started << std::endl
+	    << "finished:     " << stat.finished << std::endl
+	    << "roots:        " << stat.roots << std::endl
+	    << "reachable:    " << stat.reachable << std::endl
+	    << "nodes:        " << stat.nodes << std::endl
+	    << "dead:         " << stat.dead << std::endl
+	    << "deferred:     " << stat.deferred << std::endl
+	    << "ranges:       " << stat.ranges_done << " of " << stat.ranges << std::endl
+	    << "swept:        " << stat.swept << std::endl;
+}
+
+void
+ircd::m::state::gc::run()
+noexcept try
+{
+	const ctx::sched::scope prio
+	{
+		ctx::sched::prio::BACKGROUND
+	};
+
+	stat.roots = 0;
+	stat.reachable = 0;
+	stat.nodes = 0;
+	stat.dead = 0;
+	stat.deferred = 0;
+	stat.ranges = 0;
+	stat.ranges_done = 0;
+	stat.swept = 0;
+	stat.started = ircd::time();
+	stat.finished = 0;
+
+	// The observer is installed before the mark so no node written after the
+	// roots are read can be mistaken for dead.
+	node_written = handle_written;
+	const unwind reset{[]
 	{
-		const db::gopts opts{db::get::NO_CACHE};
-		//opts.readahead = 4_MiB;
+		node_dead = {};
+		node_written = {};
+		dead.clear();
+		dead.shrink_to_fit();
 
-		db::column &column{m::dbs::room_events};
-		for(auto it(column.begin(opts)); it; ++it)
+		const std::lock_guard<std::mutex> lock{written_mutex};
+		written.clear();
+		stat.finished = ircd::time();
+	}};
+
+	stat.phase = "fence";
+	fence();
+
+	std::vector<std::string> bounds;
+	{
+		fingerprint_set reachable;
+		stat.phase = "mark";
+		mark(reachable);
+
+		stat.phase = "scan";
+		scan(reachable, bounds);
+	}
+
+	stat.phase = "sweep";
+	sweep(bounds);
+
+	stat.phase = "done";
+	log::info
+	{
+		log, "Collected %zu of %zu state nodes unreachable from %zu roots in %ld$s",
+		size_t(stat.swept),
+		stat.nodes,
+		stat.roots,
+		ircd::time() - stat.started
+	};
+}
+catch(const ctx::interrupted &e)
+{
+	log::warning
+	{
+		log, "State garbage collection interrupted in phase %s", stat.phase
+	};
+
+	stat.phase = "interrupted";
+}
+catch(const std::exception &e)
+{
+	stat.phase = "error";
+	log::error
+	{
+		log, "State garbage collection: %s", e.what()
+	};
+}
+
+/// Waits out every evaluation holding an open transaction when the observer
+/// was installed; nodes it wrote into that transaction were not observed.
+/// An evaluation is identified by its sequence since one eval instance may
+/// evaluate many events in turn.
+void
+ircd::m::state::gc::fence()
+{
+	std::vector<std::pair<const vm::eval *, uint64_t>> pending;
+	for(const auto *const &eval : vm::eval::list)
+		if(eval->txn)
+			pending.emplace_back(eval, eval->sequence);
+
+	while(!pending.empty())
+	{
+		ctx::sleep(milliseconds(50));
+		pending.erase(std::remove_if(begin(pending), end(pending), []
+		(const auto &p)
 		{
-			const auto &root(it->second);
-			id_buffer buf;
-			copy(buf, root);
-			heads.emplace(buf);
-		}
+			const auto &list(vm::eval::list);
+			const auto it(std::find(begin(list), end(list), p.first));
+			return it == end(list) || !p.first->txn || p.first->sequence != p.second;
+		}), end(pending));
 	}
+}
+
+void
+ircd::m::state::gc::mark(fingerprint_set &reachable)
+{
+	const db::gopts opts
+	{
+		db::get::NO_CACHE
+	};
 
-	std::set<id_buffer> active;
-	for(auto it(begin(heads)); it != end(heads); it = heads.erase(it))
+	std::vector<std::string> stack;
+	db::column &column{m::dbs::room_events};
+	for(auto it(column.begin(opts)); it; ++it)
 	{
-		const auto &root(*it);
-		std::cout << "root: " << string_view{root} << std::endl;
-		state::for_each(root, state::iter_bool_closure{[&active]
-		(const json::array &key, const string_view &val)
+		ctx::interruption_point();
+		stack.emplace_back(it->second);
+		++stat.roots;
+
+		// Shared subtrees are only walked once because a marked node's
+		// children are already marked.
+		while(!stack.empty())
 		{
-			std::cout << "key: " << key << std::endl;
-			std::cout << "val: " << val << std::endl;
-			return true;
-		}});
+			const std::string node_id
+			{
+				std::move(stack.back())
+			};
+
+			stack.pop_back();
+			if(empty(node_id))
+				continue;
+
+			if(!reachable.emplace(make_fingerprint(node_id)).second)
+				continue;
+
+			if(unlikely(reachable.size() > size_t(reachable_max)))
+				throw ircd::error
+				{
+					"More than %zu reachable state nodes; raise ircd.m.state.gc.reachable_max",
+					size_t(reachable_max)
+				};
 
-		break;
+			get_node(std::nothrow, node_id, [&stack]
+			(const json::object &object)
+			{
+				const node node{object};
+				for(size_t i(0); i < node.childs(); ++i)
+					if(node.has_child(i))
+						stack.emplace_back(node.child(i));
+			});
+		}
 	}
-/*
-	static const db::gopts opts
+
+	stat.reachable = reachable.size();
+	log::info
+	{
+		log, "Marked %zu state nodes reachable from %zu roots",
+		stat.reachable,
+		stat.roots
+	};
+}
+
+void
+ircd::m::state::gc::scan(const fingerprint_set &reachable,
+                         std::vector<std::string> &bounds)
+{
+	const db::gopts opts
 	{
 		db::get::NO_CACHE
 	};
 
-	auto &column{m::dbs::state_node};
+	const size_t range_keys
+	{
+		std::max(size_t(gc::range_keys), size_t(1))
+	};
+
+	db::column &column{m::dbs::state_node};
 	for(auto it(column.begin(opts)); it; ++it)
 	{
-		id_buffer buf;
-		const auto &root(it->second);
-		copy(buf, root);
-		active.emplace(buf);
+		const auto &node_id(it->first);
+		if(stat.nodes++ % range_keys == 0)
+		{
+			ctx::interruption_point();
+			bounds.emplace_back(node_id);
+		}
+
+		const auto fp(make_fingerprint(node_id));
+		if(reachable.count(fp))
+			continue;
+
+		if(dead.size() < size_t(dead_max))
+			dead.emplace_back(fp);
+		else
+			++stat.deferred;
+	}
+
+	std::sort(begin(dead), end(dead));
+	stat.dead = dead.size();
+	stat.ranges = bounds.size();
+	log::info
+	{
+		log, "Found %zu of %zu state nodes unreachable (%zu deferred); sweeping in %zu ranges",
+		stat.dead,
+		stat.nodes,
+		stat.deferred,
+		stat.ranges
+	};
+}
+
+void
+ircd::m::state::gc::sweep(const std::vector<std::string> &bounds)
+{
+	if(dead.empty())
+		return;
+
+	// Removed again by run() on the way out, before the dead set is freed.
+	node_dead = handle_dead;
+
+	db::column &column{m::dbs::state_node};
+	for(size_t i(0); i < bounds.size(); ++i)
+	{
+		ctx::interruption_point();
+		const std::pair<string_view, string_view> range
+		{
+			i > 0? string_view{bounds.at(i)} : string_view{},
+			i + 1 < bounds.size()? string_view{bounds.at(i + 1)} : string_view{},
+		};
+
+		db::suggest(column, range);
+		++stat.ranges_done;
+		log::debug
+		{
+			log, "Suggested range %zu of %zu; %zu nodes collected so far",
+			stat.ranges_done,
+			stat.ranges,
+			size_t(stat.swept)
+		};
+
+		ctx::sleep(milliseconds(range_interval));
 	}
-*/
-	size_t ret(active.size());
+
+	while(db::property<db::prop_int>(column, "rocksdb.compaction-pending"))
+		ctx::sleep(milliseconds(range_interval));
+}
+
+/// Called from the column's compaction filter.
+bool
+ircd::m::state::gc::handle_dead(const id &node_id)
+{
+	if(!is_dead(node_id))
+		return false;
+
+	++stat.swept;
+	return true;
+}
+
+bool
+ircd::m::state::gc::is_dead(const string_view &node_id)
+{
+	const auto fp
+	{
+		make_fingerprint(node_id)
+	};
+
+	if(!std::binary_search(begin(dead), end(dead), fp))
+		return false;
+
+	const std::lock_guard<std::mutex> lock{written_mutex};
+	return !written.count(fp);
+}
+
+void
+ircd::m::state::gc::handle_written(const id &node_id)
+{
+	const auto fp
+	{
+		make_fingerprint(node_id)
+	};
+
+	const std::lock_guard<std::mutex> lock{written_mutex};
+	written.emplace(fp);
+}
+
+/// Node ids are the b64 of a sha256 so the leading 16 bytes are already a
+/// uniformly distributed fingerprint.
+ircd::m::state::gc::fingerprint
+ircd::m::state::gc::make_fingerprint(const string_view &node_id)
+{
+	char buf[sha256::digest_size + 2];
+	const const_buffer hash
+	{
+		b64decode(buf, node_id)
+	};
+
+	fingerprint ret{0};
+	memcpy(&ret, data(hash), std::min(size(hash), sizeof(ret)));
 	return ret;
 }
@@ -44,32 +44,19 @@ user_create(const m::user::id &user_id,
 	return user;
 }
 
+/// Matched with the push rules compiled for the room (user_id, localpart,
+/// displayname and @room) so the scan agrees with the indexed count.
 extern "C" bool
 highlighted_event(const event &event,
                   const user &user)
 {
-	if(json::get<"type"_>(event) != "m.room.message")
-		return false;
-
-	const json::object &content
-	{
-		json::get<"content"_>(event)
-	};
-
-	const string_view &formatted_body
-	{
-		content.get("formatted_body")
-	};
-
-	if(has(formatted_body, user.user_id))
-		return true;
-
-	const string_view &body
+	using prototype = bool (const m::event &, const m::user &);
+	static mods::import<prototype> highlighted
 	{
-		content.get("body")
+		"m_push", "push__highlighted"
 	};
 
-	return has(body, user.user_id);
+	return highlighted(event, user);
 }
 
 extern "C" size_t
@@ -78,11 +65,23 @@ highlighted_count__between(const user &user,
                            const event::idx &a,
                            const event::idx &b)
 {
+	// The push rule evaluator records highlights as they are evaluated; when
+	// the range is covered the count doesn't require scanning the timeline.
+	using indexed_proto = bool (const m::user &, const m::room &, const event::idx &, const event::idx &, size_t &);
+	static mods::import<indexed_proto> indexed
+	{
+		"m_push", "push__highlight_count"
+	};
+
+	size_t indexed_ret{0};
+	if(indexed(user, room, a, b, indexed_ret))
+		return indexed_ret;
+
 	static const event::fetch::opts fopts
 	{
 		event::keys::include
 		{
-			"type", "content",
+			"type", "content", "sender", "room_id",
 		}
 	};
 
@@ -509,7 +509,7 @@ file_room_id(m::room::id::buf &out,
 
 	out =
 	{
-		b58encode(buf, hash), my_host()
+		b58encode_compat(buf, hash), my_host()
 	};
 
 	return out;
@@ -16,14 +16,23 @@ IRCD_MODULE
 	"Domain Name System Client, Cache & Components",
 	[] // init
 	{
+		ircd::net::dns::cache::init();
 		ircd::net::dns::resolver_init();
 	},
 	[] // fini
 	{
 		ircd::net::dns::resolver_fini();
+		ircd::net::dns::cache::fini();
 	}
 };
 
+decltype(ircd::net::dns::ipport_AAAA)
+ircd::net::dns::ipport_AAAA
+{
+	{ "name",     "ircd.net.dns.ipport.AAAA" },
+	{ "default",  true                       },
+};
+
 /// Convenience composition with a single ipport callback. This is the result of
 /// an automatic chain of queries such as SRV and A/AAAA based on the input and
 /// intermediate results.
@@ -34,7 +43,7 @@ ircd::net::dns::_resolve_ipport(const hostport &hp,
 {
 	auto handler
 	{
-		std::bind(&handle_ipport__A, std::move(callback), ph::_1, ph::_2, ph::_3)
+		std::bind(&handle_ipport__A, std::move(callback), opts, ph::_1, ph::_2, ph::_3)
 	};
 
 	if(!hp.service)
@@ -59,8 +68,12 @@ ircd::net::dns::_resolve_ipport(const hostport &hp,
 	});
 }
 
+/// When the host has no A record the AAAA record is tried so IPv6-only
+/// servers can be reached. The error from the A query is reported if there
+/// is no AAAA record either.
 void
 ircd::net::dns::handle_ipport__A(callback_ipport_one callback,
+                                 opts opts,
                                  std::exception_ptr eptr,
                                  const hostport &hp,
                                  const rfc1035::record::A &record)
@@ -73,6 +86,21 @@ ircd::net::dns::handle_ipport__A(callback_ipport_one callback,
 	if(!eptr && !record.ip4)
 		eptr = std::make_exception_ptr(no_record);
 
+	if(eptr && bool(ipport_AAAA))
+	{
+		opts.qtype = 0;
+		opts.nxdomain_exceptions = true;
+		return _resolve__AAAA(hp, opts, [callback(std::move(callback)), eptr]
+		(std::exception_ptr eptr_, const hostport &hp, const rfc1035::record::AAAA &record)
+		mutable
+		{
+			if(eptr_ || !record.ip6)
+				eptr_ = std::move(eptr);
+
+			handle_ipport__AAAA(std::move(callback), std::move(eptr_), hp, record);
+		});
+	}
+
 	const ipport ipport
 	{
 		record.ip4, port(hp)
@@ -81,6 +109,28 @@ ircd::net::dns::handle_ipport__A(callback_ipport_one callback,
 	callback(std::move(eptr), hp, ipport);
 }
 
+void
+ircd::net::dns::handle_ipport__AAAA(callback_ipport_one callback,
+                                    std::exception_ptr eptr,
+                                    const hostport &hp,
+                                    const rfc1035::record::AAAA &record)
+{
+	static const ircd::net::not_found no_record
+	{
+		"Host has no AAAA record"
+	};
+
+	if(!eptr && !record.ip6)
+		eptr = std::make_exception_ptr(no_record);
+
+	const ipport ipport
+	{
+		record.ip6, port(hp)
+	};
+
+	callback(std::move(eptr), hp, ipport);
+}
+
 /// Convenience callback with a single SRV record which was selected from
 /// the vector with stochastic respect for weighting and priority.
 void
@@ -201,6 +251,66 @@ ircd::net::dns::handle__A(callback_A_one callback,
 	return callback(std::move(eptr), hp, empty);
 }
 
+/// Convenience callback with a single AAAA record which was selected from
+/// the vector randomly.
+void
+ircd::net::dns::_resolve__AAAA(const hostport &hp,
+                               opts opts,
+                               callback_AAAA_one callback)
+{
+	static const auto &qtype
+	{
+		rfc1035::qtype.at("AAAA")
+	};
+
+	if(unlikely(opts.qtype && opts.qtype != qtype))
+		throw error
+		{
+			"Specified query type '%s' (%u) but user's callback is for AAAA records only.",
+			rfc1035::rqtype.at(opts.qtype),
+			opts.qtype
+		};
+
+	if(!opts.qtype)
+		opts.qtype = qtype;
+
+	auto handler
+	{
+		std::bind(&handle__AAAA, std::move(callback), ph::_1, ph::_2, ph::_3)
+	};
+
+	_resolve__(hp, opts, std::move(handler));
+}
+
+void
+ircd::net::dns::handle__AAAA(callback_AAAA_one callback,
+                             std::exception_ptr eptr,
+                             const hostport &hp,
+                             const records &rrs)
+{
+	static const rfc1035::record::AAAA empty;
+	static const auto &qtype
+	{
+		rfc1035::qtype.at("AAAA")
+	};
+
+	if(eptr)
+		return callback(std::move(eptr), hp, empty);
+
+	//TODO: prng plz
+	for(size_t i(0); i < rrs.size(); ++i)
+	{
+		const auto &rr(*rrs.at(i));
+		if(rr.type != qtype)
+			continue;
+
+		const auto &record(rr.as<const rfc1035::record::AAAA>());
+		return callback(std::move(eptr), hp, record);
+	}
+
+	return callback(std::move(eptr), hp, empty);
+}
+
 /// Fundamental callback with a vector of abstract resource records.
 void
 ircd::net::dns::_resolve__(const hostport &hp,
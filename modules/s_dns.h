@@ -16,12 +16,17 @@ namespace ircd::net::dns
 	// Maximum number of records we present in result vector to any closure
 	constexpr const size_t MAX_COUNT {64};
 
+	extern conf::item<bool> ipport_AAAA;
+
 	static void handle__A(callback_A_one, std::exception_ptr, const hostport &, const records &);
+	static void handle__AAAA(callback_AAAA_one, std::exception_ptr, const hostport &, const records &);
 	static void handle__SRV(callback_SRV_one, std::exception_ptr, const hostport &, const records &);
-	static void handle_ipport__A(callback_ipport_one, std::exception_ptr, const hostport &, const rfc1035::record::A &);
+	static void handle_ipport__A(callback_ipport_one, opts, std::exception_ptr, const hostport &, const rfc1035::record::A &);
+	static void handle_ipport__AAAA(callback_ipport_one, std::exception_ptr, const hostport &, const rfc1035::record::AAAA &);
 
 	extern "C" void _resolve__(const hostport &, const opts &, callback);
 	extern "C" void _resolve__A(const hostport &, opts, callback_A_one);
+	extern "C" void _resolve__AAAA(const hostport &, opts, callback_AAAA_one);
 	extern "C" void _resolve__SRV(const hostport &, opts, callback_SRV_one);
 	extern "C" void _resolve_ipport(const hostport &, opts, callback_ipport_one);
 }
@@ -34,9 +39,22 @@ namespace ircd::net::dns::cache
 {
 	extern conf::item<seconds> min_ttl;
 	extern conf::item<seconds> clear_nxdomain;
+	extern conf::item<seconds> refresh_ahead;
+	extern conf::item<bool> persist;
 
 	extern std::multimap<std::string, rfc1035::record::A, std::less<>> cache_A;
+	extern std::multimap<std::string, rfc1035::record::AAAA, std::less<>> cache_AAAA;
 	extern std::multimap<std::string, rfc1035::record::SRV, std::less<>> cache_SRV;
+	extern std::set<std::string, std::less<>> refreshing;
+
+	extern const db::descriptor A_descriptor;
+	extern const db::descriptor AAAA_descriptor;
+	extern const db::descriptor SRV_descriptor;
+	extern const db::description description;
+	extern std::shared_ptr<db::database> database;
+	extern db::column column_A;
+	extern db::column column_AAAA;
+	extern db::column column_SRV;
 
 	template<class Map>
 	static bool _for_each_(Map &, const closure &);
@@ -47,6 +65,22 @@ namespace ircd::net::dns::cache
 	template<class T, class Map>
 	static rfc1035::record *_cache_error(Map &, const string_view &host);
 
+	static json::object _serialize(const mutable_buffer &, const rfc1035::record &);
+	static void _deserialize(rfc1035::record::A &, const json::object &);
+	static void _deserialize(rfc1035::record::AAAA &, const json::object &);
+	static void _deserialize(rfc1035::record::SRV &, const json::object &);
+
+	template<class Map>
+	static void _save(Map &, db::column &, const string_view &host);
+
+	template<class Map>
+	static size_t _load(Map &, db::column &);
+
+	static void _refresh(const uint16_t &type, const string_view &key, const time_t &expires);
+
+	void init();
+	void fini();
+
 	extern "C" rfc1035::record *_put(const rfc1035::question &, const rfc1035::answer &);
 	extern "C" rfc1035::record *_put_error(const rfc1035::question &, const uint &code);
 	extern "C" bool _get(const hostport &, const opts &, const callback &);
@@ -24,12 +24,163 @@ ircd::net::dns::cache::min_ttl
 	{ "default",   900L                        },
 };
 
+decltype(ircd::net::dns::cache::refresh_ahead)
+ircd::net::dns::cache::refresh_ahead
+{
+	{ "name",     "ircd.net.dns.cache.refresh_ahead" },
+	{ "default",   120L                              },
+};
+
+decltype(ircd::net::dns::cache::persist)
+ircd::net::dns::cache::persist
+{
+	{ "name",     "ircd.net.dns.cache.persist" },
+	{ "default",   true                        },
+};
+
 decltype(ircd::net::dns::cache::cache_A)
 ircd::net::dns::cache::cache_A;
 
+decltype(ircd::net::dns::cache::cache_AAAA)
+ircd::net::dns::cache::cache_AAAA;
+
 decltype(ircd::net::dns::cache::cache_SRV)
 ircd::net::dns::cache::cache_SRV;
 
+decltype(ircd::net::dns::cache::refreshing)
+ircd::net::dns::cache::refreshing;
+
+decltype(ircd::net::dns::cache::database)
+ircd::net::dns::cache::database;
+
+decltype(ircd::net::dns::cache::column_A)
+ircd::net::dns::cache::column_A;
+
+decltype(ircd::net::dns::cache::column_AAAA)
+ircd::net::dns::cache::column_AAAA;
+
+decltype(ircd::net::dns::cache::column_SRV)
+ircd::net::dns::cache::column_SRV;
+
+decltype(ircd::net::dns::cache::A_descriptor)
+ircd::net::dns::cache::A_descriptor
+{
+	// name
+	"A",
+
+	// explain
+	R"(
+	Persisted A records of the DNS cache. The key is the hostname. The
+	value is a JSON array of the cached records for that host, each with
+	an absolute expiration time. A cached error has a zero address.
+	)",
+
+	// typing
+	{
+		typeid(string_view), typeid(string_view)
+	},
+};
+
+decltype(ircd::net::dns::cache::AAAA_descriptor)
+ircd::net::dns::cache::AAAA_descriptor
+{
+	// name
+	"AAAA",
+
+	// explain
+	R"(
+	Persisted AAAA records of the DNS cache. The key is the hostname. The
+	value is a JSON array of the cached records for that host, each with
+	an absolute expiration time. A cached error has a zero address.
+	)",
+
+	// typing
+	{
+		typeid(string_view), typeid(string_view)
+	},
+};
+
+decltype(ircd::net::dns::cache::SRV_descriptor)
+ircd::net::dns::cache::SRV_descriptor
+{
+	// name
+	"SRV",
+
+	// explain
+	R"(
+	Persisted SRV records of the DNS cache. The key is the full SRV query
+	name i.e "_matrix._tcp.example.com". The value is a JSON array of the
+	cached records, each with an absolute expiration time. A cached error
+	has no target.
+	)",
+
+	// typing
+	{
+		typeid(string_view), typeid(string_view)
+	},
+};
+
+decltype(ircd::net::dns::cache::description)
+ircd::net::dns::cache::description
+{
+	{ "default" }, // requirement of RocksDB
+
+	A_descriptor,
+	AAAA_descriptor,
+	SRV_descriptor,
+};
+
+/// Opens the cache database and loads all unexpired records into memory so
+/// the server doesn't have to resolve every remote again after a restart.
+void
+ircd::net::dns::cache::init()
+try
+{
+	if(!bool(persist))
+		return;
+
+	static const std::string dbopts;
+	database = std::make_shared<db::database>("dns", dbopts, description);
+	column_A = db::column{*database, "A"};
+	column_AAAA = db::column{*database, "AAAA"};
+	column_SRV = db::column{*database, "SRV"};
+
+	const size_t count[3]
+	{
+		_load(cache_A, column_A),
+		_load(cache_AAAA, column_AAAA),
+		_load(cache_SRV, column_SRV),
+	};
+
+	log::info
+	{
+		log, "Loaded %zu A, %zu AAAA and %zu SRV records from the DNS cache.",
+		count[0],
+		count[1],
+		count[2],
+	};
+}
+catch(const std::exception &e)
+{
+	log::error
+	{
+		log, "DNS cache will not be persisted :%s", e.what()
+	};
+
+	fini();
+}
+
+/// The database close joins RocksDB threads which can deadlock during the
+/// static destruction of this module so it is closed here explicitly.
+void
+ircd::net::dns::cache::fini()
+{
+	column_A = {};
+	column_AAAA = {};
+	column_SRV = {};
+	database = std::shared_ptr<db::database>{};
+}
+
 bool
 ircd::net::dns::cache::_for_each(const uint16_t &type,
                                  const closure &closure)
@@ -39,6 +190,9 @@ ircd::net::dns::cache::_for_each(const uint16_t &type,
 		case 1: // A
 			return _for_each_(cache_A, closure);
 
+		case 28: // AAAA
+			return _for_each_(cache_AAAA, closure);
+
 		case 33: // SRV
 			return _for_each_(cache_SRV, closure);
 
@@ -65,20 +219,18 @@ ircd::net::dns::cache::_get(const hostport &hp,
 	// ref counting and other pornographic complications to this cache.
 	const ctx::critical_assertion ca;
 	thread_local std::array<const rfc1035::record *, MAX_COUNT> record;
+	thread_local char keybuf[512];
 	std::exception_ptr eptr;
+	string_view key;
+	time_t expires{0};
 	size_t count{0};
 
 	if(opts.qtype == 33) // deduced SRV query
 	{
 		assert(!empty(host(hp)));
-		thread_local char srvbuf[512];
-		const string_view srvhost
-		{
-			make_SRV_key(srvbuf, hp, opts)
-		};
-
+		key = make_SRV_key(keybuf, hp, opts);
 		auto &map{cache_SRV};
-		const auto pit{map.equal_range(srvhost)};
+		const auto pit{map.equal_range(key)};
 		if(pit.first == pit.second)
 			return false;
 
@@ -107,6 +259,9 @@ ircd::net::dns::cache::_get(const hostport &hp,
 				});
 			}
 
+			if(rr.tgt || rr.port)
+				expires = expires? std::min(expires, rr.ttl) : rr.ttl;
+
 			if(count < record.size())
 				record.at(count++) = &rr;
 
@@ -116,7 +271,7 @@ ircd::net::dns::cache::_get(const hostport &hp,
 	else if(opts.qtype == 1)
 	{
 		auto &map{cache_A};
-		const auto &key{rstrip(host(hp), '.')};
+		key = { keybuf, copy(keybuf, rstrip(host(hp), '.')) };
 		if(unlikely(empty(key)))
 			return false;
 
@@ -149,6 +304,52 @@ ircd::net::dns::cache::_get(const hostport &hp,
 				});
 			}
 
+			if(rr.ip4)
+				expires = expires? std::min(expires, rr.ttl) : rr.ttl;
+
+			if(count < record.size())
+				record.at(count++) = &rr;
+
+			++it;
+		}
+	}
+	else if(opts.qtype == 28)
+	{
+		auto &map{cache_AAAA};
+		key = { keybuf, copy(keybuf, rstrip(host(hp), '.')) };
+		if(unlikely(empty(key)))
+			return false;
+
+		const auto pit{map.equal_range(key)};
+		if(pit.first == pit.second)
+			return false;
+
+		const auto &now{ircd::time()};
+		for(auto it(pit.first); it != pit.second; )
+		{
+			const auto &rr{it->second};
+
+			// Cached entry is too old, ignore and erase
+			if(rr.ttl < now)
+			{
+				it = map.erase(it);
+				continue;
+			}
+
+			// Cached entry is a cached error, we set the eptr, but also
+			// include the record and increment the count like normal.
+			if(!rr.ip6 && !eptr)
+			{
+				static const auto rcode{3}; //NXDomain
+				eptr = std::make_exception_ptr(rfc1035::error
+				{
+					"protocol error #%u (cached) :%s", rcode, rfc1035::rcode.at(rcode)
+				});
+			}
+
+			if(rr.ip6)
+				expires = expires? std::min(expires, rr.ttl) : rr.ttl;
+
 			if(count < record.size())
 				record.at(count++) = &rr;
 
@@ -159,12 +360,92 @@ ircd::net::dns::cache::_get(const hostport &hp,
 	assert(count || !eptr);        // no error if no cache response
 	assert(!eptr || count == 1);   // if error, should only be one entry.
 
+	// The key is copied out of the thread_local buffer before the callback
+	// because the callback might make another query through here.
+	char refresh_buf[512];
+	const string_view refresh_key
+	{
+		refresh_buf, copy(refresh_buf, key)
+	};
+
 	if(count)
 		cb(std::move(eptr), hp, vector_view<const rfc1035::record *>(record.data(), count));
 
+	if(count && expires)
+		_refresh(opts.qtype, refresh_key, expires);
+
 	return count;
 }
 
+/// Refresh-ahead. When a positive entry is hit within the refresh window
+/// before it expires, a query is made in the background to replace it. This
+/// way entries which are in use don't expire and miss in the foreground.
+void
+ircd::net::dns::cache::_refresh(const uint16_t &type,
+                                const string_view &key,
+                                const time_t &expires)
+try
+{
+	if(expires - ircd::time() > seconds(refresh_ahead).count())
+		return;
+
+	char idbuf[512];
+	const string_view id
+	{
+		fmt::sprintf
+		{
+			idbuf, "%u:%s", type, key
+		}
+	};
+
+	auto it(refreshing.lower_bound(id));
+	if(it != end(refreshing) && *it == id)
+		return;
+
+	it = refreshing.emplace_hint(it, id);
+	const unwind::exceptional unrefresh{[&it]
+	{
+		refreshing.erase(it);
+	}};
+
+	dns::opts opts;
+	opts.qtype = type;
+	opts.cache_check = false;
+	opts.nxdomain_exceptions = false;
+
+	// SRV keys are full query names; the prefix is passed back through opts
+	// so the resolver makes the same query it made the first time.
+	hostport hp{key};
+	if(type == 33)
+	{
+		hp.host = unmake_SRV_key(key);
+		opts.srv = string_view{key.data(), hp.host.data()};
+	}
+
+	resolver_call(hp, opts, [id(std::string(id))]
+	(std::exception_ptr, const hostport &, const records &)
+	{
+		// Do nothing; cache already updated if necessary
+		refreshing.erase(id);
+	});
+
+	log::debug
+	{
+		log, "Refreshing '%s' ahead of expiration in %ld$s",
+		id,
+		expires - ircd::time()
+	};
+}
+catch(const std::exception &e)
+{
+	log::derror
+	{
+		log, "Failed to refresh '%s' :%s",
+		key,
+		e.what()
+	};
+}
+
 ircd::rfc1035::record *
 ircd::net::dns::cache::_put(const rfc1035::question &question,
                             const rfc1035::answer &answer)
@@ -175,13 +456,23 @@ ircd::net::dns::cache::_put(const rfc1035::question &question,
 	};
 
 	assert(!empty(host));
+	rfc1035::record *ret;
 	switch(answer.qtype)
 	{
 		case 1: // A
-			return _cache_answer(cache_A, host, answer);
+			ret = _cache_answer(cache_A, host, answer);
+			_save(cache_A, column_A, host);
+			return ret;
+
+		case 28: // AAAA
+			ret = _cache_answer(cache_AAAA, host, answer);
+			_save(cache_AAAA, column_AAAA, host);
+			return ret;
 
 		case 33: // SRV
-			return _cache_answer(cache_SRV, host, answer);
+			ret = _cache_answer(cache_SRV, host, answer);
+			_save(cache_SRV, column_SRV, host);
+			return ret;
 
 		default:
 			return nullptr;
@@ -198,13 +489,23 @@ ircd::net::dns::cache::_put_error(const rfc1035::question &question,
 	};
 
 	assert(!empty(host));
+	rfc1035::record *ret;
 	switch(question.qtype)
 	{
 		case 1: // A
-			return _cache_error<rfc1035::record::A>(cache_A, host);
+			ret = _cache_error<rfc1035::record::A>(cache_A, host);
+			_save(cache_A, column_A, host);
+			return ret;
+
+		case 28: // AAAA
+			ret = _cache_error<rfc1035::record::AAAA>(cache_AAAA, host);
+			_save(cache_AAAA, column_AAAA, host);
+			return ret;
 
 		case 33: // SRV
-			return _cache_error<rfc1035::record::SRV>(cache_SRV, host);
+			ret = _cache_error<rfc1035::record::SRV>(cache_SRV, host);
+			_save(cache_SRV, column_SRV, host);
+			return ret;
 
 		default:
 			return nullptr;
@@ -279,3 +580,190 @@ ircd::net::dns::cache::_for_each_(Map &map,
 
 	return true;
 }
+
+//
+// persistence
+//
+
+/// Writes all records for the host to the database, replacing what was
+/// there. Failure to persist is not fatal to the resolution.
+template<class Map>
+void
+ircd::net::dns::cache::_save(Map &map,
+                             db::column &column,
+                             const string_view &host)
+try
+{
+	if(!column)
+		return;
+
+	const auto pit
+	{
+		map.equal_range(host)
+	};
+
+	size_t i(0);
+	thread_local char buf[MAX_COUNT][384];
+	thread_local json::value value[MAX_COUNT];
+	for(auto it(pit.first); it != pit.second && i < MAX_COUNT; ++it, ++i)
+		value[i] = json::value
+		{
+			_serialize(buf[i], it->second), json::OBJECT
+		};
+
+	if(!i)
+		return db::del(column, host);
+
+	thread_local char outbuf[MAX_COUNT * 384 + 16];
+	mutable_buffer out{outbuf};
+	db::write(column, host, json::stringify(out, value, value + i));
+}
+catch(const std::exception &e)
+{
+	log::derror
+	{
+		log, "Failed to persist cached records for '%s' :%s",
+		host,
+		e.what()
+	};
+}
+
+template<class Map>
+size_t
+ircd::net::dns::cache::_load(Map &map,
+                             db::column &column)
+{
+	using record_type = typename Map::mapped_type;
+
+	size_t ret(0);
+	std::vector<std::string> expired;
+	const auto &now{ircd::time()};
+	for(auto it(column.begin()); it; ++it) try
+	{
+		const auto &host(it->first);
+		const json::array records(it->second);
+		size_t unexpired(0);
+		for(const json::object &object : records)
+		{
+			if(object.get<time_t>("ttl") < now)
+				continue;
+
+			auto iit
+			{
+				map.emplace(host, record_type{})
+			};
+
+			_deserialize(iit->second, object);
+			++unexpired;
+		}
+
+		if(!unexpired)
+			expired.emplace_back(host);
+
+		ret += unexpired;
+	}
+	catch(const std::exception &e)
+	{
+		log::derror
+		{
+			log, "Failed to load cached records for '%s' :%s",
+			it->first,
+			e.what()
+		};
+	}
+
+	for(const auto &host : expired)
+		db::del(column, host);
+
+	return ret;
+}
+
+ircd::json::object
+ircd::net::dns::cache::_serialize(const mutable_buffer &buf_,
+                                  const rfc1035::record &rr)
+{
+	mutable_buffer buf{buf_};
+	switch(rr.type)
+	{
+		case 1: // A
+		{
+			const auto &record(rr.as<const rfc1035::record::A>());
+			return json::stringify(buf, json::members
+			{
+				{ "ttl",  record.ttl         },
+				{ "ip4",  long(record.ip4)   },
+			});
+		}
+
+		case 28: // AAAA
+		{
+			char ipbuf[64];
+			const auto &record(rr.as<const rfc1035::record::AAAA>());
+			return json::stringify(buf, json::members
+			{
+				{ "ttl",  record.ttl                                               },
+				{ "ip6",  record.ip6? net::string(ipbuf, record.ip6) : string_view{} },
+			});
+		}
+
+		case 33: // SRV
+		{
+			const auto &record(rr.as<const rfc1035::record::SRV>());
+			return json::stringify(buf, json::members
+			{
+				{ "ttl",       record.ttl             },
+				{ "priority",  long(record.priority)  },
+				{ "weight",    long(record.weight)    },
+				{ "port",      long(record.port)      },
+				{ "tgt",       record.tgt             },
+			});
+		}
+
+		default:
+			return json::stringify(buf, json::members
+			{
+				{ "ttl",  rr.ttl  },
+			});
+	}
+}
+
+void
+ircd::net::dns::cache::_deserialize(rfc1035::record::A &record,
+                                    const json::object &object)
+{
+	record.ttl = object.get<time_t>("ttl");
+	record.ip4 = object.get<uint32_t>("ip4");
+}
+
+void
+ircd::net::dns::cache::_deserialize(rfc1035::record::AAAA &record,
+                                    const json::object &object)
+{
+	record.ttl = object.get<time_t>("ttl");
+	const string_view ip6
+	{
+		unquote(object.get("ip6"))
+	};
+
+	if(!empty(ip6))
+		record.ip6 = host6(net::ipport{ip6, uint16_t(0)});
+}
+
+void
+ircd::net::dns::cache::_deserialize(rfc1035::record::SRV &record,
+                                    const json::object &object)
+{
+	record.ttl = object.get<time_t>("ttl");
+	record.priority = object.get<uint16_t>("priority");
+	record.weight = object.get<uint16_t>("weight");
+	record.port = object.get<uint16_t>("port");
+
+	// The target is a view into the record's own buffer; the record must
+	// already be at its final location in the map.
+	const string_view tgt
+	{
+		unquote(object.get("tgt"))
+	};
+
+	record.tgt = { record.tgtbuf, copy(record.tgtbuf, tgt) };
+}
@@ -641,6 +641,19 @@ try
 			continue;
 		}
 
+		case 28: // AAAA records are inserted into cache
+		{
+			if(!tag.opts.cache_result)
+			{
+				record[i] = new (pos) rfc1035::record::AAAA(an[i]);
+				pos += sizeof(rfc1035::record::AAAA);
+				continue;
+			}
+
+			record[i] = cache::put(qd.at(0), an[i]);
+			continue;
+		}
+
 		case 5:
 		{
 			record[i] = new (pos) rfc1035::record::CNAME(an[i]);
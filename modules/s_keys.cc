@@ -11,8 +11,8 @@
 using namespace ircd;
 
 static bool cache_get(const string_view &server, const string_view &key_id, const m::keys::closure &);
-static size_t cache_set(const json::object &);
 
+extern "C" size_t cache_set(const json::object &);
 extern "C" bool verify__keys(const m::keys &) noexcept;
 extern "C" void get__keys(const string_view &server, const string_view &key_id, const m::keys::closure &);
 extern "C" bool query__keys(const string_view &query_server, const m::keys::queries &, const m::keys::closure_bool &);
@@ -257,9 +257,11 @@ init_my_ed25519()
 		sha256{m::self::public_key}
 	};
 
-	const auto public_key_hash_b58
+	// The key ID must stay the same across versions for a given key.
+	char public_key_hash_b58buf[b58encode_size(sha256::digest_size)];
+	const string_view public_key_hash_b58
 	{
-		b58encode(hash)
+		b58encode_compat(public_key_hash_b58buf, hash)
 	};
 
 	static const auto trunc_size{8};
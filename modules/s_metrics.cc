@@ -0,0 +1,110 @@
+// Matrix Construct
+//
+// Copyright (C) Matrix Construct Developers, Authors & Contributors
+// Copyright (C) 2016-2018 Jason Volk <jason@zemos.net>
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice is present in all copies. The
+// full license for this software is available in the LICENSE file.
+
+using namespace ircd;
+
+mapi::header
+IRCD_MODULE
+{
+	"Server Metrics :Prometheus exposition of the stats registry"
+};
+
+conf::item<bool>
+metrics_enable
+{
+	{ "name",     "ircd.metrics.enable" },
+	{ "default",  false                 },
+};
+
+/// When set, every scrape must present this as a bearer token (or as the
+/// access_token parameter), loopback included. When empty, only loopback
+/// clients may scrape. A reverse proxy on the same host makes every request
+/// appear to come from loopback, so set a token whenever one is in front of
+/// this listener (or don't route /metrics through it).
+conf::item<std::string>
+metrics_token
+{
+	{ "name",     "ircd.metrics.token" },
+	{ "default",  string_view{}        },
+};
+
+static bool is_loopback(const net::ipport &);
+
+resource
+metrics_resource
+{
+	"/metrics",
+	{
+		"Exposes the stats registry in the Prometheus text format."
+	}
+};
+
+static resource::response
+get_metrics(client &client,
+            const resource::request &request)
+{
+	if(!bool(metrics_enable))
+		throw http::error
+		{
+			http::NOT_FOUND
+		};
+
+	const string_view token
+	{
+		metrics_token
+	};
+
+	const bool authorized
+	{
+		!empty(token)?
+			request.access_token == token:
+			is_loopback(remote(client))
+	};
+
+	if(!authorized)
+		throw http::error
+		{
+			http::FORBIDDEN
+		};
+
+	std::stringstream out;
+	stats::expose(out);
+	const std::string str
+	{
+		out.str()
+	};
+
+	return resource::response
+	{
+		client, str, "text/plain; version=0.0.4; charset=utf-8"
+	};
+}
+
+resource::method
+metrics_get
+{
+	metrics_resource, "GET", get_metrics
+};
+
+bool
+is_loopback(const net::ipport &ipp)
+{
+	if(net::is_v4(ipp))
+		return (net::host4(ipp) >> 24) == 127;
+
+	// ::1 or an IPv4-mapped 127/8 address from a dual-stack listener.
+	const uint128_t &host
+	{
+		net::host6(ipp)
+	};
+
+	return host == 1 ||
+	       ((host >> 32) == 0xffff && (uint32_t(host) >> 24) == 127);
+}
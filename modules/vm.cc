@@ -660,6 +660,13 @@ ircd::m::vm::_eval_pdu(eval &eval,
 		eval.txn = nullptr;
 	}};
 
+	// Dictionary allocations made by the txn are held until it's committed
+	// or abandoned.
+	const unwind release{[&txn]
+	{
+		dbs::id_release(txn);
+	}};
+
 	// Preliminary write_opts
 	m::dbs::write_opts wopts;
 	m::state::id_buffer new_root_buf;
@@ -725,7 +732,14 @@ ircd::m::vm::write_commit(eval &eval)
 			txn.bytes()
 		};
 
-	txn();
+	const db::sopts sopts
+	{
+		eval.opts->journal?
+			db::sopts{}:
+			db::sopts{db::set::NO_JOURNAL}
+	};
+
+	txn(sopts);
 }
 
 uint64_t